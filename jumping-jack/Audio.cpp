@@ -0,0 +1,235 @@
+#include "Audio.hpp"
+
+#include <pthread.h>
+#include <fstream>
+
+const std::size_t Audio::NONE;
+
+Audio::Audio() :
+    m_cache_size(0),
+    m_use_counter(0),
+    m_voice_count(16),
+    m_running(false),
+    m_idle_sleep(sf::milliseconds(2)) {}
+
+Audio::~Audio() { stop(); }
+
+void Audio::setCacheSize(std::size_t cache_size) { m_cache_size = cache_size; }
+
+bool Audio::loadSound(const std::string& name, const std::string& file_name, bool looping) {
+    Effect effect;
+    effect.loop_voice = looping ? m_looping_sounds.size() : NONE;
+    effect.volume = 100;
+    effect.pitch = 1;
+    
+    // Looping sounds play for long, keep them decoded
+    if(m_cache_size == 0 || looping) {
+        if(!effect.buffer.loadFromFile(file_name)) return false;
+    }
+    // Keep the file as it is, it gets decoded on its first play
+    else {
+        std::ifstream file(file_name, std::ios::binary | std::ios::ate);
+        if(!file) return false;
+        
+        effect.file.resize(static_cast<std::size_t>(file.tellg()));
+        file.seekg(0);
+        if(!file.read(effect.file.data(), effect.file.size())) return false;
+        
+        // WAV is no smaller kept as a file, decoding it on the audio thread would only cost time
+        if(isUncompressed(effect.file)) {
+            if(!effect.buffer.loadFromMemory(effect.file.data(), effect.file.size())) return false;
+            effect.file.clear();
+            effect.file.shrink_to_fit();
+        }
+    }
+    
+    // Voices are bound to the buffers in start(), after the vector stops growing
+    if(looping) m_looping_sounds.emplace_back();
+    m_effects.push_back(std::move(effect));
+    m_ids[name] = m_effects.size() - 1;
+    m_loop_requested.push_back(false);
+    return true;
+}
+
+void Audio::start() {
+    if(m_running) return;
+    
+    // Bind looping voices now that every buffer is in place
+    for(auto& effect : m_effects) {
+        if(effect.loop_voice == NONE) continue;
+        
+        m_looping_sounds[effect.loop_voice].setBuffer(effect.buffer);
+        m_looping_sounds[effect.loop_voice].setLoop(true);
+    }
+    m_voices.resize(m_voice_count);
+    
+    m_cache.resize(m_cache_size);
+    for(auto& slot : m_cache) {
+        slot.sound = NONE;
+        slot.last_used = 0;
+    }
+    
+    m_running = true;
+    m_thread = std::thread(&Audio::threadLoop, this);
+}
+
+void Audio::stop() {
+    if(!m_running) return;
+    
+    m_running = false;
+    m_thread.join();
+    
+    // Sounds must go before the buffers they use. The names go with the effects, sounds are
+    // loaded again before the next start().
+    m_voices.clear();
+    m_looping_sounds.clear();
+    m_cache.clear();
+    m_effects.clear();
+    m_ids.clear();
+    m_loop_requested.clear();
+    m_use_counter = 0;
+}
+
+void Audio::play(const std::string& name) { send(Command::PLAY, name); }
+void Audio::setVolume(const std::string& name, float volume) { send(Command::VOLUME, name, volume); }
+void Audio::setPitch(const std::string& name, float pitch) { send(Command::PITCH, name, pitch); }
+
+void Audio::setLoop(const std::string& name, bool loop) {
+    auto it = m_ids.find(name);
+    if(it == m_ids.end()) return;
+    
+    // Walking toggles this a lot, only send actual changes
+    if(m_loop_requested[it->second] == loop) return;
+    m_loop_requested[it->second] = loop;
+    
+    send(loop ? Command::START_LOOP : Command::STOP_LOOP, name);
+}
+
+void Audio::stopAll() {
+    for(std::size_t i = 0; i < m_loop_requested.size(); ++i) m_loop_requested[i] = false;
+    m_commands.push(Command{ Command::STOP_ALL, 0, 0 });
+}
+
+void Audio::send(Command::TYPE type, const std::string& name, float value) {
+    auto it = m_ids.find(name);
+    if(it == m_ids.end()) return;
+    
+    // Queue full means the audio thread is behind, dropping is better than waiting
+    m_commands.push(Command{ type, it->second, value });
+}
+
+void Audio::threadLoop() {
+    // Name the thread so it gets its own lane in profilers
+#ifdef __APPLE__
+    pthread_setname_np("jumping-jack audio");
+#else
+    pthread_setname_np(pthread_self(), "jj-audio");
+#endif
+    
+    Command command;
+    while(m_running) {
+        while(m_commands.pop(command)) execute(command);
+        sf::sleep(m_idle_sleep);
+    }
+    
+    // Silence everything before the voices are destroyed
+    for(auto& s : m_voices) s.stop();
+    for(auto& s : m_looping_sounds) s.stop();
+}
+
+void Audio::execute(const Command& command) {
+    Effect& effect = m_effects[command.sound];
+    sf::Sound* loop_voice = effect.loop_voice != NONE ? &m_looping_sounds[effect.loop_voice] : nullptr;
+    
+    switch(command.type) {
+        case Command::PLAY: {
+            const sf::SoundBuffer* buffer = decodedBuffer(command.sound);
+            if(!buffer) break;
+            
+            sf::Sound& voice = freeVoice();
+            voice.setBuffer(*buffer);
+            voice.setVolume(effect.volume);
+            voice.setPitch(effect.pitch);
+            voice.play();
+            break;
+        }
+            
+        case Command::START_LOOP:
+            if(loop_voice && loop_voice->getStatus() != sf::Sound::Playing) loop_voice->play();
+            break;
+            
+        case Command::STOP_LOOP:
+            if(loop_voice) loop_voice->pause();
+            break;
+            
+        case Command::VOLUME:
+            effect.volume = command.value;
+            if(loop_voice) loop_voice->setVolume(command.value);
+            break;
+            
+        case Command::PITCH:
+            effect.pitch = command.value;
+            if(loop_voice) loop_voice->setPitch(command.value);
+            break;
+            
+        case Command::STOP_ALL:
+            for(auto& s : m_voices) s.stop();
+            for(auto& s : m_looping_sounds) s.pause();
+            break;
+    }
+}
+
+const sf::SoundBuffer* Audio::decodedBuffer(std::size_t id) {
+    // Always decoded
+    if(m_effects[id].file.empty()) return &m_effects[id].buffer;
+    
+    ++m_use_counter;
+    
+    // Already in the cache
+    for(auto& slot : m_cache) {
+        if(slot.sound == id) {
+            slot.last_used = m_use_counter;
+            return &slot.buffer;
+        }
+    }
+    
+    // Refill the least recently used slot. Slots a voice still plays are skipped, refilling one
+    // would cut that sound off, so with all of them playing the new sound is dropped.
+    CacheSlot* victim = nullptr;
+    for(auto& slot : m_cache) {
+        if(slot.sound != NONE && isPlaying(slot.buffer)) continue;
+        if(!victim || slot.last_used < victim->last_used) victim = &slot;
+    }
+    if(!victim) return nullptr;
+    
+    const std::vector<char>& file = m_effects[id].file;
+    if(!victim->buffer.loadFromMemory(file.data(), file.size())) {
+        victim->sound = NONE;
+        return nullptr;
+    }
+    
+    victim->sound = id;
+    victim->last_used = m_use_counter;
+    return &victim->buffer;
+}
+
+// RIFF is the header of WAV files
+bool Audio::isUncompressed(const std::vector<char>& file) {
+    return file.size() >= 4 && file[0] == 'R' && file[1] == 'I' && file[2] == 'F' && file[3] == 'F';
+}
+
+bool Audio::isPlaying(const sf::SoundBuffer& buffer) const {
+    for(auto& s : m_voices)
+        if(s.getBuffer() == &buffer && s.getStatus() == sf::Sound::Playing) return true;
+    return false;
+}
+
+sf::Sound& Audio::freeVoice() {
+    // Pick a voice that is done playing
+    for(auto& s : m_voices)
+        if(s.getStatus() == sf::Sound::Stopped) return s;
+    
+    // All busy, cut the first one
+    m_voices.front().stop();
+    return m_voices.front();
+}
@@ -0,0 +1,98 @@
+#ifndef Audio_hpp
+#define Audio_hpp
+
+#include <SFML/Audio.hpp>
+#include <unordered_map>
+#include <vector>
+#include <atomic>
+#include <thread>
+
+#include "Library/SpscQueue.hpp"
+
+// Owns every sound effect and plays them on its own thread.
+// Game thread only pushes small commands, it never waits for the audio backend.
+class Audio {
+public:
+    Audio();
+    ~Audio();
+    
+    // Called before start()
+    // With a cache size, compressed one-shot sounds stay compressed in memory and are decoded
+    // when played. WAV files are always decoded up front.
+    void setCacheSize(std::size_t cache_size);
+    bool loadSound(const std::string& name, const std::string& file_name, bool looping = false);
+    
+    // Global, stop() unloads every sound
+    void start();
+    void stop();
+    
+    // Commands, game thread only
+    void play(const std::string& name);
+    void setLoop(const std::string& name, bool loop);
+    void setVolume(const std::string& name, float volume);
+    void setPitch(const std::string& name, float pitch);
+    void stopAll();
+    
+private:
+// Types
+    struct Command {
+        enum TYPE { PLAY, START_LOOP, STOP_LOOP, VOLUME, PITCH, STOP_ALL };
+        TYPE type;
+        std::size_t sound;
+        float value;
+    };
+    
+    struct Effect {
+        std::vector<char> file;     // Encoded file, empty if always decoded
+        sf::SoundBuffer buffer;     // Only filled if always decoded
+        std::size_t loop_voice;     // Index in m_looping_sounds, NONE for one-shots
+        float volume;
+        float pitch;
+    };
+    
+    struct CacheSlot {
+        sf::SoundBuffer buffer;
+        std::size_t sound;
+        unsigned long last_used;
+    };
+    
+    static const std::size_t NONE = static_cast<std::size_t>(-1);
+    
+// Functions
+    // Game thread
+    void send(Command::TYPE type, const std::string& name, float value = 0);
+    
+    // Audio thread
+    void threadLoop();
+    void execute(const Command& command);
+    sf::Sound& freeVoice();
+    const sf::SoundBuffer* decodedBuffer(std::size_t id);
+    bool isPlaying(const sf::SoundBuffer& buffer) const;
+    static bool isUncompressed(const std::vector<char>& file);
+    
+// Variables
+    // Sounds, indexed by the ids in m_ids
+    std::unordered_map<std::string, std::size_t> m_ids;
+    std::vector<Effect> m_effects;
+    std::vector<sf::Sound> m_looping_sounds;
+    
+    // Decoded one-shots, least recently used slot is refilled first
+    std::vector<CacheSlot> m_cache;
+    std::size_t m_cache_size;
+    unsigned long m_use_counter;
+    
+    // One-shot voices, reused instead of created per play
+    std::vector<sf::Sound> m_voices;
+    const std::size_t m_voice_count;
+    
+    // Loop state as last requested by the game thread, repeated requests are dropped
+    std::vector<bool> m_loop_requested;
+    
+    // Thread
+    SpscQueue<Command, 64> m_commands;
+    std::thread m_thread;
+    std::atomic<bool> m_running;
+    const sf::Time m_idle_sleep;
+};
+
+#endif /* Audio_hpp */
@@ -0,0 +1,63 @@
+#include "Bot.hpp"
+
+#include <cmath>
+
+Bot::Bot(unsigned seed, float skill) :
+    m_random(seed),
+    m_chance(0, 1),
+    m_skill(skill),
+    m_danger_distance(90),
+    m_last_input(0) {}
+
+World::Input Bot::decide(const World& world) {
+    // Missed this tick, keep doing the same thing
+    if(m_chance(m_random) > m_skill) return m_last_input;
+    
+    World::Input input = 0;
+    
+    // Keep pressing enter on the info screens
+    if(world.inInfoScreen()) return m_last_input = World::INPUT_CONFIRM;
+    
+    const Player& player = world.getPlayer();
+    if(player.getState() != Player::FREE) return m_last_input = 0;
+    
+    const int floor = player.getFloor();
+    const float x = static_cast<float>(player.getX());
+    const float width = world.getViewSize().x;
+    
+    // Hole above, jump through it unless a hazard is about to hit
+    bool hole_above = false;
+    for(auto& hole : world.getHoles()) if(hole->collides(floor, x)) hole_above = true;
+    
+    bool hazard_here = false;
+    for(auto& hazard : world.getHazards()) if(hazard->collides(floor, x)) hazard_here = true;
+    
+    if(hole_above && !hazard_here) return m_last_input = World::INPUT_JUMP;
+    
+    // Distance an entity still has to travel to reach us, screen wraps
+    auto distanceTo = [&](const Entity& e) {
+        return std::fmod((x - static_cast<float>(e.getX())) * e.getDirection() + width, width);
+    };
+    
+    // Walk towards the closest hole above that is coming to us
+    float target_distance = width;
+    for(auto& hole : world.getHoles()) {
+        if(hole->getFloor() != floor || hole->getDirection() == 0) continue;
+        
+        float distance = distanceTo(*hole);
+        if(distance < target_distance) {
+            target_distance = distance;
+            input = hole->getDirection() > 0 ? World::INPUT_LEFT : World::INPUT_RIGHT;
+        }
+    }
+    
+    // Step away from holes below and hazards that come closer, in the direction they move
+    auto dodge = [&](const Entity& e, int e_floor) {
+        if(e.getFloor() != e_floor || e.getDirection() == 0) return;
+        if(distanceTo(e) < m_danger_distance) input = e.getDirection() > 0 ? World::INPUT_RIGHT : World::INPUT_LEFT;
+    };
+    for(auto& hole : world.getHoles()) dodge(*hole, floor + 1);
+    for(auto& hazard : world.getHazards()) dodge(*hazard, floor);
+    
+    return m_last_input = input;
+}
@@ -0,0 +1,24 @@
+#ifndef Bot_hpp
+#define Bot_hpp
+
+#include <random>
+
+#include "World.hpp"
+
+// Simple reactive player, used to score generated levels.
+// Lower skill means slower and more random reactions, like a weaker human player.
+class Bot {
+public:
+    Bot(unsigned seed, float skill);
+    
+    World::Input decide(const World& world);
+    
+private:
+    std::mt19937 m_random;
+    std::uniform_real_distribution<float> m_chance;
+    const float m_skill;
+    const float m_danger_distance;
+    World::Input m_last_input;
+};
+
+#endif /* Bot_hpp */
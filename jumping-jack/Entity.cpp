@@ -1,23 +1,34 @@
 #include "Entity.hpp"
 #include "Library/Utility.hpp"
 
-#include "Game.hpp"
+#include <algorithm>
+#include <cmath>
 
-Entity::Entity() : Entity(true) {}
+#include "World.hpp"
 
-Entity::Entity(bool changes_floor_on_edge, float collision_size_x) :
+Entity::Entity(World& world, bool changes_floor_on_edge, Real collision_size_x) :
+    m_world(&world),
     m_direction(-1),
+    m_floor(0),
+    m_x(0),
     m_collision_size_x(collision_size_x),
+    m_type(0),
     m_facing(m_direction),
     m_draw_offset_y(0),
+    m_animation_start(0),
+    m_animations(),
     m_sprite_color(sf::Color::White),
-    m_movement_speed(300),
+    m_spawn_movement_speed(300),
+    m_movement_speed(m_spawn_movement_speed),
+    m_path_start(0),
+    m_path_time(0),
+    m_lap_floors(1),
     m_changes_floor_on_edge(changes_floor_on_edge),
     m_scale(0.35) {
     
     // Middle bottom is the origin
-    setOrigin(sf::Vector2f(0.5f*Game::i().getSpritesheetBlockSize(),
-                           2.0f*Game::i().getSpritesheetBlockSize()));
+    setOrigin(sf::Vector2f(0.5f*m_world->getSpritesheetBlockSize(),
+                           2.0f*m_world->getSpritesheetBlockSize()));
     setScale(m_scale, m_scale);
     
     // Animation
@@ -25,17 +36,84 @@ Entity::Entity(bool changes_floor_on_edge, float collision_size_x) :
 }
 
 void Entity::spawn(bool random_position, const std::string& name, int direction) {
-    m_sprite_name = name;
-    m_floor = getSpawnFloor();
+    int floor = getSpawnFloor();
     
     // Pick middle or a random position
-    setPosition(
-        random_position ? random_float(0, Game::i().getViewSize().x) : Game::i().getViewSize().x*0.5f,
-        m_floor * Game::i().getFloorHeight()
-    );
+    const Real width = m_world->getViewSize().x;
+    Real x = random_position ? random_real(m_world->getRandom(), 0, width) : width*0.5f;
     
     // Set direction if given, if not, pick random
-    m_direction = direction != PICK_RANDOMLY ? direction : random_int(0, 1) ? 1 : -1;
+    spawnAt(floor, x, name, direction != PICK_RANDOMLY ? direction : random_int(m_world->getRandom(), 0, 1) ? 1 : -1);
+}
+
+void Entity::spawnAt(int floor, Real x, const std::string& name, int direction) {
+    m_sprite_name = name;
+    m_floor = floor;
+    m_x = x;
+    m_direction = direction;
+    resetState();
+    resetPath();
+    restartAnimation();
+    
+    // Looked up once here instead of on every draw
+    std::fill(m_animations, m_animations + ANIMATION_COUNT, nullptr);
+    if(m_sprite_name != "" && m_world->hasAnimations()) findAnimations();
+}
+
+// Back to how it was made, entities are reused from pools
+void Entity::resetState() {
+    m_facing = -1;
+    m_draw_offset_y = 0;
+    m_sprite_color = sf::Color::White;
+    m_movement_speed = m_spawn_movement_speed;
+}
+
+// Starts a new path from the current location and time
+void Entity::resetPath() {
+    const Real width = m_world->getViewSize().x;
+    m_path_start = m_floor * width + m_x;
+    m_path_time = m_world->getEntityTime();
+    
+    // Floors passed until it comes back to the same place
+    m_lap_floors = m_changes_floor_on_edge ? getLowestFloor() + 1 : 1;
+}
+
+// Location at any world entity time, going off the left edge moves up a floor and off the
+// right edge moves down, so the floor and x are one unrolled position modulo the lap.
+Entity::Location Entity::getLocationAt(Real time) const {
+    const Real width = m_world->getViewSize().x;
+    
+    // Position in floors, wrapped to the lap. Truncating instead of std::floor, this runs for
+    // every entity on every tick and floor is a library call without SSE4.
+    Real position = (m_path_start + m_movement_speed * m_direction * (time - m_path_time)) / width;
+    position -= m_lap_floors * static_cast<Real>(static_cast<long>(position / m_lap_floors));
+    if(position < 0) position += m_lap_floors;
+    
+    const int floor = std::min(static_cast<int>(position), m_lap_floors - 1);
+    
+    Location location;
+    location.floor = m_changes_floor_on_edge ? floor : m_floor;
+    location.x = (position - floor) * width;
+    return location;
+}
+
+// First time at or after the given one when this is at the given location, REAL_MAX if never
+Real Entity::getArrivalTime(int floor, Real x, Real after_time) const {
+    if(m_direction == 0 || m_movement_speed <= 0) return REAL_MAX;
+    if(!m_changes_floor_on_edge && floor != m_floor) return REAL_MAX;
+    
+    const Real width = m_world->getViewSize().x;
+    
+    const Real target = (m_changes_floor_on_edge ? floor : m_floor) * width + x;
+    const Real current = m_path_start + m_movement_speed * m_direction * (after_time - m_path_time);
+    
+    const Real lap = m_lap_floors * width;
+    
+    Real distance = (target - current) * m_direction;
+    distance -= lap * static_cast<Real>(static_cast<long>(distance / lap));
+    if(distance < 0) distance += lap;
+    
+    return after_time + distance / m_movement_speed;
 }
 
 void Entity::moveUp(bool allow_top_climb) {
@@ -43,10 +121,6 @@ void Entity::moveUp(bool allow_top_climb) {
     if(!allow_top_climb && m_floor <= 0) m_floor = getLowestFloor();
     // Go to upper floor
     else --m_floor;
-    
-    // Update sprite Y position
-    setPositionY(m_floor * Game::i().getFloorHeight());
-
 }
 
 void Entity::moveDown() {
@@ -54,113 +128,240 @@ void Entity::moveDown() {
     if(m_floor >= getLowestFloor()) m_floor = 0;
     // Go to lower floor
     else ++m_floor;
-    
-    // Update sprite Y position
-    setPositionY(m_floor * Game::i().getFloorHeight());
 }
 
-void Entity::updateFacing(float /* dt */) {
+void Entity::updateFacing(Real /* dt */) {
     // Movement direction is the facing direction by default
     m_facing = m_direction;
 }
 
-void Entity::update(float dt) {
-    // Move
-    setPositionX(getPosition().x + m_movement_speed * m_direction * dt);
-    
-    // If going left
-    if(m_direction == -1) {
-        // Reached to the left edge
-        if(getPosition().x < 0) {
-            setPositionX(Game::i().getViewSize().x);
-            
-            // Move to upper floor
-            if(m_changes_floor_on_edge) moveUp();
-        }
-    }
-    // If going right
-    else if(m_direction == 1) {
-        // Reached to the right edge
-        if(getPosition().x > Game::i().getViewSize().x) {
-            setPositionX(0);
-            
-            // Move to bottom floor
-            if(m_changes_floor_on_edge) moveDown();
-        }
-    }
+// Follows the path, no matter how much time passed since the last update
+void Entity::move(Real /* dt */) {
+    Location location = getLocationAt(m_world->getEntityTime());
+    m_floor = location.floor;
+    m_x = location.x;
+}
+
+void Entity::update(Real dt) {
+    move(dt);
     
     updateFacing(dt);
-    
-    // If this entity has a sprite
-    if(m_sprite_name != "") {
-        changeAnimations();
-        AnimatedSprite::updateAnim(dt);
-    }
-    
-    // Update transparency
-    if(m_sprite_color.r > 230 &&
-       m_sprite_color.g > 230 &&
-       m_sprite_color.b > 230) m_sprite_color.a = 255;
-    else m_sprite_color.a = 55 + 200*(0.5f + 0.5f*sin(35*Game::i().getGlobalTimer()));
-    
-    // Turn to facing direction
-    setScale((m_facing == 0 ? 1 : m_facing) * m_scale, m_scale);
 }
 
-bool Entity::collides(int floor, float x) {
+// Takes the state of another entity of the same type, used when copying worlds.
+// The animation frame is worked out again when drawn.
+void Entity::copyState(const Entity& other) {
+    m_direction = other.m_direction;
+    m_floor = other.m_floor;
+    m_x = other.m_x;
+    m_sprite_name = other.m_sprite_name;
+    m_type = other.m_type;
+    m_facing = other.m_facing;
+    m_draw_offset_y = other.m_draw_offset_y;
+    m_animation_start = other.m_animation_start;
+    std::copy(other.m_animations, other.m_animations + ANIMATION_COUNT, m_animations);
+    m_sprite_color = other.m_sprite_color;
+    m_movement_speed = other.m_movement_speed;
+    m_path_start = other.m_path_start;
+    m_path_time = other.m_path_time;
+    m_lap_floors = other.m_lap_floors;
+}
+
+// Everything that changes how the game plays out, the animation frame and sprite don't
+void Entity::hashState(StateHash& hash) const {
+    hash.add(static_cast<std::int32_t>(m_direction));
+    hash.add(static_cast<std::int32_t>(m_floor));
+    hash.add(m_x);
+    hash.add(static_cast<std::int32_t>(m_facing));
+    hash.add(m_draw_offset_y);
+    hash.add(m_sprite_color.toInteger());
+    hash.add(m_movement_speed);
+    hash.add(m_path_start);
+    hash.add(m_path_time);
+}
+
+// What changes from tick to tick, also what is shown. The animation frame follows from when the
+// animation started and which way it faces.
+std::uint64_t Entity::hashTick() const {
+    const std::int32_t place[2] = { m_floor, m_direction * 4 + m_facing };
+    TickHash hash;
+    hash.add(place);
+    hash.add(m_x);
+    hash.add(m_animation_start);
+    return hash.get();
+}
+
+bool Entity::collides(int floor, Real x) const {
     // Check if it's same floor and given x is inside the bounds of this object
-    return floor == m_floor && (x >= getPosition().x - m_collision_size_x*0.5f &&
-                                x <= getPosition().x + m_collision_size_x*0.5f);
+    return floor == m_floor && (x >= m_x - m_collision_size_x*0.5f &&
+                                x <= m_x + m_collision_size_x*0.5f);
+}
+
+void Entity::findAnimations() {
+    findAnimation(ANIMATION::STAND_MID, "stand_mid");
+    findAnimation(ANIMATION::STAND_SIDE, "stand_side");
+    findAnimation(ANIMATION::WALK, "walk");
+}
+
+// Names are only needed for the lookup, so they go to the level arena
+void Entity::findAnimation(ANIMATION animation, const char* suffix) {
+    m_animations[animation] = m_world->getAnimation(m_world->getLevelArena().format("%s_%s", m_sprite_name.c_str(), suffix));
 }
 
-void Entity::changeAnimations() {
+Entity::ANIMATION Entity::pickAnimation() const {
     // If standing
     if(m_direction == 0) {
-        if(m_facing == 0) play(Game::i().getAnimation(m_sprite_name + "_stand_mid"));
-        else play(Game::i().getAnimation(m_sprite_name + "_stand_side"));
+        if(m_facing == 0) return ANIMATION::STAND_MID;
+        else return ANIMATION::STAND_SIDE;
     }
     // If walking
     else {
-        play(Game::i().getAnimation(m_sprite_name + "_walk"));
+        return ANIMATION::WALK;
     }
 }
 
+// Animations are timed from here, call when the animation to show changes
+void Entity::restartAnimation() {
+    m_animation_start = getAnimationClock();
+}
+
+// Holes and hazards animate in slow motion too
+Real Entity::getAnimationClock() const {
+    return m_world->getEntityTime();
+}
+
+void Entity::playAnimation(ANIMATION animation) {
+    if(m_animations[animation]) play(*m_animations[animation]);
+}
+
 void Entity::drawSelf(sf::RenderTarget& target) {
     target.draw(*this);
 }
 
+// The simulation only keeps numbers, the sprite is placed, turned and animated from them here
 void Entity::render(sf::RenderTarget& target) {
-    setColor(m_sprite_color);
+    // Animation frame follows from the time since it started, only worked out when drawn
+    if(m_sprite_name != "" && m_world->hasAnimations()) {
+        playAnimation(pickAnimation());
+        setTime(sf::seconds(static_cast<float>(getAnimationClock() - m_animation_start)));
+    }
     
-    // Save location
-    sf::Vector2f pos = getPosition();
+    // Transparency, flashes unless the color is close to white
+    sf::Color color = m_sprite_color;
+    if(color.r > 230 && color.g > 230 && color.b > 230) color.a = 255;
+    else color.a = 55 + 200*(0.5f + 0.5f*sin(35*static_cast<float>(m_world->getGlobalTimer())));
+    setColor(color);
     
-    // Draw original
-    float animated_y = pos.y + Game::i().getFloorHeight() + m_draw_offset_y;
-    setPositionY(animated_y);
-    drawSelf(target);
+    // Turn to facing direction
+    setScale((m_facing == 0 ? 1 : m_facing) * m_scale, m_scale);
     
-    // Screen Wrapping
-    {
-        // Draw left copy
-        setPositionX(pos.x - Game::i().getViewSize().x);
-        if(m_changes_floor_on_edge) setPositionY(animated_y + (m_floor == getLowestFloor() ? -getLowestFloor() : 1)*Game::i().getFloorHeight());
-        drawSelf(target);
-        
-        // Draw right copy
-        setPositionX(pos.x + Game::i().getViewSize().x);
-        if(m_changes_floor_on_edge) setPositionY(animated_y - (m_floor == 0 ? -getLowestFloor() : 1)*Game::i().getFloorHeight());
+    // Location
+    const sf::Vector2f pos(static_cast<float>(m_x), m_floor * m_world->getFloorHeight());
+    const float animated_y = pos.y + m_world->getFloorHeight() + static_cast<float>(m_draw_offset_y);
+    
+    // Draw original and the copies over the edges. Holes have no animation, only their size.
+    const float width = getAnimation() ? std::max(static_cast<float>(m_collision_size_x), getGlobalBounds().width) : static_cast<float>(m_collision_size_x);
+    const float half_extent = 0.5f * width;
+    sf::Vector2f positions[3];
+    const int position_count = getWrapPositions(m_floor, pos.x, animated_y, half_extent, positions);
+    for(int i = 0; i < position_count; ++i) {
+        setPosition(positions[i]);
         drawSelf(target);
     }
     
-    // Recover location
+    // Leave it at the location
     setPosition(pos);
 }
 
+// Screen wrapping, the original position comes first and then the copies, they only show while
+// hanging over an edge. Returns how many there are.
+int Entity::getWrapPositions(int floor, float x, float y, float half_extent, sf::Vector2f* positions) const {
+    const float width = m_world->getViewSize().x;
+    const float floor_height = m_world->getFloorHeight();
+    
+    int count = 0;
+    positions[count++] = sf::Vector2f(x, y);
+    if(x > width - half_extent) {
+        // Left copy
+        const float copy_y = m_changes_floor_on_edge ? y + (floor == getLowestFloor() ? -getLowestFloor() : 1)*floor_height : y;
+        positions[count++] = sf::Vector2f(x - width, copy_y);
+    }
+    if(x < half_extent) {
+        // Right copy
+        const float copy_y = m_changes_floor_on_edge ? y - (floor == 0 ? -getLowestFloor() : 1)*floor_height : y;
+        positions[count++] = sf::Vector2f(x + width, copy_y);
+    }
+    return count;
+}
+
+Entity::Look Entity::getLook() const {
+    Look look;
+    look.floor = m_floor;
+    look.x = static_cast<float>(m_x);
+    look.draw_offset_y = static_cast<float>(m_draw_offset_y);
+    look.animation = static_cast<std::uint8_t>(pickAnimation());
+    look.facing = static_cast<std::int8_t>(m_facing);
+    
+    // The frame render() would pick, without changing the sprite
+    const Animation* animation = m_animations[look.animation];
+    const sf::Time time = sf::seconds(static_cast<float>(getAnimationClock() - m_animation_start));
+    look.frame = animation ? static_cast<std::uint8_t>(getFrameAt(*animation, time)) : 0;
+    return look;
+}
+
+// Adds the quads render() would draw for the look, so many looks can go out in one draw. They
+// all have to be of animations on the same sprite sheet.
+void Entity::appendLook(const Look& look, const sf::Color& color, sf::VertexArray& vertices) const {
+    const Animation* animation = look.animation < ANIMATION_COUNT ? m_animations[look.animation] : nullptr;
+    if(!animation || look.frame >= animation->getSize()) return;
+    
+    // Corners and texture coordinates like AnimatedSprite, turned and scaled around the origin
+    const sf::IntRect& rect = animation->getFrame(look.frame);
+    const sf::Vector2f scale((look.facing == 0 ? 1 : look.facing) * m_scale, m_scale);
+    const sf::Vector2f origin = getOrigin();
+    const float width = static_cast<float>(rect.width);
+    const float height = static_cast<float>(rect.height);
+    const float left = static_cast<float>(rect.left) + 0.0001f;
+    const float top = static_cast<float>(rect.top);
+    const sf::Vector2f corners[4] = {
+        sf::Vector2f(0, 0), sf::Vector2f(0, height), sf::Vector2f(width, height), sf::Vector2f(width, 0)
+    };
+    const sf::Vector2f tex_coords[4] = {
+        sf::Vector2f(left, top), sf::Vector2f(left, top + height), sf::Vector2f(left + width, top + height), sf::Vector2f(left + width, top)
+    };
+    
+    const float floor_height = m_world->getFloorHeight();
+    const float y = (look.floor + 1)*floor_height + look.draw_offset_y;
+    const float half_extent = 0.5f * std::max(static_cast<float>(m_collision_size_x), std::abs(width * m_scale));
+    sf::Vector2f positions[3];
+    const int position_count = getWrapPositions(look.floor, look.x, y, half_extent, positions);
+    for(int i = 0; i < position_count; ++i) {
+        for(int corner = 0; corner < 4; ++corner) {
+            const sf::Vector2f offset = corners[corner] - origin;
+            vertices.append(sf::Vertex(positions[i] + sf::Vector2f(offset.x * scale.x, offset.y * scale.y), color, tex_coords[corner]));
+        }
+    }
+}
+
+// The clock this is timed by was moved back, so are the times taken from it
+void Entity::shiftClock(Real time) {
+    m_path_time -= time;
+    m_animation_start -= time;
+}
+
 // Getters
-int Entity::getLowestFloor() { return Game::i().getBottomFloor() - 1; }
-int Entity::getSpawnFloor() { return random_int(0, getLowestFloor()); }
+int Entity::getFloor() const { return m_floor; }
+Real Entity::getX() const { return m_x; }
+Real Entity::getDrawOffsetY() const { return m_draw_offset_y; }
+int Entity::getDirection() const { return m_direction; }
+Real Entity::getMovementSpeed() const { return m_movement_speed; }
+Real Entity::getCollisionSizeX() const { return m_collision_size_x; }
+std::size_t Entity::getType() const { return m_type; }
+int Entity::getLowestFloor() const { return m_world->getBottomFloor() - 1; }
+int Entity::getSpawnFloor() { return random_int(m_world->getRandom(), 0, getLowestFloor()); }
 
 // Setters
+void Entity::setMovementSpeed(Real speed) { m_movement_speed = speed; resetPath(); }
+void Entity::setType(std::size_t type) { m_type = type; }
 void Entity::setPositionX(float x) { setPosition(x, getPosition().y); }
 void Entity::setPositionY(float y) { setPosition(getPosition().x, y); }
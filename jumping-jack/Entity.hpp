@@ -1,58 +1,117 @@
 #ifndef Entity_hpp
 #define Entity_hpp
 
+#include <SFML/Graphics/VertexArray.hpp>
+
 #include "Library/AnimatedSprite.hpp"
+#include "Real.hpp"
+
+class World;
 
 class Entity : public AnimatedSprite {
 public:
-    Entity();
-    Entity(bool changes_floor_on_edge, float collision_box_x = 20);
+    Entity(World& world, bool changes_floor_on_edge = true, Real collision_box_x = 20);
     
     // Global
-    virtual void update(float dt);
+    virtual void update(Real dt);
+    virtual void copyState(const Entity& other);
+    virtual void hashState(StateHash& hash) const;
+    virtual std::uint64_t hashTick() const;
     void render(sf::RenderTarget& target);
     
+    // What render() shows, one of these a tick is enough to draw the entity again later
+    struct Look {
+        int floor;
+        float x;
+        float draw_offset_y;
+        std::uint8_t animation;
+        std::uint8_t frame;
+        std::int8_t facing;
+    };
+    Look getLook() const;
+    void appendLook(const Look& look, const sf::Color& color, sf::VertexArray& vertices) const;
+    
     // Gameplay
     static const int PICK_RANDOMLY = 1337;
     void spawn(bool random_position, const std::string& name, int direction = PICK_RANDOMLY);
-    bool collides(int floor, float x);
+    void spawnAt(int floor, Real x, const std::string& name, int direction);
+    bool collides(int floor, Real x) const;
+    
+    // Trajectory, holes and hazards only move along a straight path that wraps over the floors
+    struct Location {
+        int floor;
+        Real x;
+    };
+    Location getLocationAt(Real time) const;
+    Real getArrivalTime(int floor, Real x, Real after_time) const;
+    
+    // Getters
+    int getFloor() const;
+    Real getX() const;
+    Real getDrawOffsetY() const;
+    int getDirection() const;
+    Real getMovementSpeed() const;
+    Real getCollisionSizeX() const;
+    std::size_t getType() const;
+    
+    // Setters
+    void setMovementSpeed(Real speed);
+    void setType(std::size_t type);
+    void shiftClock(Real time);
     
 protected:
 // Functions
     // Gameplay
     void moveUp(bool allow_top_climb = false);
     void moveDown();
+    virtual void move(Real dt);
+    virtual void resetState();
+    void resetPath();
     
-    virtual int getLowestFloor();
+    virtual int getLowestFloor() const;
     virtual int getSpawnFloor();
 
-    virtual void updateFacing(float dt);
+    virtual void updateFacing(Real dt);
     
     // Render
-    virtual void changeAnimations();
+    enum ANIMATION { STAND_MID, STAND_SIDE, WALK, STUN, FALL, CLIMB, JUMP, ANIMATION_COUNT };
+    virtual void findAnimations();
+    void findAnimation(ANIMATION animation, const char* suffix);
+    virtual ANIMATION pickAnimation() const;
     virtual void drawSelf(sf::RenderTarget& target);
+    int getWrapPositions(int floor, float x, float y, float half_extent, sf::Vector2f* positions) const;
+    void playAnimation(ANIMATION animation);
+    void restartAnimation();
+    virtual Real getAnimationClock() const;
+    void setPositionX(float x);
+    void setPositionY(float y);
     
 // Variables
-    // Gameplay
+    World* m_world;
+    
+    // Gameplay, the sprite is only moved here when drawn
     int m_direction;
     int m_floor;
-    const float m_collision_size_x;
+    Real m_x;
+    const Real m_collision_size_x;
     std::string m_sprite_name;
+    std::size_t m_type; // Which of the manifest's hazards, 0 for the rest
     
     // Render
     int m_facing;
-    float m_draw_offset_y;
+    Real m_draw_offset_y;
+    Real m_animation_start;
+    const Animation* m_animations[ANIMATION_COUNT];
     sf::Color m_sprite_color;
     
 private:
-// Functions
-    // Render
-    void setPositionX(float x);
-    void setPositionY(float y);
-    
 // Variables
     // Gameplay
-    const float m_movement_speed;
+    const Real m_spawn_movement_speed;
+    Real m_movement_speed;
+    Real m_path_start; // Unrolled position, floor * view width + x
+    Real m_path_time;  // World entity time at the start of the path
+    int m_lap_floors;
     const bool m_changes_floor_on_edge;
     
     // Render
@@ -0,0 +1,188 @@
+#include "FlightRecorder.hpp"
+
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "World.hpp"
+
+// A dump is the header and then the records oldest first, each as its header and value words
+namespace {
+    const char MAGIC[4] = { 'J', 'J', 'F', 'R' };
+    const std::uint32_t VERSION = 1;
+    
+    struct Header {
+        char magic[4];
+        std::uint32_t version;
+    };
+    
+    const std::uint64_t EMPTY = ~0ull; // Index of a slot that is being written or never was
+    const std::size_t BATCH_SIZE = 256; // Records written at once while dumping
+    
+    // write() may take only part of it
+    bool writeAll(int file, const void* data, std::size_t size) {
+        const char* bytes = static_cast<const char*>(data);
+        while(size > 0) {
+            const ssize_t written = ::write(file, bytes, size);
+            if(written <= 0) return false;
+            bytes += written;
+            size -= static_cast<std::size_t>(written);
+        }
+        return true;
+    }
+}
+
+std::atomic<FlightRecorder*> FlightRecorder::m_crash_recorder(nullptr);
+
+FlightRecorder::FlightRecorder() :
+    m_next_index(0),
+    m_tick(0),
+    m_dump_file() {
+    
+    for(Slot& slot : m_slots) {
+        slot.index.store(EMPTY, std::memory_order_relaxed);
+        slot.header.store(0, std::memory_order_relaxed);
+        slot.value.store(0, std::memory_order_relaxed);
+    }
+    
+    const char* directory = std::getenv("TMPDIR");
+    setDumpFile(std::string(directory ? directory : "/tmp") + "/jumping-jack.jjfr");
+}
+
+FlightRecorder::~FlightRecorder() {
+    FlightRecorder* self = this;
+    m_crash_recorder.compare_exchange_strong(self, nullptr);
+}
+
+// Recording
+void FlightRecorder::recordTick(std::uint8_t input, std::uint64_t tick_hash) {
+    record(TICK, input, 0, 0, tick_hash);
+    m_tick.fetch_add(1, std::memory_order_relaxed);
+}
+
+void FlightRecorder::recordEvent(std::uint8_t event) { record(EVENT, event, 0, 0, 0); }
+void FlightRecorder::recordStateChange(std::uint8_t from, std::uint8_t trigger, std::uint8_t to) { record(STATE_CHANGE, from, trigger, to, 0); }
+void FlightRecorder::recordFrame(std::uint32_t microseconds) { record(FRAME, 0, 0, 0, microseconds); }
+
+void FlightRecorder::record(KIND kind, std::uint8_t a, std::uint8_t b, std::uint8_t c, std::uint64_t value) {
+    const std::uint64_t index = m_next_index.fetch_add(1, std::memory_order_relaxed);
+    Slot& slot = m_slots[index % CAPACITY];
+    
+    slot.index.store(EMPTY, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    
+    const std::uint64_t header = m_tick.load(std::memory_order_relaxed) | static_cast<std::uint64_t>(kind) << 32 |
+                                 static_cast<std::uint64_t>(a) << 40 | static_cast<std::uint64_t>(b) << 48 |
+                                 static_cast<std::uint64_t>(c) << 56;
+    slot.header.store(header, std::memory_order_relaxed);
+    slot.value.store(value, std::memory_order_relaxed);
+    slot.index.store(index, std::memory_order_release);
+}
+
+// Dumping
+// Called before installCrashHandler(), the crash handler reads it
+void FlightRecorder::setDumpFile(const std::string& file_name) {
+    std::strncpy(m_dump_file, file_name.c_str(), sizeof(m_dump_file) - 1);
+    m_dump_file[sizeof(m_dump_file) - 1] = '\0';
+}
+
+const char* FlightRecorder::getDumpFile() const { return m_dump_file; }
+
+// Only uses calls that are safe in a signal handler, the crash handler dumps with it too
+bool FlightRecorder::dump() const {
+    const int file = ::open(m_dump_file, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(file < 0) return false;
+    
+    Header header;
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    bool written = writeAll(file, &header, sizeof(header));
+    
+    // Oldest first, a slot written again since it was claimed or still being written is skipped
+    std::uint64_t batch[BATCH_SIZE * 2];
+    std::size_t batch_count = 0;
+    const std::uint64_t end = m_next_index.load(std::memory_order_acquire);
+    for(std::uint64_t index = end > CAPACITY ? end - CAPACITY : 0; index < end; ++index) {
+        const Slot& slot = m_slots[index % CAPACITY];
+        if(slot.index.load(std::memory_order_acquire) != index) continue;
+        
+        const std::uint64_t record_header = slot.header.load(std::memory_order_relaxed);
+        const std::uint64_t record_value = slot.value.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if(slot.index.load(std::memory_order_relaxed) != index) continue;
+        
+        batch[batch_count * 2] = record_header;
+        batch[batch_count * 2 + 1] = record_value;
+        if(++batch_count == BATCH_SIZE) {
+            written = writeAll(file, batch, sizeof(batch)) && written;
+            batch_count = 0;
+        }
+    }
+    written = writeAll(file, batch, batch_count * 2 * sizeof(std::uint64_t)) && written;
+    
+    return ::close(file) == 0 && written;
+}
+
+// Fatal signals dump the recorder and then go on to crash as they would have
+void FlightRecorder::installCrashHandler() {
+    m_crash_recorder = this;
+    for(int signal : { SIGSEGV, SIGBUS, SIGILL, SIGFPE, SIGABRT }) std::signal(signal, &FlightRecorder::onCrash);
+}
+
+void FlightRecorder::onCrash(int signal) {
+    if(const FlightRecorder* recorder = m_crash_recorder.load()) recorder->dump();
+    
+    std::signal(signal, SIG_DFL);
+    std::raise(signal);
+}
+
+// A dump as text, one record per line with the tick first
+bool FlightRecorder::print(const std::string& file_name, std::ostream& out) {
+    std::ifstream file(file_name, std::ios::binary);
+    if(!file) return false;
+    
+    Header header;
+    if(!file.read(reinterpret_cast<char*>(&header), sizeof(header))) return false;
+    if(std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION) return false;
+    
+    std::uint64_t words[2];
+    while(file.read(reinterpret_cast<char*>(words), sizeof(words))) {
+        const std::uint32_t tick = static_cast<std::uint32_t>(words[0]);
+        const unsigned kind = (words[0] >> 32) & 0xFF;
+        const unsigned a = (words[0] >> 40) & 0xFF;
+        const unsigned b = (words[0] >> 48) & 0xFF;
+        const unsigned c = (words[0] >> 56) & 0xFF;
+        
+        out << std::setw(8) << tick << "  ";
+        switch(kind) {
+            case TICK: {
+                const char input[] = {
+                    a & World::INPUT_LEFT ? 'L' : '-', a & World::INPUT_RIGHT ? 'R' : '-',
+                    a & World::INPUT_JUMP ? 'J' : '-', a & World::INPUT_CONFIRM ? 'C' : '-', '\0'
+                };
+                out << "TICK   " << input << " hash " << std::hex << std::setw(16) << std::setfill('0') << words[1]
+                    << std::dec << std::setfill(' ');
+                break;
+            }
+            case EVENT:
+                out << "EVENT  " << World::getEventName(static_cast<World::GAME_EVENT>(a));
+                break;
+            case STATE_CHANGE:
+                out << "STATE  " << Player::getStateName(static_cast<Player::PLAYER_STATE>(a)) << " -"
+                    << Player::getTriggerName(static_cast<Player::TRIGGER>(b)) << "-> "
+                    << Player::getStateName(static_cast<Player::PLAYER_STATE>(c));
+                break;
+            case FRAME:
+                out << "FRAME  " << words[1] / 1000.0 << " ms";
+                break;
+            default:
+                out << "?";
+        }
+        out << '\n';
+    }
+    return true;
+}
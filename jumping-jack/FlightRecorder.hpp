@@ -0,0 +1,61 @@
+#ifndef FlightRecorder_hpp
+#define FlightRecorder_hpp
+
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+// The last half a minute of a session, always kept: the input and tick hash of every tick, game
+// events, player state changes and frame times. Written out on a crash, on game over or when
+// asked, --flight prints a written one.
+// Records go to a fixed ring that any thread can add to without locking or allocating, the
+// oldest are written over. A record that is being written while the ring is dumped is left out.
+class FlightRecorder {
+public:
+    FlightRecorder();
+    ~FlightRecorder();
+    
+    FlightRecorder(const FlightRecorder&) = delete;
+    FlightRecorder& operator=(const FlightRecorder&) = delete;
+    
+    // Recording, events and state changes come before the tick they happened in
+    enum KIND { TICK, EVENT, STATE_CHANGE, FRAME };
+    void recordTick(std::uint8_t input, std::uint64_t tick_hash);
+    void recordEvent(std::uint8_t event);
+    void recordStateChange(std::uint8_t from, std::uint8_t trigger, std::uint8_t to);
+    void recordFrame(std::uint32_t microseconds);
+    
+    // Dumping
+    void setDumpFile(const std::string& file_name);
+    const char* getDumpFile() const;
+    bool dump() const;
+    void installCrashHandler(); // Only the last recorder it was installed for dumps
+    static bool print(const std::string& file_name, std::ostream& out);
+    
+private:
+// Types
+    // Written like a seqlock, the index goes last and a reader that sees it change skips the record
+    struct Slot {
+        std::atomic<std::uint64_t> index;
+        std::atomic<std::uint64_t> header; // Tick, kind and up to three small values
+        std::atomic<std::uint64_t> value;
+    };
+    
+// Functions
+    void record(KIND kind, std::uint8_t a, std::uint8_t b, std::uint8_t c, std::uint64_t value);
+    static void onCrash(int signal);
+    
+// Variables
+    // 30 seconds of ticks and frames at 125 and 60 a second fit with room for the events
+    static const std::size_t CAPACITY = 8192;
+    Slot m_slots[CAPACITY];
+    alignas(64) std::atomic<std::uint64_t> m_next_index;
+    std::atomic<std::uint32_t> m_tick;
+    
+    // Not a std::string, a crash handler can't allocate
+    char m_dump_file[1024];
+    static std::atomic<FlightRecorder*> m_crash_recorder;
+};
+
+#endif /* FlightRecorder_hpp */
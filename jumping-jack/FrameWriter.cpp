@@ -0,0 +1,100 @@
+#include "FrameWriter.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+FrameWriter::FrameWriter(const std::string& path, FORMAT format, std::size_t worker_count, std::size_t max_queued) :
+    m_path(path),
+    m_format(format),
+    m_max_queued(std::max<std::size_t>(max_queued, 1)),
+    m_next_index(0),
+    m_busy(0),
+    m_failed(0),
+    m_quit(false) {
+    
+    if(m_format == RAW) {
+        m_raw.open(m_path, std::ios::binary);
+        worker_count = 1;
+    }
+    else if(worker_count == 0) worker_count = std::max(1u, std::thread::hardware_concurrency());
+    
+    for(std::size_t i = 0; i < worker_count; ++i) m_threads.emplace_back(&FrameWriter::workerLoop, this);
+}
+
+FrameWriter::~FrameWriter() {
+    finish();
+    
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quit = true;
+    }
+    m_queued.notify_all();
+    for(auto& t : m_threads) t.join();
+}
+
+void FrameWriter::write(const sf::Image& frame) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    
+    // Back pressure, the frames would pile up in memory otherwise
+    m_done.wait(lock, [this] { return m_jobs.size() < m_max_queued; });
+    
+    m_jobs.push_back({ m_next_index++, frame });
+    lock.unlock();
+    m_queued.notify_one();
+}
+
+// Waits until every queued frame is written
+void FrameWriter::finish() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [this] { return m_jobs.empty() && m_busy == 0; });
+    
+    if(m_raw.is_open()) m_raw.flush();
+}
+
+void FrameWriter::workerLoop() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while(true) {
+        m_queued.wait(lock, [this] { return m_quit || !m_jobs.empty(); });
+        if(m_jobs.empty()) return;
+        
+        Job job = std::move(m_jobs.front());
+        m_jobs.pop_front();
+        ++m_busy;
+        m_done.notify_all();
+        
+        lock.unlock();
+        encode(job.index, job.frame);
+        lock.lock();
+        
+        --m_busy;
+        m_done.notify_all();
+    }
+}
+
+void FrameWriter::encode(std::size_t index, const sf::Image& frame) {
+    bool written = false;
+    
+    if(m_format == RAW) {
+        const sf::Vector2u size = frame.getSize();
+        m_raw.write(reinterpret_cast<const char*>(frame.getPixelsPtr()), size.x * size.y * 4);
+        written = static_cast<bool>(m_raw);
+    }
+    else {
+        std::ostringstream file_name;
+        file_name << m_path << "/frame_" << std::setw(6) << std::setfill('0') << index << ".png";
+        written = frame.saveToFile(file_name.str());
+    }
+    
+    if(!written) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++m_failed;
+    }
+}
+
+bool FrameWriter::isOpen() const { return m_format != RAW || m_raw.is_open(); }
+
+std::size_t FrameWriter::getFailedCount() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_failed;
+}
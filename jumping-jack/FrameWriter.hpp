@@ -0,0 +1,60 @@
+#ifndef FrameWriter_hpp
+#define FrameWriter_hpp
+
+#include <SFML/Graphics/Image.hpp>
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <deque>
+#include <vector>
+#include <string>
+
+// Encodes rendered frames on background threads, as numbered PNG files in a directory or as one
+// raw RGBA stream (ffmpeg -f rawvideo -pix_fmt rgba). write() only queues the frame, it waits
+// only when the encoders are a whole queue behind.
+class FrameWriter {
+public:
+    enum FORMAT { PNG, RAW };
+    
+    // 0 workers means one per hardware thread, raw frames are always written by one in order
+    FrameWriter(const std::string& path, FORMAT format, std::size_t worker_count = 0, std::size_t max_queued = 8);
+    ~FrameWriter();
+    
+    FrameWriter(const FrameWriter&) = delete;
+    FrameWriter& operator=(const FrameWriter&) = delete;
+    
+    void write(const sf::Image& frame);
+    void finish();
+    
+    bool isOpen() const;
+    std::size_t getFailedCount() const;
+    
+private:
+// Functions
+    void workerLoop();
+    void encode(std::size_t index, const sf::Image& frame);
+    
+// Variables
+    struct Job {
+        std::size_t index;
+        sf::Image frame;
+    };
+    
+    const std::string m_path;
+    const FORMAT m_format;
+    const std::size_t m_max_queued;
+    std::ofstream m_raw;
+    
+    std::vector<std::thread> m_threads;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_queued;
+    std::condition_variable m_done;
+    std::deque<Job> m_jobs;
+    std::size_t m_next_index;
+    std::size_t m_busy;
+    std::size_t m_failed;
+    bool m_quit;
+};
+
+#endif /* FrameWriter_hpp */
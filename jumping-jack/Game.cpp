@@ -1,532 +1,1214 @@
 #include "Game.hpp"
 #include "Library/ResourcePath.hpp"
 
-#include <sstream>
-#include <iomanip>
+#include <fstream>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <algorithm>
+
+#include "LevelGenerator.hpp"
+#include "Bot.hpp"
+#include "Library/AllocationCounter.hpp"
 
 Game Game::m_instance;
 
 Game::Game() :
     m_game_title("JUMPING JACK"),
-    m_background_count(0),
-    m_curr_hazard(0),
-    m_sheet_block_size(128),
-    m_tile_height(32),
-    m_dt(1/125.0f),
-    m_view_size(800, 600),
-    m_global_timer(0),
-    m_timescale(1),
-    m_slow_mo_timescale(0.25f),
-    m_level(0),
-    m_last_level(20),
-    m_game_over(false),
-    m_changing_level(false),
-    m_changing_level_time(6),
-    m_start_health(6),
+    m_sound_cache_size(4),
+    m_theme_level(-1),
+    m_seed(1337),
     m_floor_count(8),
-    m_max_hole_count(8),
-    m_score_base(5),
-    m_highscore(0),
-    m_new_high(false),
-    m_effect_color(sf::Color::Transparent) {}
+    m_endless(false),
+    m_running(false),
+    m_keys(0),
+    m_prev_keys(0),
+    m_paused(false),
+    m_focused(true),
+    m_idle_interval(0.1f),
+    m_idle_poll_interval(1 / 60.0f),
+    m_replay_cheated(false),
+    m_run_cheated(false),
+    m_run_start_tick(NO_RUN),
+    m_ghost_run_start(NO_RUN),
+    m_ghost_vertices(sf::Quads),
+    m_ghost_texture(nullptr),
+    m_versus_local_port(0),
+    m_versus_remote_port(0),
+    m_input_delay(2),
+    m_net_latency(0),
+    m_net_loss(0),
+    m_race_result(Versus::RACING),
+    m_opponent_waiting(false),
+    m_planner(static_cast<unsigned>(std::time(nullptr))),
+    m_autoplay(false),
+    m_generate_levels(false),
+    m_generated_level_count(0),
+    m_stop_generation(false),
+    m_frame_arena(1024),
+    m_text_count(0) {}
 
+// Assets and the world, shared by the window and the offscreen renderer
 void Game::init() {
-    m_line_height = m_view_size.y / m_floor_count;
+    const sf::Vector2f view_size = m_world.getViewSize();
     
-    m_effect_rect.setSize(getViewSize());
+    m_effect_rect.setSize(view_size);
     
     loadAssets();
     
+    m_world.setManifest(m_manifest);
+    m_world.setSize(m_floor_count, m_floor_count);
+    m_world.setEndless(m_endless);
+    m_world.setAnimations(&m_animations);
+    m_world.seed(m_seed);
+    
+    // Create texture for hole rendering
+    m_hole_texture.create(view_size.x, view_size.y);
+    m_sprites["holes"].setTexture(m_hole_texture.getTexture());
+    
+    // Tiles of the current theme, drawn once when it changes. One floor taller than the view so
+    // it can be shifted by the part of a floor the camera is scrolled.
+    m_level_layer.create(view_size.x, view_size.y + m_world.getFloorHeight());
+    m_level_layer.setSmooth(true);
+    m_sprites["level"].setTexture(m_level_layer.getTexture());
+}
+
+// Replays keep the seed they were recorded with, best runs are kept per seed
+void Game::setSeed(unsigned seed) { m_seed = seed; }
+
+// Worlds with more floors than the 8 in view scroll, one hole per floor like the normal size
+void Game::setFloorCount(int floor_count) { m_floor_count = floor_count; }
+void Game::setEndless(bool endless) { m_endless = endless; }
+
+// Replays don't keep the generated layouts, a run on them can't be played back
+void Game::setGenerateLevels(bool generate_levels) { m_generate_levels = generate_levels; }
+void Game::setFlightFile(const std::string& file_name) { m_flight_recorder.setDumpFile(file_name); }
+void Game::setTimeAttack(const std::string& ghost_file) { m_ghost_file = ghost_file; }
+
+void Game::setVersus(std::uint16_t local_port, const std::string& host, std::uint16_t remote_port) {
+    m_versus_local_port = local_port;
+    m_versus_host = host;
+    m_versus_remote_port = remote_port;
+}
+
+// Both players need the same input delay
+void Game::setInputDelay(std::size_t tick_count) { m_input_delay = tick_count; }
+void Game::setSimulatedLink(float latency, float loss) { m_net_latency = latency; m_net_loss = loss; }
+void Game::setBroadcast(const std::string& path) { m_broadcast_path = path; }
+
+void Game::run(const std::string& record_file) {
+    // Initialize the game
+    init();
+    m_world.setFlightRecorder(&m_flight_recorder);
+    m_flight_recorder.installCrashHandler();
+    
     m_music->setVolume(50);
     m_music->play();
+    m_audio.start();
+    
+    startLevelGeneration();
+    m_world.changeLevel(0);
+    m_record_file = record_file;
+    if(!m_record_file.empty()) m_replay.start(m_seed, m_world);
+    
+    // Ghosts of the best runs of this world, if there are any yet
+    if(!m_ghost_file.empty()) {
+        m_best_runs.setWorld(m_seed, m_floor_count, m_endless);
+        m_best_runs.loadFromFile(m_ghost_file);
+        m_ghost_runs = m_best_runs.getRuns();
+        m_ghost_cursors.resize(m_ghost_runs.size());
+        m_ghost_texture = &m_textures["spritesheet_players"];
+        m_run.track.reserve(125 * 60 * 10);
+    }
     
-    changeLevel(0);
+    // Versus, the opponent's world starts the same
+    if(!m_versus_host.empty()) {
+        m_versus.setInputDelay(m_input_delay);
+        m_versus.setSimulatedLink(m_net_latency, m_net_loss);
+        if(m_versus.bind(m_versus_local_port) && m_versus.connect(m_versus_host, m_versus_remote_port)) m_versus.start(m_world);
+        else std::cerr << "Could not connect to " << m_versus_host << ":" << m_versus_remote_port << ", playing alone" << std::endl;
+    }
+    
+    // Spectators see the game from the first level on
+    if(!m_broadcast_path.empty()) {
+        if(m_spectators.listen(m_broadcast_path)) m_spectators.setUp(m_world);
+        else std::cerr << "Could not broadcast on: " << m_broadcast_path << std::endl;
+    }
+    
+    // Snapshots start as the first level, so there is always one to draw
+    for(std::size_t i = 0; i < 3; ++i) {
+        m_snapshots.getSlot(i).setManifest(m_manifest);
+        m_snapshots.getSlot(i).copyState(m_world);
+        m_remote_snapshots.getSlot(i).setManifest(m_manifest);
+        m_remote_snapshots.getSlot(i).copyState(m_world);
+    }
     
-    // Create window
-    m_window.create(sf::VideoMode(m_view_size.x, m_view_size.y), m_game_title, sf::Style::Default);
+    // Create window, twice as wide for versus
+    const sf::Vector2f view_size = m_world.getViewSize();
+    const unsigned view_count = m_versus.isConnected() ? 2 : 1;
+    m_window.create(sf::VideoMode(view_size.x * view_count, view_size.y), m_game_title, sf::Style::Default);
     m_window.setVerticalSyncEnabled(true);
     
-    // Create texture for hole rendering
-    m_hole_texture.create(m_view_size.x, m_view_size.y);
-    m_sprites["holes"].setTexture(m_hole_texture.getTexture());
+    // The world ticks on its own thread, waiting for vsync here doesn't hold it back
+    m_running = true;
+    m_sim_thread = std::thread(&Game::simulate, this);
+    
+    // Window loop
+    bool redraw = true;
+    while(m_window.isOpen()) {
+        // In the background the game is paused, sleep until the window gets an event
+        sf::Event event;
+        if(!m_focused && m_window.waitEvent(event)) redraw |= handleEvent(event);
+        while(m_window.pollEvent(event)) redraw |= handleEvent(event);
+        
+        setSimulationInput(m_focused ? readKeys() : 0, !m_focused);
+        
+        // Draw only when the world changed, static screens change a few times a second
+        if(m_snapshots.update() || redraw) {
+            render();
+            redraw = false;
+        }
+        else sf::sleep(sf::seconds(m_snapshots.getReadBuffer().inInfoScreen() ? m_idle_poll_interval : 0.001f));
+    }
+    
+    // Clean-up
+    {
+        std::lock_guard<std::mutex> lock(m_sim_mutex);
+        m_running = false;
+        m_sim_wake.notify_one();
+    }
+    m_sim_thread.join();
+    m_stop_generation = true;
+    if(m_generator_thread.joinable()) m_generator_thread.join();
+    m_music.reset();
+    m_audio.stop();
+    
+    if(!m_record_file.empty()) {
+        if(m_replay_cheated) std::cerr << "Not saving replay " << m_record_file << ", level cheats changed the game outside its inputs" << std::endl;
+        else if(!m_replay.saveToFile(m_record_file)) std::cerr << "Could not save replay: " << m_record_file << std::endl;
+    }
+    
+    if(m_versus.isConnected()) std::cout << m_versus.getReport();
+    if(m_spectators.isListening()) std::cout << m_spectators.getReport();
+    
+    // Tells if the arenas need to be bigger
+    const Arena& level_arena = m_world.getLevelArena();
+    std::cout << "Frame arena: " << m_frame_arena.getHighWaterMark() << "/" << m_frame_arena.getCapacity() << " bytes, "
+              << m_frame_arena.getOverflowCount() << " overflows" << std::endl;
+    std::cout << "Level arena: " << level_arena.getHighWaterMark() << "/" << level_arena.getCapacity() << " bytes, "
+              << level_arena.getOverflowCount() << " overflows" << std::endl;
+    
+    // How the session went for the player
+    const Player& player = m_world.getPlayer();
+    for(int from = 0; from < Player::STATE_COUNT; ++from) {
+        for(int trigger = 0; trigger < Player::TRIGGER_COUNT; ++trigger) {
+            const auto state = static_cast<Player::PLAYER_STATE>(from);
+            const auto player_trigger = static_cast<Player::TRIGGER>(trigger);
+            if(player.getTransitionCount(state, player_trigger) == 0) continue;
+            
+            std::cout << Player::getStateName(state) << " -" << Player::getTriggerName(player_trigger) << "-> "
+                      << Player::getStateName(Player::getTransitionTarget(state, player_trigger)) << ": "
+                      << player.getTransitionCount(state, player_trigger) << std::endl;
+        }
+    }
 }
 
-// Add a new event to the events list
-void Game::trigger(GAME_EVENT event) { m_events.push_back(event); }
+// Plays a replay back without a window and writes every frame. Drawing goes to two textures in
+// turn, so a frame is read back only after the next one is submitted, and encoding happens on
+// the writer's threads.
+bool Game::renderReplay(const std::string& replay_file, const std::string& output, const sf::Vector2u& size,
+                        unsigned fps, FrameWriter::FORMAT format) {
+    Replay replay;
+    if(!replay.loadFromFile(replay_file)) {
+        std::cerr << "Could not load replay: " << replay_file << std::endl;
+        return false;
+    }
+    
+    // Frames only, no sound
+    init();
+    m_music.reset();
+    replay.setUp(m_world);
+    m_world.changeLevel(0);
+    
+    FrameWriter writer(output, format);
+    if(!writer.isOpen()) {
+        std::cerr << "Could not open: " << output << std::endl;
+        return false;
+    }
+    
+    // Same view as the window, stretched to the output size
+    const sf::Vector2f view_size = m_world.getViewSize();
+    sf::RenderTexture frames[2];
+    for(auto& frame : frames) {
+        if(!frame.create(size.x, size.y)) return false;
+        frame.setView(sf::View(sf::FloatRect(0, 0, view_size.x, view_size.y)));
+    }
+    
+    const float frame_time = 1.0f / std::max(fps, 1u);
+    const float dt = static_cast<float>(m_world.getDt());
+    float accumulator = 0;
+    std::size_t tick = 0;
+    std::size_t current = 0;
+    bool pending = false;
+    while(tick < replay.getTickCount()) {
+        // Update
+        accumulator += frame_time;
+        while(accumulator > dt && tick < replay.getTickCount()) {
+            accumulator -= dt;
+            m_world.update(replay.getInput(tick++));
+            
+            // Level changed
+            if(m_world.getLevel() != m_theme_level) changeTheme(m_world.getLevel());
+        }
+        
+        // Render
+        drawFrame(frames[current], m_world);
+        frames[current].display();
+        
+        // Read back the previous frame
+        if(pending) writer.write(frames[1 - current].getTexture().copyToImage());
+        pending = true;
+        current = 1 - current;
+    }
+    if(pending) writer.write(frames[1 - current].getTexture().copyToImage());
+    
+    writer.finish();
+    if(writer.getFailedCount() > 0) {
+        std::cerr << "Could not write " << writer.getFailedCount() << " frames to: " << output << std::endl;
+        return false;
+    }
+    
+    return true;
+}
 
-void Game::run() {
-    // Initialize the game
+// Watches a game broadcast on this machine. The world only shows what the game sends, it is
+// played a chunk behind at the game's pace and catches up when more than that is waiting.
+bool Game::spectate(const std::string& path) {
+    SpectatorView view;
+    if(!view.connect(path)) {
+        std::cerr << "Could not connect to: " << path << std::endl;
+        return false;
+    }
+    
+    // The stream starts with the size of the game's world
+    while(!view.isSetUp() && view.receive(1000)) {}
+    if(!view.isSetUp()) {
+        std::cerr << "No game on: " << path << std::endl;
+        return false;
+    }
+    
+    const spectate::Setup& setup = view.getSetup();
+    m_floor_count = setup.floor_count;
+    m_endless = setup.endless != 0;
     init();
+    m_music.reset();
+    m_world.setSize(setup.floor_count, setup.max_hole_count);
+    m_world.changeLevel(0);
     
-    // Game loop
+    const sf::Vector2f view_size = m_world.getViewSize();
+    m_window.create(sf::VideoMode(view_size.x, view_size.y), m_game_title, sf::Style::Default);
+    m_window.setVerticalSyncEnabled(true);
+    
+    const float dt = static_cast<float>(m_world.getDt());
     sf::Clock clock;
     float accumulator = 0;
     while(m_window.isOpen()) {
-        // Poll events, only for close event
         sf::Event event;
-        while(m_window.pollEvent(event))
-            if(event.type == sf::Event::Closed) m_window.close();
+        while(m_window.pollEvent(event)) if(event.type == sf::Event::Closed) m_window.close();
+        
+        const bool receiving = view.receive(0);
+        if(!receiving && view.getWaitingTickCount() == 0) break;
         
         // Update
+        accumulator = std::min(accumulator + clock.restart().asSeconds(), 8 * dt);
+        bool updated = false;
+        while(accumulator > dt || view.getWaitingTickCount() > 2 * spectate::CHUNK_TICKS) {
+            if(!view.advance(m_world)) break;
+            accumulator = std::max(accumulator - dt, 0.0f);
+            updated = true;
+            
+            // Level changed
+            if(m_world.getLevel() != m_theme_level) changeTheme(m_world.getLevel());
+        }
+        
+        // Render
+        if(updated) {
+            drawFrame(m_window, m_world);
+            m_window.display();
+        }
+        else sf::sleep(sf::seconds(0.001f));
+    }
+    
+    std::cout << "Watched " << view.getTickCount() << " ticks, " << view.getByteCount() << " bytes";
+    if(view.getTickCount() > 0) std::cout << ", " << static_cast<std::size_t>(view.getByteCount() / (view.getTickCount() * dt)) << " bytes a second";
+    std::cout << std::endl;
+    
+    return true;
+}
+
+// Simulation thread, ticks at a fixed rate and publishes a copy of the world after each batch
+void Game::simulate() {
+    const float dt = static_cast<float>(m_world.getDt());
+    sf::Clock clock;
+    float accumulator = 0;
+    bool woken = false;
+    while(m_running) {
+        // Update
+        bool updated = false;
         accumulator += clock.restart().asSeconds();
-        while(accumulator > m_dt) {
-            accumulator -= m_dt;
+        
+        // A key woke it up, the tick is taken now and the next wait is longer
+        if(woken && accumulator <= dt) {
+            accumulator -= dt;
             update();
+            updated = true;
         }
         
-        // Render
-        render();
+        while(accumulator > dt) {
+            accumulator -= dt;
+            update();
+            updated = true;
+        }
+        
+        // Publish
+        if(updated) {
+            m_snapshots.getWriteBuffer().copyState(m_world);
+            m_snapshots.publish();
+            if(m_versus.isConnected()) {
+                m_remote_snapshots.getWriteBuffer().copyState(m_versus.getRemoteWorld());
+                m_remote_snapshots.publish();
+            }
+        }
+        
+        // Wait for the next tick. Info screens wait for input, so they tick in batches a few times
+        // a second unless a key changes. Not in versus, the opponent would have to wait.
+        const bool idle = m_world.inInfoScreen() && !m_versus.isConnected();
+        const float wait = idle ? m_idle_interval : dt - accumulator;
+        std::unique_lock<std::mutex> lock(m_sim_mutex);
+        woken = m_sim_wake.wait_for(lock, std::chrono::duration<float>(wait), [this, idle] {
+            return !m_running || m_paused || (idle && m_keys != m_prev_keys);
+        });
+        
+        // Paused, time stops until the window is back
+        if(m_paused) {
+            m_sim_wake.wait(lock, [this] { return !m_running || !m_paused; });
+            clock.restart();
+            woken = false;
+        }
+    }
+}
+
+// Wakes up the simulation thread when it waits for input
+void Game::setSimulationInput(unsigned keys, bool paused) {
+    if(keys == m_keys && paused == m_paused) return;
+    
+    std::lock_guard<std::mutex> lock(m_sim_mutex);
+    m_keys = keys;
+    m_paused = paused;
+    m_sim_wake.notify_one();
+}
+
+// Returns true if the window has to be drawn again
+bool Game::handleEvent(const sf::Event& event) {
+    switch(event.type) {
+        case sf::Event::Closed:
+            m_window.close();
+            return false;
+            
+        case sf::Event::LostFocus:
+            m_focused = false;
+            return false;
+            
+        case sf::Event::GainedFocus:
+            m_focused = true;
+            return true;
+            
+        case sf::Event::Resized:
+            return true;
+            
+        case sf::Event::KeyPressed:
+            if(event.key.code == sf::Keyboard::F12) {
+                if(m_flight_recorder.dump()) std::cout << "Flight recorder written to " << m_flight_recorder.getDumpFile() << std::endl;
+                else std::cerr << "Could not write flight recorder: " << m_flight_recorder.getDumpFile() << std::endl;
+            }
+            return false;
+            
+        default:
+            return false;
+    }
+}
+
+// Keys for the simulation thread, the input bits plus the cheats
+unsigned Game::readKeys() const {
+    unsigned keys = 0;
+    if(sf::Keyboard::isKeyPressed(sf::Keyboard::Left)) keys |= World::INPUT_LEFT;
+    if(sf::Keyboard::isKeyPressed(sf::Keyboard::Right)) keys |= World::INPUT_RIGHT;
+    if(sf::Keyboard::isKeyPressed(sf::Keyboard::Up)) keys |= World::INPUT_JUMP;
+    if(sf::Keyboard::isKeyPressed(sf::Keyboard::Return)) keys |= World::INPUT_CONFIRM;
+    
+    if(sf::Keyboard::isKeyPressed(sf::Keyboard::K)) keys |= CHEAT_PREV_LEVEL;
+    if(sf::Keyboard::isKeyPressed(sf::Keyboard::L)) keys |= CHEAT_NEXT_LEVEL;
+    if(sf::Keyboard::isKeyPressed(sf::Keyboard::J)) keys |= CHEAT_GAME_OVER;
+    if(sf::Keyboard::isKeyPressed(sf::Keyboard::H)) keys |= CHEAT_FINISH_LEVEL;
+    if(sf::Keyboard::isKeyPressed(sf::Keyboard::P)) keys |= CHEAT_AUTOPLAY;
+    return keys;
+}
+
+// Plays a replay back without assets and compares the state and tick hashes it recorded, a
+// replay made by any build with the same number type has to match. With a tick hash given, in
+// hex, the playback also has to end on it.
+bool Game::verifyReplay(const std::string& replay_file, const std::string& tick_hash) {
+    char* tick_hash_end = nullptr;
+    const std::uint64_t expected_tick_hash = std::strtoull(tick_hash.c_str(), &tick_hash_end, 16);
+    if(!tick_hash.empty() && *tick_hash_end != '\0') {
+        std::cerr << "Not a tick hash: " << tick_hash << std::endl;
+        return false;
     }
     
-    // Clean-up
-    m_music->stop(); delete m_music;
-    m_sound_buffers.clear();
-    m_looping_sounds.clear();
-    m_sounds.clear();
+    Replay replay;
+    if(!replay.loadFromFile(replay_file)) {
+        std::cerr << "Could not load replay: " << replay_file << std::endl;
+        return false;
+    }
+    
+    if(!m_manifest.loadFromFile(resourcePath() + "data/manifest.bin")) {
+        std::cerr << "Could not load: manifest.bin" << std::endl;
+        return false;
+    }
+    m_world.setManifest(m_manifest);
+    replay.setUp(m_world);
+    m_world.changeLevel(0);
+    
+    Replay check;
+    const bool comparable = replay.isFixedPoint() == check.isFixedPoint();
+    if(!comparable) std::cout << "Recorded with the other number type, checkpoints are skipped" << std::endl;
+    else if(!replay.hasCurrentStateHashes()) std::cout << "Recorded with an older state hash, only tick hashes are checked" << std::endl;
+    
+    std::size_t checked = 0;
+    for(std::size_t tick = 0; tick < replay.getTickCount(); ++tick) {
+        m_world.update(replay.getInput(tick));
+        
+        if(!comparable || !replay.hasCheckpoint(tick + 1)) continue;
+        if(replay.hasCurrentStateHashes() && m_world.getStateHash() != replay.getCheckpoint(tick + 1)) {
+            std::cout << "Different state after tick " << tick + 1 << std::endl;
+            return false;
+        }
+        if(replay.hasTickHash(tick + 1) && m_world.getTickHash() != replay.getTickHash(tick + 1)) {
+            std::cout << "Different tick hash after tick " << tick + 1 << ", something went different in the "
+                      << Replay::CHECKPOINT_INTERVAL << " ticks before" << std::endl;
+            return false;
+        }
+        ++checked;
+    }
+    
+    std::cout << "Matched " << checked << " checkpoints, " << replay.getTickCount() << " ticks, level " << m_world.getLevel()
+              << ", score " << m_world.getScore() << ", final hash " << std::hex << m_world.getStateHash()
+              << ", tick hash " << m_world.getTickHash() << std::dec << std::endl;
+    
+    if(tick_hash.empty()) return true;
+    if(!comparable) {
+        std::cout << "The tick hash can't be checked with the other number type" << std::endl;
+        return false;
+    }
+    if(m_world.getTickHash() != expected_tick_hash) {
+        std::cout << "Expected tick hash " << std::hex << expected_tick_hash << std::dec << std::endl;
+        return false;
+    }
+    return true;
 }
 
-void Game::update() {
-    m_global_timer += m_dt;
+// The golden replay is checked in with the tick hash it ends on, anything that changes how the
+// game plays out fails it. It was recorded with JJ_FIXED_POINT, float builds skip it; the Golden
+// configuration of the project builds with it and runs this after every build.
+bool Game::verifyGolden() {
+    if(!Replay().isFixedPoint()) {
+        std::cout << "Golden replay skipped, it can only be checked in a JJ_FIXED_POINT build" << std::endl;
+        return true;
+    }
     
-    float timescaled_time = m_timescale * m_dt;
+    const std::string golden = resourcePath() + "data/replays/golden";
+    std::ifstream file(golden + ".txt");
+    std::string tick_hash;
+    if(!(file >> tick_hash)) {
+        std::cerr << "Could not load: golden.txt" << std::endl;
+        return false;
+    }
     
-    // Update entities
-    for(auto& e : m_holes) e->update(timescaled_time);
-    for(auto& e : m_hazards) e->update(timescaled_time);
-    if(!inInfoScreen()) m_player->update(m_dt);
+    return verifyReplay(golden + ".jjrp", tick_hash);
+}
+
+// Plays one endless session headless with the bot, topping up its health so it never ends.
+// Once warmed up for ten minutes of play the pools are full, it fails if the entity pools or the
+// level arena grow after that, or if the last minute ticks more than twice as slow as that one.
+bool Game::soak(std::size_t tick_count) {
+    if(!m_manifest.loadFromFile(resourcePath() + "data/manifest.bin")) {
+        std::cerr << "Could not load: manifest.bin" << std::endl;
+        return false;
+    }
+    m_world.setManifest(m_manifest);
+    m_world.setSize(m_floor_count, m_floor_count);
+    m_world.setEndless(true);
+    m_world.seed(m_seed);
+    m_world.changeLevel(0);
+    
+    const std::size_t window = 125 * 60;
+    const std::size_t warm_up = window * 10;
+    if(tick_count < warm_up + window) {
+        std::cerr << "Soak needs at least " << warm_up + window << " ticks" << std::endl;
+        return false;
+    }
+    
+    Bot bot(m_seed, 1);
+    std::size_t pool_size = 0;
+    std::size_t arena_overflows = 0;
+    double first_tick_time = 0;
+    double last_tick_time = 0;
+    bool grew = false;
     
-    // Check game over condition
-    if(m_game_over) {
-        if(sf::Keyboard::isKeyPressed(sf::Keyboard::Return)) restart();
+    sf::Clock clock;
+    for(std::size_t tick = 1; tick <= tick_count; ++tick) {
+        m_world.setHealth(std::max(m_world.getHealth(), 2u));
+        m_world.update(bot.decide(m_world));
+        if(tick % window != 0) continue;
+        
+        last_tick_time = clock.restart().asMicroseconds() / static_cast<double>(window);
+        const Arena& level_arena = m_world.getLevelArena();
+        if(tick < warm_up) continue;
+        if(tick == warm_up) {
+            pool_size = m_world.getPoolSize();
+            arena_overflows = level_arena.getOverflowCount();
+            first_tick_time = last_tick_time;
+        }
+        else if(m_world.getPoolSize() != pool_size || level_arena.getOverflowCount() != arena_overflows) grew = true;
+        
+        if(tick % (window * 60) == 0 || tick + window > tick_count) {
+            std::cout << "Tick " << tick << ": " << last_tick_time << " us/tick, level " << m_world.getLevel()
+                      << ", " << m_world.getHazards().size() << " hazards, " << m_world.getHoles().size() << " holes, "
+                      << m_world.getPoolSize() << " pooled, clocks " << static_cast<float>(m_world.getGlobalTimer())
+                      << "/" << static_cast<float>(m_world.getEntityTime()) << std::endl;
+        }
+    }
+    
+    if(grew) {
+        std::cout << "Memory grew after warming up" << std::endl;
+        return false;
+    }
+    if(last_tick_time > first_tick_time * 2) {
+        std::cout << "Ticks got slower: " << first_tick_time << " to " << last_tick_time << " us" << std::endl;
+        return false;
     }
-    else if(m_changing_level) {
-        if(m_global_timer >= m_changing_level_time ||
-           sf::Keyboard::isKeyPressed(sf::Keyboard::Return)) nextLevel();
+    return true;
+}
+
+// Draws a bot game into a render texture the way the window loop does, a snapshot of the world
+// and then the frame. Once warmed up for a minute of frames the pools and buffers are full, it
+// fails if drawing any frame after that allocates. The ticks in between are left to the soak.
+bool Game::allocTest(std::size_t frame_count) {
+    init();
+    m_music.reset();
+    m_world.setEndless(true);
+    m_world.changeLevel(0);
+    for(std::size_t i = 0; i < 3; ++i) {
+        m_snapshots.getSlot(i).setManifest(m_manifest);
+        m_snapshots.getSlot(i).copyState(m_world);
     }
     
-    // Change Level Cheat
-    {
-        // Previous level
-        static bool k_prev;
-        bool k_now = sf::Keyboard::isKeyPressed(sf::Keyboard::K);
-        if(!k_prev && k_now) prevLevel();
-        k_prev = k_now;
+    const sf::Vector2f view_size = m_world.getViewSize();
+    sf::RenderTexture frame;
+    if(!frame.create(view_size.x, view_size.y)) {
+        std::cerr << "Could not create a render texture" << std::endl;
+        return false;
+    }
+    frame.setView(sf::View(sf::FloatRect(0, 0, view_size.x, view_size.y)));
+    
+    // Two ticks a frame is close to the 125 Hz world at 60 fps
+    const std::size_t ticks_per_frame = 2;
+    const std::size_t warm_up = 60 * 60;
+    
+    Bot bot(m_seed, 1);
+    std::size_t allocating_frames = 0;
+    std::size_t allocation_count = 0;
+    for(std::size_t i = 0; i < warm_up + frame_count; ++i) {
+        for(std::size_t tick = 0; tick < ticks_per_frame; ++tick) {
+            m_world.setHealth(std::max(m_world.getHealth(), 2u));
+            m_world.update(bot.decide(m_world));
+        }
+        
+        // A new level's tiles are drawn once, not with every frame
+        if(m_world.getLevel() != m_theme_level) changeTheme(m_world.getLevel());
         
-        // Next level
-        static bool l_prev;
-        bool l_now = sf::Keyboard::isKeyPressed(sf::Keyboard::L);
-        if(!l_prev && l_now) nextLevel();
-        l_prev = l_now;
+        if(i >= warm_up) start_counting_allocations();
         
-        // Game Over
-        static bool j_prev;
-        bool j_now = sf::Keyboard::isKeyPressed(sf::Keyboard::J);
-        if(!j_prev && j_now) trigger(GAME_EVENT::GAME_OVER);
-        j_prev = j_now;
+        m_snapshots.getWriteBuffer().copyState(m_world);
+        m_snapshots.publish();
+        m_snapshots.update();
+        drawFrame(frame, m_snapshots.getReadBuffer());
+        frame.display();
         
-        // Finish Level
-        static bool h_prev;
-        bool h_now = sf::Keyboard::isKeyPressed(sf::Keyboard::H);
-        if(!h_prev && h_now) trigger(GAME_EVENT::REACHED_TO_TOP);
-        h_prev = h_now;
+        const std::size_t allocations = stop_counting_allocations();
+        if(allocations > 0) {
+            ++allocating_frames;
+            allocation_count += allocations;
+        }
     }
     
-    checkGameEvents();
+    std::cout << frame_count << " frames, " << allocating_frames << " of them allocated " << allocation_count
+              << " times, level " << m_world.getLevel() << std::endl;
+    return allocating_frames == 0;
 }
 
-void Game::render() {
-    // Clear
-    m_window.clear();
+// Plays a versus race headless, two bots as two peers in this process talking over localhost
+// through the simulated link. It fails if the peers went out of sync, or if playing ticks again
+// after a wrong prediction ever took longer than a tick. The longest tick includes the sockets.
+bool Game::versusTest(std::size_t tick_count) {
+    if(!m_manifest.loadFromFile(resourcePath() + "data/manifest.bin")) {
+        std::cerr << "Could not load: manifest.bin" << std::endl;
+        return false;
+    }
+    
+    std::unique_ptr<World[]> worlds(new World[2]);
+    std::unique_ptr<Versus[]> peers(new Versus[2]);
+    for(std::size_t i = 0; i < 2; ++i) {
+        worlds[i].setManifest(m_manifest);
+        worlds[i].setSize(m_floor_count, m_floor_count);
+        worlds[i].setEndless(m_endless);
+        worlds[i].seed(m_seed);
+        worlds[i].changeLevel(0);
+        
+        peers[i].setInputDelay(m_input_delay);
+        peers[i].setSimulatedLink(m_net_latency, m_net_loss);
+        if(!peers[i].bind(0)) {
+            std::cerr << "Could not open a socket" << std::endl;
+            return false;
+        }
+    }
+    for(std::size_t i = 0; i < 2; ++i) {
+        if(!peers[i].connect("127.0.0.1", peers[1 - i].getLocalPort())) return false;
+        peers[i].start(worlds[i]);
+    }
+    
+    // Info screens are confirmed right away
+    Bot bots[2] = { Bot(m_seed, 1), Bot(m_seed + 1, 0.5f) };
+    const float dt = static_cast<float>(worlds[0].getDt());
+    float max_step_time = 0;
+    for(std::size_t step = 0; step < tick_count; ++step) {
+        for(std::size_t i = 0; i < 2; ++i) {
+            sf::Clock clock;
+            World::Input input = worlds[i].inInfoScreen() ? static_cast<World::Input>(World::INPUT_CONFIRM) : bots[i].decide(worlds[i]);
+            if(peers[i].advance(input)) {
+                worlds[i].update(input);
+                peers[i].sendTick(worlds[i]);
+            }
+            max_step_time = std::max(max_step_time, clock.getElapsedTime().asSeconds());
+        }
+    }
+    
+    const char* results[] = { "racing", "won", "lost", "draw" };
+    bool in_sync = true;
+    float max_rollback_time = 0;
+    for(std::size_t i = 0; i < 2; ++i) {
+        const Versus::Stats& stats = peers[i].getStats();
+        std::cout << "Peer " << i << ": " << results[peers[i].getResult()] << ", level " << worlds[i].getLevel() << "\n" << peers[i].getReport();
+        in_sync = in_sync && stats.check_count > 0 && stats.desync_count == 0;
+        max_rollback_time = std::max(max_rollback_time, stats.max_rollback_time);
+    }
+    std::cout << "Longest tick " << max_step_time * 1000 << " ms" << std::endl;
+    
+    if(!in_sync) {
+        std::cout << "Out of sync" << std::endl;
+        return false;
+    }
+    if(max_rollback_time > dt) {
+        std::cout << "Rollbacks took longer than " << dt * 1000 << " ms" << std::endl;
+        return false;
+    }
+    return true;
+}
 
-    // Draw everything
-    drawGameplay();
-    drawUI();
-    if(inInfoScreen()) drawInfoScreen();
+void Game::update() {
+    const unsigned keys = m_keys;
+    unsigned pressed = keys & ~m_prev_keys;
+    m_prev_keys = keys;
+    if(m_versus.isConnected()) pressed &= ~LEVEL_CHEATS;
+    
+    // Cheats
+    if(pressed & CHEAT_PREV_LEVEL) m_world.prevLevel();
+    if(pressed & CHEAT_NEXT_LEVEL) m_world.nextLevel();
+    if(pressed & CHEAT_GAME_OVER) m_world.trigger(World::GAME_EVENT::GAME_OVER);
+    if(pressed & CHEAT_FINISH_LEVEL) m_world.trigger(World::GAME_EVENT::REACHED_TO_TOP);
+    if(pressed & CHEAT_AUTOPLAY) m_autoplay = !m_autoplay;
+    if((pressed & LEVEL_CHEATS) || m_autoplay) m_run_cheated = true;
+    if(pressed & LEVEL_CHEATS) m_replay_cheated = true;
+    
+    // Input
+    World::Input input = static_cast<World::Input>(keys & 0xFF);
+    if(m_autoplay) input = m_planner.decide(m_world);
+    
+    // Versus plays the input from a few ticks ago, the tick waits while the opponent is behind
+    if(m_versus.isConnected()) {
+        const bool advanced = m_versus.advance(input);
+        m_opponent_waiting = m_versus.isWaiting();
+        if(!advanced) return;
+    }
+    const bool recording = !m_record_file.empty() && !m_replay_cheated;
+    if(recording) m_replay.record(input);
+    
+    m_world.update(input);
+    if(m_versus.isConnected()) {
+        m_versus.sendTick(m_world);
+        m_race_result = m_versus.getResult();
+    }
+    if(recording) m_replay.checkpoint(m_world);
+    m_flight_recorder.recordTick(input, m_world.getTickHash());
+    if(m_spectators.isListening()) m_spectators.broadcast(m_world);
+    
+    // Keep how the game was lost
+    auto& events = m_world.getTickEvents();
+    const bool game_over = std::find(events.begin(), events.end(), World::GAME_EVENT::GAME_OVER) != events.end();
+    if(game_over) m_flight_recorder.dump();
+    
+    // Print where the planner lost
+    if(m_autoplay) {
+        m_planner.observe(m_world);
+        if(game_over) std::cout << m_planner.getReport();
+    }
+    
+    updateRun(game_over);
+    playEventSounds();
+}
+
+// A run starts on the first level and ends when the game is lost or the last level is won, the
+// look of the player is recorded every tick in between. Runs with cheats or autoplay aren't kept.
+void Game::updateRun(bool game_over) {
+    if(m_ghost_file.empty()) return;
+    
+    if(m_run_start_tick == NO_RUN) {
+        if(m_world.getLevel() != 0 || m_world.inInfoScreen()) return;
+        
+        m_run.level_count = 0;
+        m_run.track.clear();
+        m_run_cheated = false;
+        m_run_start_tick = m_world.getTick();
+    }
+    
+    m_run.track.record(m_world.getPlayer().getLook());
+    m_run.level_count = m_world.getLevel();
+    
+    const bool won = m_world.isChangingLevel() && m_world.getLevel() >= m_world.getLastLevel();
+    if(!game_over && !won) return;
+    
+    m_run_start_tick = NO_RUN;
+    if(won) m_run.level_count = m_world.getLastLevel() + 1;
+    if(m_run_cheated || !m_best_runs.add(m_run)) return;
+    
+    if(m_best_runs.saveToFile(m_ghost_file)) std::cout << "New best run, " << m_run.track.getTickCount() << " ticks" << std::endl;
+    else std::cerr << "Could not save ghosts: " << m_ghost_file << std::endl;
+}
+
+void Game::render() {
+    m_flight_recorder.recordFrame(static_cast<std::uint32_t>(m_frame_clock.restart().asMicroseconds()));
+    World& snapshot = m_snapshots.getReadBuffer();
+    
+    // Level changed
+    if(snapshot.getLevel() != m_theme_level) changeTheme(snapshot.getLevel());
+    
+    if(m_versus.isConnected()) {
+        m_remote_snapshots.update();
+        drawVersusFrame(m_window, snapshot, m_remote_snapshots.getReadBuffer());
+    }
+    else drawFrame(m_window, snapshot);
     
     // Display
     m_window.display();
 }
 
-void Game::drawGameplay() {
-    // Draw background
-    m_window.draw(m_sprites["background"]);
+void Game::drawFrame(sf::RenderTarget& target, World& world) {
+    m_text_count = 0;
     
-    // Draw tiles
-    for(float y = 0; y < m_floor_count * m_line_height; y += m_line_height) {
-        for(float x = 0; x < m_view_size.x; x += m_tile_height) {
-            m_sprites["tile"].setPosition(x, y);
-            m_window.draw(m_sprites["tile"]);
-        }
+    // Clear
+    target.clear();
+
+    // Draw everything
+    drawGameplay(target, world);
+    drawUI(target, world);
+    if(world.inInfoScreen()) drawInfoScreen(target, world);
+    
+    // Texts of this frame are no longer needed
+    m_frame_arena.reset();
+}
+
+// Both worlds side by side, the local one on the left with its info screens and the race on top.
+// The tiles are of the local level.
+void Game::drawVersusFrame(sf::RenderTarget& target, World& local, World& remote) {
+    m_text_count = 0;
+    target.clear();
+    
+    const sf::View screen_view = target.getView();
+    const sf::Vector2f view_size = local.getViewSize();
+    sf::View half_view(sf::FloatRect(0, 0, view_size.x, view_size.y));
+    
+    half_view.setViewport(sf::FloatRect(0.5f, 0, 0.5f, 1));
+    target.setView(half_view);
+    drawGameplay(target, remote);
+    drawUI(target, remote);
+    
+    half_view.setViewport(sf::FloatRect(0, 0, 0.5f, 1));
+    target.setView(half_view);
+    drawGameplay(target, local);
+    drawUI(target, local);
+    
+    const char* race = nullptr;
+    switch(m_race_result) {
+        case Versus::WON: race = "RACE WON"; break;
+        case Versus::LOST: race = "RACE LOST"; break;
+        case Versus::DRAW: race = "RACE DRAWN"; break;
+        default: if(m_opponent_waiting) race = "WAITING FOR OPPONENT";
     }
+    if(race) drawText(target, race, sf::Vector2f(view_size.x*0.5f, view_size.y*0.05f), true, sf::Color::Black, sf::Color::Yellow);
+    if(local.inInfoScreen()) drawInfoScreen(target, local);
+    
+    target.setView(screen_view);
+    m_frame_arena.reset();
+}
+
+void Game::drawGameplay(sf::RenderTarget& target, World& world) {
+    // The world is drawn through a camera, only the floors in it and next to it
+    const float camera_y = getCameraY(world);
+    const float line_height = world.getFloorHeight();
+    const int first_floor = static_cast<int>(camera_y / line_height) - 1;
+    const int floor_count = world.getVisibleFloorCount() + 3;
+    
+    const sf::View screen_view = target.getView();
+    sf::View camera_view = screen_view;
+    camera_view.move(0, camera_y);
+    
+    // Draw background, it stays in place
+    target.draw(m_sprites["background"]);
+    
+    // Draw tiles, they repeat every floor
+    m_sprites["level"].setPosition(0, -fmod(camera_y, line_height));
+    target.draw(m_sprites["level"]);
     
     // Draw holes to a texture, black and white
     // This is done to prevent overlapping rectangles looking darker
+    m_hole_texture.setView(sf::View(sf::FloatRect(0, camera_y, world.getViewSize().x, world.getViewSize().y)));
     m_hole_texture.clear(sf::Color::Transparent);
-    for(auto& e : m_holes) e->render(m_hole_texture);
+    for(auto& e : world.getHoles()) {
+        if(world.isFloorInRange(e->getFloor(), first_floor, floor_count)) e->render(m_hole_texture);
+    }
     m_hole_texture.display();
     // Draw the hole texture on top of the tiles
     m_sprites["holes"].setColor(sf::Color(255, 255, 255, 160));
-    m_window.draw(m_sprites["holes"], sf::BlendAlpha);
+    target.draw(m_sprites["holes"], sf::BlendAlpha);
     
     // Render other entities
-    for(auto& e : m_hazards) e->render(m_window);
-    m_player->render(m_window);
+    target.setView(camera_view);
+    for(auto& e : world.getHazards()) {
+        if(world.isFloorInRange(e->getFloor(), first_floor, floor_count)) e->render(target);
+    }
+    drawGhosts(target, world, first_floor, floor_count);
+    world.getPlayer().render(target);
+    target.setView(screen_view);
     
     // Screen effect on slow mo
-    if(m_effect_color != sf::Color::Transparent) {
-        m_effect_color.a = 50 + 100*(0.5f + 0.5f*sin(50*m_global_timer));
-        m_effect_rect.setFillColor(m_effect_color);
+    sf::Color effect_color = world.getEffectColor();
+    if(effect_color != sf::Color::Transparent) {
+        effect_color.a = 50 + 100*(0.5f + 0.5f*sin(50*static_cast<float>(world.getGlobalTimer())));
+        m_effect_rect.setFillColor(effect_color);
         
-        m_window.draw(m_effect_rect);
+        target.draw(m_effect_rect);
     }
 }
 
-std::string scoreText(unsigned score) {
-    std::stringstream buffer;
-    buffer << std::setw(5) << std::setfill('0') << score;
-    return buffer.str();
+// Ghosts where their runs were as many ticks in as the one played, all in one draw. Their cursors
+// only go forward, one tick is decoded for every tick played.
+void Game::drawGhosts(sf::RenderTarget& target, const World& world, int first_floor, int floor_count) {
+    const unsigned run_start = m_run_start_tick;
+    if(run_start != m_ghost_run_start) {
+        m_ghost_run_start = run_start;
+        std::fill(m_ghost_cursors.begin(), m_ghost_cursors.end(), GhostTrack::Cursor());
+    }
+    if(run_start == NO_RUN || world.getTick() < run_start) return;
+    
+    const std::size_t tick_count = world.getTick() - run_start + 1;
+    const sf::Color ghost_color(255, 255, 255, 90);
+    m_ghost_vertices.clear();
+    for(std::size_t i = 0; i < m_ghost_runs.size(); ++i) {
+        const GhostTrack& track = m_ghost_runs[i].track;
+        GhostTrack::Cursor& cursor = m_ghost_cursors[i];
+        while(cursor.tick_count < tick_count && track.next(cursor)) {}
+        
+        // Finished before this tick
+        if(cursor.tick_count != tick_count) continue;
+        
+        const Entity::Look look = cursor.getLook();
+        if(world.isFloorInRange(look.floor, first_floor, floor_count)) world.getPlayer().appendLook(look, ghost_color, m_ghost_vertices);
+    }
+    
+    if(m_ghost_vertices.getVertexCount() > 0) target.draw(m_ghost_vertices, m_ghost_texture);
 }
 
-void Game::drawUI() {
-    float bottom = getViewSize().y - 44;
+// Top of the view in the world, keeps the player in the middle until an end of the world
+float Game::getCameraY(const World& world) const {
+    const Player& player = world.getPlayer();
+    const float line_height = world.getFloorHeight();
+    const float world_height = (world.getBottomFloor() + 1) * line_height;
+    const float player_y = (player.getFloor() + 0.5f) * line_height + static_cast<float>(player.getDrawOffsetY());
+    
+    return std::min(std::max(player_y - world.getViewSize().y*0.5f, 0.0f), std::max(world_height - world.getViewSize().y, 0.0f));
+}
+
+void Game::drawUI(sf::RenderTarget& target, const World& world) {
+    float bottom = world.getViewSize().y - 44;
     
-    drawText("HI" + scoreText(m_highscore), sf::Vector2f(550, bottom));
-    drawText("SC" + scoreText(m_score), sf::Vector2f(675, bottom));
+    drawText(target, m_frame_arena.format("HI%05u", world.getHighscore()), sf::Vector2f(550, bottom));
+    drawText(target, m_frame_arena.format("SC%05u", world.getScore()), sf::Vector2f(675, bottom));
     
     // Draw health
     bottom -= 15;
     float health_offset = 25;
-    for(unsigned i = 1; i <= m_health; ++i) {
+    for(unsigned i = 1; i <= world.getHealth(); ++i) {
         m_sprites["health"].setPosition(health_offset*i, bottom);
-        m_window.draw(m_sprites["health"]);
+        target.draw(m_sprites["health"]);
     }
 }
 
-void Game::drawText(const std::string& text, const sf::Vector2f& pos, bool centered, const sf::Color& color, const sf::Color& background_color) {
-    sf::Text t;
-    t.setFont(m_font);
-    t.setCharacterSize(24);
-    t.setFillColor(color);
+// Texts are kept between frames in the order they are drawn, one only gets new glyphs when its string changes
+void Game::drawText(sf::RenderTarget& target, const char* text, const sf::Vector2f& pos, bool centered, const sf::Color& color, const sf::Color& background_color) {
+    if(m_text_count == m_texts.size()) {
+        m_texts.emplace_back();
+        m_texts.back().setFont(m_font);
+        m_texts.back().setCharacterSize(24);
+        m_text_strings.emplace_back();
+    }
     
-    t.setString(text);
-    if(centered) t.setOrigin(sf::Vector2f(t.getLocalBounds().width, t.getLocalBounds().height)*0.5f);
+    sf::Text& t = m_texts[m_text_count];
+    std::string& t_string = m_text_strings[m_text_count];
+    ++m_text_count;
+    
+    t.setFillColor(color);
+    if(t_string != text) {
+        t_string = text;
+        t.setString(text);
+    }
+    t.setOrigin(centered ? sf::Vector2f(t.getLocalBounds().width, t.getLocalBounds().height)*0.5f : sf::Vector2f());
     t.setPosition(pos);
     
     if(background_color != sf::Color::Transparent) {
-        sf::RectangleShape rect;
-        
         float offset = 20;
-        rect.setSize(sf::Vector2f(t.getGlobalBounds().width + offset*2, t.getGlobalBounds().height + offset*2));
-        rect.setPosition(sf::Vector2f(t.getGlobalBounds().left - offset, t.getGlobalBounds().top - offset));
-        rect.setFillColor(background_color);
+        m_text_background.setSize(sf::Vector2f(t.getGlobalBounds().width + offset*2, t.getGlobalBounds().height + offset*2));
+        m_text_background.setPosition(sf::Vector2f(t.getGlobalBounds().left - offset, t.getGlobalBounds().top - offset));
+        m_text_background.setFillColor(background_color);
         
-        m_window.draw(rect);
+        target.draw(m_text_background);
     }
     
-    m_window.draw(t);
-}
-
-bool Game::inInfoScreen() {
-    return m_changing_level || m_game_over;
+    target.draw(t);
 }
 
-void Game::drawInfoScreen() {
-    sf::RectangleShape bg_filter;
-    bg_filter.setSize(m_view_size);
-    bg_filter.setFillColor(sf::Color(0, 0, 0, 200));
-    m_window.draw(bg_filter);
+void Game::drawInfoScreen(sf::RenderTarget& target, const World& world) {
+    const sf::Vector2f view_size = world.getViewSize();
     
-    sf::Vector2f center = m_view_size*0.5f;
+    m_info_filter.setSize(view_size);
+    m_info_filter.setFillColor(sf::Color(0, 0, 0, 200));
+    target.draw(m_info_filter);
+    
+    sf::Vector2f center = view_size*0.5f;
     
     // Game title
-    drawText(m_game_title, sf::Vector2f(center.x, m_view_size.y*0.2f), true, sf::Color::Black, sf::Color::Green);
+    drawText(target, m_game_title.c_str(), sf::Vector2f(center.x, view_size.y*0.2f), true, sf::Color::Black, sf::Color::Green);
     
     // Game over
-    if(m_game_over) {
-        drawText("FINAL SCORE   " + scoreText(m_score), sf::Vector2f(center.x, m_view_size.y*0.4f), true, sf::Color::Black, sf::Color::Cyan);
-        drawText("WITH " + std::to_string(m_hazards.size()) + " HAZARDS", sf::Vector2f(center.x, m_view_size.y*0.5f), true, sf::Color::Black, sf::Color::Cyan);
+    if(world.isGameOver()) {
+        drawText(target, m_frame_arena.format("FINAL SCORE   %05u", world.getScore()), sf::Vector2f(center.x, view_size.y*0.4f), true, sf::Color::Black, sf::Color::Cyan);
+        drawText(target, m_frame_arena.format("WITH %zu HAZARDS", world.getHazards().size()), sf::Vector2f(center.x, view_size.y*0.5f), true, sf::Color::Black, sf::Color::Cyan);
         
-        if(m_new_high) {
+        if(world.isNewHigh()) {
             float flash_interval = 0.5f;
-            bool flash = fmod(m_global_timer, flash_interval) > flash_interval*0.5f;
+            bool flash = fmod(static_cast<float>(world.getGlobalTimer()), flash_interval) > flash_interval*0.5f;
             sf::Color c1 = sf::Color::White, c2 = sf::Color::Magenta;
-            drawText("NEW HIGH", sf::Vector2f(center.x, m_view_size.y*0.7f), true, flash ? c1 : c2, flash ? c2 : c1);
+            drawText(target, "NEW HIGH", sf::Vector2f(center.x, view_size.y*0.7f), true, flash ? c1 : c2, flash ? c2 : c1);
         }
         
-        drawText("Press ENTER to replay", sf::Vector2f(center.x, m_view_size.y*0.9f), true, sf::Color::White);
+        drawText(target, "Press ENTER to replay", sf::Vector2f(center.x, view_size.y*0.9f), true, sf::Color::White);
     }
-    else if(m_changing_level) {
-        if(m_level <= m_last_level) {
-            std::size_t hazard_count = m_hazards.size() + 1;
-            drawText("NEXT LEVEL -  "  + std::to_string(hazard_count) + " " + (hazard_count == 1 ? "HAZARD" : "HAZARDS"),
-                     sf::Vector2f(center.x, m_view_size.y*0.4f), true, sf::Color::Blue, sf::Color::White);
+    else if(world.isChangingLevel()) {
+        if(world.getLevel() <= world.getLastLevel()) {
+            std::size_t hazard_count = world.getHazards().size() + 1;
+            drawText(target, m_frame_arena.format("NEXT LEVEL -  %zu %s", hazard_count, hazard_count == 1 ? "HAZARD" : "HAZARDS"),
+                     sf::Vector2f(center.x, view_size.y*0.4f), true, sf::Color::Blue, sf::Color::White);
         }
         
         // Story
-        auto& lines = m_story_texts[m_level];
+        auto& lines = m_story_texts[world.getLevel()];
         for(std::size_t i = 0; i < lines.size(); ++i) {
-            drawText(lines[i], sf::Vector2f(m_view_size.x*0.3f, m_view_size.y*(0.7f + i*0.05f)));
+            drawText(target, lines[i].c_str(), sf::Vector2f(view_size.x*0.3f, view_size.y*(0.7f + i*0.05f)));
         }
     }
 }
 
-void Game::spawnHole() {
-    if(m_holes.size() >= m_max_hole_count) return;
-    
-    int direction =
-    // First two are in reversed directions
-    m_holes.size() == 0 ? 1 :
-    m_holes.size() == 1 ? -1 :
-    // Next 3 holes descend, last 3 ascend
-    m_holes.size() <= 4 ? 1 : -1;
-    
-    m_holes.push_back(std::make_unique<Hole>());
-    
-    m_holes.back()->spawn(true, "", direction);
-}
-
-void Game::spawnHazard() {
-    if(++m_curr_hazard >= m_hazard_names.size()) m_curr_hazard = 0;
-    
-    m_hazards.push_back(std::make_unique<Entity>());
-    
-    // Always goes left
-    m_hazards.back()->spawn(true, m_hazard_names[m_curr_hazard], -1);
-}
-
-void Game::gameOver() {
-    m_game_over = true;
-    
-    if(m_score > m_highscore) {
-        m_highscore = m_score;
-        m_new_high = true;
-    }
-}
-
-void Game::nextLevel() {
-    changeLevel(m_level + 1);
-    m_changing_level = false;
-}
-
-void Game::prevLevel() {
-    changeLevel(m_level - 1);
-    m_changing_level = false;
-}
-
-void Game::resetEffects() {
-    // Reset variables
-    m_timescale = 1;
-    m_effect_color = sf::Color::Transparent;
-}
-void Game::changeLevel(int level) {
-    resetEffects();
-    
-    // Don't exceed the level limit
-    level = std::min(std::max(level, 0), m_last_level);
-    m_level = level;
-    
-    // Theme
-    changeTheme(level);
-    
-    // Reset score
-    if(m_level == 0) m_score = 0;
-    // Set the score increase amount depending on the level
-    m_score_increase = m_score_base * (1 + m_level);
-    
-    // Spawn hazards
-    m_hazards.clear();
-    for(int i = 0; i < m_level; ++i) spawnHazard();
-    
-    // Spawn holes
-    m_holes.clear();
-    for(unsigned i = 0; i < 2; ++i) spawnHole();
-    
-    // Health
-    if(m_level == 0) m_health = m_start_health;
-    // Bonus health at 6, 11, 16
-    else if(m_level != 1 && (m_level - 1) % 5 == 0) ++m_health;
-    
-    // Player
-    m_player = std::make_unique<Player>();
-    m_player->spawn(false, "pink");
-}
-
-
 void Game::changeTheme(int level) {
-    unsigned theme_id = level % m_background_count;
-    std::string theme = theme_id == 0 ? "grass" : theme_id == 1 ? "desert" : "shroom";
+    m_theme_level = level;
+    
+    const manifest::Theme& theme = m_manifest.getTheme(m_manifest.getLevel(level).theme);
     
     // Set correct background
-    std::string curr_bg = "bg_" + theme;
-    m_sprites["background"].setTexture(m_textures[curr_bg]);
+    const sf::Texture& background = m_textures.find(m_manifest.getString(theme.background))->second;
+    m_sprites["background"].setTexture(background);
     
-    float scale = m_view_size.x/m_textures[curr_bg].getSize().x;
+    float scale = m_world.getViewSize().x/background.getSize().x;
     m_sprites["background"].setScale(scale, scale);
     m_sprites["background"].setColor(sf::Color(100, 100, 100));
     
-    // Set correct tile
-    sf::Vector2i tex_coord;
-    
-    if(theme == "desert") { tex_coord.x = 4; tex_coord.y = 14; }
-    else if(theme == "grass")  { tex_coord.x = 0; tex_coord.y = 6; }
-    else if(theme == "shroom") { tex_coord.x = 1; tex_coord.y = 8; }
+    // Set correct tile, cut out of the sheet so its mipmaps don't take in the tiles next to it
+    sf::Vector2i tex_coord(theme.tile_x, theme.tile_y);
     
-    m_sprites["tile"].setTexture(m_textures["spritesheet_ground"]);
-    m_sprites["tile"].setTextureRect(sf::IntRect(tex_coord.x*m_sheet_block_size, tex_coord.y*m_sheet_block_size,
-                                                 m_sheet_block_size, m_sheet_block_size));
+    const int block_size = m_world.getSpritesheetBlockSize();
+    m_tile_texture.loadFromImage(m_ground_image, sf::IntRect(tex_coord.x*block_size, tex_coord.y*block_size, block_size, block_size));
+    m_tile_texture.setSmooth(true);
+    m_tile_texture.generateMipmap();
+    m_sprites["tile"].setTexture(m_tile_texture, true);
     
-    float sh_scale = m_tile_height / m_sheet_block_size;
+    float sh_scale = m_world.getTileHeight() / block_size;
     m_sprites["tile"].setScale(sh_scale, sh_scale);
+    
+    // Draw the layer
+    m_level_layer.clear(sf::Color::Transparent);
+    
+    const float line_height = m_world.getFloorHeight();
+    const float tile_height = m_world.getTileHeight();
+    for(float y = 0; y < m_level_layer.getSize().y; y += line_height) {
+        for(float x = 0; x < m_world.getViewSize().x; x += tile_height) {
+            m_sprites["tile"].setPosition(x, y);
+            m_level_layer.draw(m_sprites["tile"]);
+        }
+    }
+    m_level_layer.display();
 }
 
-void Game::restart() {
-    changeLevel(0);
-    m_game_over = false;
-    m_new_high = false;
-}
-
-void Game::levelFinished() {
-    m_changing_level = true;
-    m_global_timer = 0;
-}
-
-void Game::checkGameEvents() {
-    // Events
-    while(!m_events.empty()) {
-        GAME_EVENT event = m_events.back();
-        m_events.pop_back();
-        
+// Sounds of the events the world went through this tick
+void Game::playEventSounds() {
+    for(World::GAME_EVENT event : m_world.getTickEvents()) {
         switch(event) {
-            case GAME_EVENT::REACHED_TO_TOP:
+            case World::GAME_EVENT::REACHED_TO_TOP:
                 playSound("end_win");
-                levelFinished();
                 break;
                 
-            case GAME_EVENT::GAME_OVER:
+            case World::GAME_EVENT::GAME_OVER:
                 playSound("end_lose");
-                gameOver();
-                break;
-                
-            case GAME_EVENT::DROPPED_TO_BOTTOM:
-                if(--m_health <= 0) {
-                    m_health = 0;
-                    trigger(GAME_EVENT::GAME_OVER);
-                }
-                break;
-                
-            case GAME_EVENT::STOPPED_JUMPING:
-                spawnHole();
-                resetEffects();
                 break;
                 
-            case GAME_EVENT::STOPPED_HIT_HEAD:
-            case GAME_EVENT::STOPPED_HAZARD_HIT:
-            case GAME_EVENT::STOPPED_FALLING:
+            case World::GAME_EVENT::STOPPED_HIT_HEAD:
+            case World::GAME_EVENT::STOPPED_HAZARD_HIT:
+            case World::GAME_EVENT::STOPPED_FALLING:
                 playSound("fall_land");
-                resetEffects();
                 break;
                 
-            case GAME_EVENT::STARTED_FALLING:
-                m_timescale = m_slow_mo_timescale;
-                m_effect_color = sf::Color::Transparent;
+            case World::GAME_EVENT::STARTED_FALLING:
                 playSound("fall");
                 break;
                 
-            case GAME_EVENT::STARTED_JUMPING:
-                m_timescale = m_slow_mo_timescale;
-                m_effect_color = sf::Color::Transparent;
+            case World::GAME_EVENT::STARTED_JUMPING:
                 playSound("jump");
-                addScore();
                 break;
                 
-            case GAME_EVENT::HIT_BY_HAZARD:
-                m_timescale = 0;
-                m_effect_color = sf::Color::Red;
+            case World::GAME_EVENT::HIT_BY_HAZARD:
                 playSound("hit");
                 break;
                 
-            case GAME_EVENT::HIT_HEAD:
-                m_timescale = m_slow_mo_timescale;
-                m_effect_color = sf::Color::White;
+            case World::GAME_EVENT::HIT_HEAD:
                 playSound("bump");
                 break;
                 
-            case GAME_EVENT::STOPPED_STUN:
+            case World::GAME_EVENT::STOPPED_STUN:
                 playSound("get_up");
                 break;
                 
-            case GAME_EVENT::PLAYER_TURNED:
+            case World::GAME_EVENT::PLAYER_TURNED:
                 playSound("turn");
                 break;
                 
-            case GAME_EVENT::STARTED_WALKING:
+            case World::GAME_EVENT::STARTED_WALKING:
                 setSoundLoop("walk", true);
                 break;
                 
-            case GAME_EVENT::STOPPED_WALKING:
+            case World::GAME_EVENT::STOPPED_WALKING:
                 setSoundLoop("walk", false);
                 break;
+                
+            default:
+                break;
         }
     }
 }
 
-// Getters
-const std::vector<std::unique_ptr<Entity>>& Game::getHazards() { return m_hazards; }
-const std::vector<std::unique_ptr<Hole>>& Game::getHoles() { return m_holes; }
-float Game::getTileHeight() { return m_tile_height - 14; }
-float Game::getGlobalTimer() { return m_global_timer; }
-float Game::getFloorHeight() { return m_line_height; }
-int Game::getBottomFloor() { return m_floor_count - 1; }
-sf::Vector2f Game::getViewSize() { return m_view_size; }
-void Game::addScore() { m_score += m_score_increase; }
-float Game::getSpritesheetBlockSize() { return m_sheet_block_size; }
-const Animation& Game::getAnimation(std::string name) { return m_animations[name]; }
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
+// Level generation
+// Levels are generated in order on a background thread, until one is ready the manifest layout is used.
+// The simulation and drawing threads keep a core each, the generator's workers get the rest.
+void Game::startLevelGeneration() {
+    if(!m_generate_levels) return;
+    
+    m_level_layouts.resize(m_world.getLastLevel() + 1);
+    m_world.setLayoutProvider([this](int level) { return getGeneratedLayout(level); });
+    
+    m_generator_thread = std::thread([this] {
+        const unsigned core_count = std::max(1u, std::thread::hardware_concurrency());
+        LevelGenerator generator(m_manifest, static_cast<unsigned>(std::time(nullptr)), core_count > 2 ? core_count - 2 : 1);
+        
+        for(int level = 0; level <= m_world.getLastLevel() && !m_stop_generation; ++level) {
+            m_level_layouts[level] = generator.generate(level, targetWinRate(level));
+            m_generated_level_count = level + 1;
+        }
+    });
+}
 
+// Easy first levels, harder towards the end
+float Game::targetWinRate(int level) {
+    return 0.9f - 0.6f * level / std::max(1, m_world.getLastLevel());
+}
 
+const LevelLayout* Game::getGeneratedLayout(int level) {
+    return level < m_generated_level_count ? &m_level_layouts[level] : nullptr;
+}
 
 // LOAD ASSETS
+namespace {
+    const int PLAYER_FRAME_PADDING = 16;    // Transparent border and cell alignment, clean down to mip level 4
+    const unsigned PLAYER_SHEET_WIDTH = 4096;
+}
+
 void loadFailed(const std::string& file_name) {
     std::cerr << "Could not load: " << file_name << std::endl;
     exit(2);
 }
 
 void Game::loadAssets() {
-    m_music = new sf::Music();
+    m_music = std::make_unique<sf::Music>();
     if(!m_music->openFromFile(resourcePath() + "data/musics/music.ogg")) loadFailed("music.ogg");
     m_music->setLoop(true);
     
     m_font.loadFromFile(resourcePath() + "data/fonts/sansation.ttf");
     
-    if(!m_textures["bg_desert"].loadFromFile(resourcePath() + "data/images/bg_desert.png")) loadFailed("bg_desert.png");
-    ++m_background_count;
-    if(!m_textures["bg_grass"].loadFromFile(resourcePath() + "data/images/bg_grass.png")) loadFailed("bg_grass.png");
-    ++m_background_count;
-    if(!m_textures["bg_shroom"].loadFromFile(resourcePath() + "data/images/bg_shroom.png")) loadFailed("bg_shroom.png");
-    ++m_background_count;
+    if(!m_manifest.loadFromFile(resourcePath() + "data/manifest.bin")) loadFailed("manifest.bin");
     
-    if(!m_textures["spritesheet_ground"].loadFromFile(resourcePath() + "data/images/spritesheet_ground.png")) loadFailed("spritesheet_ground.png");
-    m_textures["spritesheet_ground"].setSmooth(true);
+    // Backgrounds are drawn smaller than their texels, mipmaps keep the sampling cheap and stop the
+    // shimmer. If the driver can't make them it falls back to plain smoothing.
     
-    if(!m_textures["spritesheet_players"].loadFromFile(resourcePath() + "data/images/spritesheet_players.png")) loadFailed("spritesheet_players.png");
-    m_textures["spritesheet_players"].setSmooth(true);
+    // Theme backgrounds
+    for(std::size_t i = 0; i < m_manifest.themeCount(); ++i) {
+        const std::string background = m_manifest.getString(m_manifest.getTheme(i).background);
+        if(!m_textures[background].loadFromFile(resourcePath() + "data/images/" + background + ".png")) loadFailed(background + ".png");
+        m_textures[background].setSmooth(true);
+        m_textures[background].generateMipmap();
+    }
+    
+    // Tiles are cut out of it when the theme changes
+    if(!m_ground_image.loadFromFile(resourcePath() + "data/images/spritesheet_ground.png")) loadFailed("spritesheet_ground.png");
+    
+    // The frames are packed edge to edge, so they are baked into a padded sheet before mipmapping
+    sf::Image players;
+    if(!players.loadFromFile(resourcePath() + "data/images/spritesheet_players.png")) loadFailed("spritesheet_players.png");
+    bakePlayerSheet(players);
     
     loadAnimations();
     
@@ -536,6 +1218,7 @@ void Game::loadAssets() {
     
     loadStory();
 
+    m_audio.setCacheSize(m_sound_cache_size);
     loadSound("hit");
     loadSound("jump");
     loadSound("turn");
@@ -545,235 +1228,94 @@ void Game::loadAssets() {
     loadSound("end_lose");
     loadSound("end_win");
     loadSound("get_up");
-    loadSound("walk"); m_looping_sounds["walk"].setPitch(1.5f); m_looping_sounds["walk"].setVolume(30);
+    loadSound("walk", true); m_audio.setPitch("walk", 1.5f); m_audio.setVolume("walk", 30);
 }
 
-void Game::playSound(const std::string& name) {
-    // Erase finished sounds
-    m_sounds.erase(std::remove_if(m_sounds.begin(), m_sounds.end(), [](const sf::Sound& s) { return s.getStatus() == sf::Sound::Stopped; }), m_sounds.end());
-
-    // Play new sound
-    m_sounds.emplace_back(m_sound_buffers[name]);
-    m_sounds.back().play();
-}
+// Sounds are queued to the audio thread, these never block
+void Game::playSound(const std::string& name) { m_audio.play(name); }
+void Game::setSoundLoop(const std::string &name, bool loop) { m_audio.setLoop(name, loop); }
 
-void Game::loadSound(const std::string& name) {
-    if(!m_sound_buffers[name].loadFromFile(resourcePath() + "data/sounds/" + name + ".wav")) loadFailed(name + ".wav");
+void Game::loadSound(const std::string& name, bool looping) {
+    // Prefer compressed versions if they are shipped
+    for(const char* extension : { ".ogg", ".flac", ".wav" }) {
+        std::string file_name = resourcePath() + "data/sounds/" + name + extension;
+        if(std::ifstream(file_name) && m_audio.loadSound(name, file_name, looping)) return;
+    }
     
-    m_looping_sounds[name].setBuffer(m_sound_buffers[name]);
-    m_looping_sounds[name].setLoop(true);
-}
-
-void Game::setSoundLoop(const std::string &name, bool loop) {
-    if(loop) m_looping_sounds[name].play();
-    else m_looping_sounds[name].pause();
+    loadFailed(name + ".wav");
 }
 
 void Game::loadStory() {
-    m_story_texts.emplace_back();
-    m_story_texts.back().push_back("Jumping Jack is quick and bold");
-    m_story_texts.back().push_back("With skill his story will unfold");
-    m_story_texts.emplace_back();
-    m_story_texts.back().push_back("THE BALLAD OF JUMPING JACK");
-    m_story_texts.back().push_back("A daring explorer named Jack...");
-    m_story_texts.emplace_back();
-    m_story_texts.back().push_back("Once found a peculiar track...");
-    m_story_texts.emplace_back();
-    m_story_texts.back().push_back("There were dangers galore...");
-    m_story_texts.emplace_back();
-    m_story_texts.back().push_back("Even holes in the floor...");
-    m_story_texts.emplace_back();
-    m_story_texts.back().push_back("So he kept falling flat on");
-    m_story_texts.back().push_back("his back...");
-    m_story_texts.emplace_back();
-    m_story_texts.back().push_back("Quite soon he got used to");
-    m_story_texts.back().push_back("the place...");
-    m_story_texts.emplace_back();
-    m_story_texts.back().push_back("He could jump to escape from");
-    m_story_texts.back().push_back("the chase...");
-    m_story_texts.emplace_back();
-    m_story_texts.back().push_back("But without careful thought...");
-    m_story_texts.emplace_back();
-    m_story_texts.back().push_back("His leaps came to nought...");
-    m_story_texts.emplace_back();
-    m_story_texts.back().push_back("And he left with a much");
-    m_story_texts.back().push_back("wider face...");
-    m_story_texts.emplace_back();
-    m_story_texts.back().push_back("Things seemed just as bad as");
-    m_story_texts.back().push_back("could be...");
-    m_story_texts.emplace_back();
-    m_story_texts.back().push_back("Hostile faces were all Jack");
-    m_story_texts.back().push_back("could see...");
-    m_story_texts.emplace_back();
-    m_story_texts.back().push_back("He tried to stay calm...");
-    m_story_texts.emplace_back();
-    m_story_texts.back().push_back("And come to no harm");
-    m_story_texts.emplace_back();
-    m_story_texts.back().push_back("But more often got squashed");
-    m_story_texts.back().push_back("like a flea...");
-    m_story_texts.emplace_back();
-    m_story_texts.back().push_back("By now Jack was in a");
-    m_story_texts.back().push_back("great flap...");
-    m_story_texts.emplace_back();
-    m_story_texts.back().push_back("He felt like a rat in a trap");
-    m_story_texts.emplace_back();
-    m_story_texts.back().push_back("If only he'd guessed...");
-    m_story_texts.emplace_back();
-    m_story_texts.back().push_back("That soon he could rest...");
-    m_story_texts.emplace_back();
-    m_story_texts.back().push_back("After jumping the very");
-    m_story_texts.back().push_back("very last gap.  - WELL DONE");
+    m_story_texts.resize(m_manifest.stanzaCount());
+    for(std::size_t i = 0; i < m_story_texts.size(); ++i) {
+        const manifest::Stanza& stanza = m_manifest.getStanza(i);
+        for(std::uint32_t l = 0; l < stanza.line_count; ++l)
+            m_story_texts[i].push_back(m_manifest.getString(m_manifest.getStoryLine(stanza.first_line + l).text));
+    }
 }
 
-void Game::loadAnimations() {
-    sf::Texture& spritesheet = m_textures["spritesheet_players"];
-    
-    const unsigned size_x = m_sheet_block_size;
-    const unsigned size_y = m_sheet_block_size * 2;
-    
-    // Pink, player character
-    m_animations["pink_stand_mid"].setSpriteSheet(spritesheet);
-    m_animations["pink_stand_mid"].addFrame(sf::IntRect((4-1)*size_x, (6-1)*size_y, size_x, size_y));
-    
-    m_animations["pink_stand_side"].setSpriteSheet(spritesheet);
-    m_animations["pink_stand_side"].addFrame(sf::IntRect((4-1)*size_x, (3-1)*size_y, size_x, size_y));
-    
-    m_animations["pink_walk"].setSpriteSheet(spritesheet);
-    m_animations["pink_walk"].addFrame(sf::IntRect((3-1)*size_x, (7-1)*size_y, size_x, size_y));
-    m_animations["pink_walk"].addFrame(sf::IntRect((3-1)*size_x, (8-1)*size_y, size_x, size_y));
-    m_animations["pink_walk"].addFrame(sf::IntRect((4-1)*size_x, (1-1)*size_y, size_x, size_y));
-    m_animations["pink_walk"].addFrame(sf::IntRect((4-1)*size_x, (2-1)*size_y, size_x, size_y));
-    
-    m_animations["pink_stun"].setSpriteSheet(spritesheet);
-    m_animations["pink_stun"].addFrame(sf::IntRect((4-1)*size_x, (7-1)*size_y, size_x, size_y));
-    
-    m_animations["pink_climb"].setSpriteSheet(spritesheet);
-    m_animations["pink_climb"].addFrame(sf::IntRect((4-1)*size_x, (8-1)*size_y, size_x, size_y));
-    m_animations["pink_climb"].addFrame(sf::IntRect((5-1)*size_x, (1-1)*size_y, size_x, size_y));
+// Copies every frame into a cell of its own with a transparent border, aligned so that the mip levels
+// the players are drawn at never sample two frames at once
+void Game::bakePlayerSheet(const sf::Image& sheet) {
+    const int padding = PLAYER_FRAME_PADDING;
+    const int max_width = std::min(sf::Texture::getMaximumSize(), PLAYER_SHEET_WIDTH);
+    auto align = [padding](int size) { return (size + 2*padding + padding - 1) / padding * padding; };
+    
+    // Lay out the cells in rows, frames used by several animations are only baked once
+    const std::size_t frame_count = m_manifest.frameCount();
+    std::vector<std::size_t> sources(frame_count);
+    m_player_frames.resize(frame_count);
+    int x = 0, y = 0, row_height = 0, width = 0;
+    for(std::size_t i = 0; i < frame_count; ++i) {
+        const manifest::Frame& frame = m_manifest.getFrame(i);
+        
+        sources[i] = i;
+        for(std::size_t j = 0; j < i; ++j) {
+            const manifest::Frame& other = m_manifest.getFrame(j);
+            if(other.left == frame.left && other.top == frame.top && other.width == frame.width && other.height == frame.height) {
+                sources[i] = j;
+                break;
+            }
+        }
+        if(sources[i] != i) {
+            m_player_frames[i] = m_player_frames[sources[i]];
+            continue;
+        }
+        
+        const int cell_width = align(frame.width);
+        if(x > 0 && x + cell_width > max_width) {
+            x = 0;
+            y += row_height;
+            row_height = 0;
+        }
+        m_player_frames[i] = manifest::Frame{x + padding, y + padding, frame.width, frame.height};
+        x += cell_width;
+        width = std::max(width, x);
+        row_height = std::max(row_height, align(frame.height));
+    }
     
-    m_animations["pink_jump"].setSpriteSheet(spritesheet);
-    m_animations["pink_jump"].addFrame(sf::IntRect((7-1)*size_x, (7-1)*size_y, size_x, size_y));
+    sf::Image baked;
+    baked.create(std::max(width, 1), std::max(y + row_height, 1), sf::Color::Transparent);
+    for(std::size_t i = 0; i < frame_count; ++i) {
+        if(sources[i] != i) continue;
+        const manifest::Frame& frame = m_manifest.getFrame(i);
+        baked.copy(sheet, m_player_frames[i].left, m_player_frames[i].top, sf::IntRect(frame.left, frame.top, frame.width, frame.height));
+    }
     
-    m_animations["pink_fall"].setSpriteSheet(spritesheet);
-    m_animations["pink_fall"].addFrame(sf::IntRect((4-1)*size_x, (5-1)*size_y, size_x, size_y));
+    sf::Texture& texture = m_textures["spritesheet_players"];
+    if(!texture.loadFromImage(baked)) loadFailed("spritesheet_players.png");
+    texture.setSmooth(true);
+    texture.generateMipmap();
+}
 
+void Game::loadAnimations() {
+    sf::Texture& spritesheet = m_textures["spritesheet_players"];
     
-    
-    // Green character
-    m_hazard_names.push_back("green");
-    
-    m_animations["green_stand_mid"].setSpriteSheet(spritesheet);
-    m_animations["green_stand_mid"].addFrame(sf::IntRect((6-1)*size_x, (1-1)*size_y, size_x, size_y));
-    
-    m_animations["green_stand_side"].setSpriteSheet(spritesheet);
-    m_animations["green_stand_side"].addFrame(sf::IntRect((5-1)*size_x, (6-1)*size_y, size_x, size_y));
-    
-    m_animations["green_walk"].setSpriteSheet(spritesheet);
-    m_animations["green_walk"].addFrame(sf::IntRect((5-1)*size_x, (2-1)*size_y, size_x, size_y));
-    m_animations["green_walk"].addFrame(sf::IntRect((5-1)*size_x, (3-1)*size_y, size_x, size_y));
-    m_animations["green_walk"].addFrame(sf::IntRect((5-1)*size_x, (4-1)*size_y, size_x, size_y));
-    m_animations["green_walk"].addFrame(sf::IntRect((5-1)*size_x, (5-1)*size_y, size_x, size_y));
-    
-    m_animations["green_stun"].setSpriteSheet(spritesheet);
-    m_animations["green_stun"].addFrame(sf::IntRect((6-1)*size_x, (2-1)*size_y, size_x, size_y));
-    
-    m_animations["green_climb"].setSpriteSheet(spritesheet);
-    m_animations["green_climb"].addFrame(sf::IntRect((6-1)*size_x, (3-1)*size_y, size_x, size_y));
-    m_animations["green_climb"].addFrame(sf::IntRect((6-1)*size_x, (4-1)*size_y, size_x, size_y));
-    
-    m_animations["green_jump"].setSpriteSheet(spritesheet);
-    m_animations["green_jump"].addFrame(sf::IntRect((5-1)*size_x, (7-1)*size_y, size_x, size_y));
-    
-    m_animations["green_fall"].setSpriteSheet(spritesheet);
-    m_animations["green_fall"].addFrame(sf::IntRect((5-1)*size_x, (8-1)*size_y, size_x, size_y));
-    
-    
-    
-    // Gray character
-    m_hazard_names.push_back("gray");
-    
-    m_animations["gray_stand_mid"].setSpriteSheet(spritesheet);
-    m_animations["gray_stand_mid"].addFrame(sf::IntRect((1-1)*size_x, (8-1)*size_y, size_x, size_y));
-    
-    m_animations["gray_stand_side"].setSpriteSheet(spritesheet);
-    m_animations["gray_stand_side"].addFrame(sf::IntRect((1-1)*size_x, (5-1)*size_y, size_x, size_y));
-    
-    m_animations["gray_walk"].setSpriteSheet(spritesheet);
-    m_animations["gray_walk"].addFrame(sf::IntRect((1-1)*size_x, (1-1)*size_y, size_x, size_y));
-    m_animations["gray_walk"].addFrame(sf::IntRect((1-1)*size_x, (2-1)*size_y, size_x, size_y));
-    m_animations["gray_walk"].addFrame(sf::IntRect((1-1)*size_x, (3-1)*size_y, size_x, size_y));
-    m_animations["gray_walk"].addFrame(sf::IntRect((1-1)*size_x, (4-1)*size_y, size_x, size_y));
-    
-    m_animations["gray_stun"].setSpriteSheet(spritesheet);
-    m_animations["gray_stun"].addFrame(sf::IntRect((2-1)*size_x, (1-1)*size_y, size_x, size_y));
-    
-    m_animations["gray_climb"].setSpriteSheet(spritesheet);
-    m_animations["gray_climb"].addFrame(sf::IntRect((2-1)*size_x, (2-1)*size_y, size_x, size_y));
-    m_animations["gray_climb"].addFrame(sf::IntRect((2-1)*size_x, (3-1)*size_y, size_x, size_y));
-    
-    m_animations["gray_jump"].setSpriteSheet(spritesheet);
-    m_animations["gray_jump"].addFrame(sf::IntRect((1-1)*size_x, (6-1)*size_y, size_x, size_y));
-    
-    m_animations["gray_fall"].setSpriteSheet(spritesheet);
-    m_animations["gray_fall"].addFrame(sf::IntRect((1-1)*size_x, (7-1)*size_y, size_x, size_y));
-    
-    
-    
-    // Yellow character
-    m_hazard_names.push_back("yellow");
-    
-    m_animations["yellow_stand_mid"].setSpriteSheet(spritesheet);
-    m_animations["yellow_stand_mid"].addFrame(sf::IntRect((3-1)*size_x, (3-1)*size_y, size_x, size_y));
-    
-    m_animations["yellow_stand_side"].setSpriteSheet(spritesheet);
-    m_animations["yellow_stand_side"].addFrame(sf::IntRect((2-1)*size_x, (8-1)*size_y, size_x, size_y));
-    
-    m_animations["yellow_walk"].setSpriteSheet(spritesheet);
-    m_animations["yellow_walk"].addFrame(sf::IntRect((2-1)*size_x, (4-1)*size_y, size_x, size_y));
-    m_animations["yellow_walk"].addFrame(sf::IntRect((2-1)*size_x, (5-1)*size_y, size_x, size_y));
-    m_animations["yellow_walk"].addFrame(sf::IntRect((2-1)*size_x, (6-1)*size_y, size_x, size_y));
-    m_animations["yellow_walk"].addFrame(sf::IntRect((2-1)*size_x, (7-1)*size_y, size_x, size_y));
-    
-    m_animations["yellow_stun"].setSpriteSheet(spritesheet);
-    m_animations["yellow_stun"].addFrame(sf::IntRect((3-1)*size_x, (4-1)*size_y, size_x, size_y));
-    
-    m_animations["yellow_climb"].setSpriteSheet(spritesheet);
-    m_animations["yellow_climb"].addFrame(sf::IntRect((3-1)*size_x, (5-1)*size_y, size_x, size_y));
-    m_animations["yellow_climb"].addFrame(sf::IntRect((3-1)*size_x, (6-1)*size_y, size_x, size_y));
-    
-    m_animations["yellow_jump"].setSpriteSheet(spritesheet);
-    m_animations["yellow_jump"].addFrame(sf::IntRect((3-1)*size_x, (1-1)*size_y, size_x, size_y));
-    
-    m_animations["yellow_fall"].setSpriteSheet(spritesheet);
-    m_animations["yellow_fall"].addFrame(sf::IntRect((3-1)*size_x, (2-1)*size_y, size_x, size_y));
-    
-    
-    
-    // Blue character
-    m_hazard_names.push_back("blue");
-    
-    m_animations["blue_stand_mid"].setSpriteSheet(spritesheet);
-    m_animations["blue_stand_mid"].addFrame(sf::IntRect((7-1)*size_x, (4-1)*size_y, size_x, size_y));
-    
-    m_animations["blue_stand_side"].setSpriteSheet(spritesheet);
-    m_animations["blue_stand_side"].addFrame(sf::IntRect((7-1)*size_x, (1-1)*size_y, size_x, size_y));
-    
-    m_animations["blue_walk"].setSpriteSheet(spritesheet);
-    m_animations["blue_walk"].addFrame(sf::IntRect((6-1)*size_x, (5-1)*size_y, size_x, size_y));
-    m_animations["blue_walk"].addFrame(sf::IntRect((6-1)*size_x, (6-1)*size_y, size_x, size_y));
-    m_animations["blue_walk"].addFrame(sf::IntRect((6-1)*size_x, (7-1)*size_y, size_x, size_y));
-    m_animations["blue_walk"].addFrame(sf::IntRect((6-1)*size_x, (8-1)*size_y, size_x, size_y));
-    
-    m_animations["blue_stun"].setSpriteSheet(spritesheet);
-    m_animations["blue_stun"].addFrame(sf::IntRect((7-1)*size_x, (5-1)*size_y, size_x, size_y));
-    
-    m_animations["blue_climb"].setSpriteSheet(spritesheet);
-    m_animations["blue_climb"].addFrame(sf::IntRect((4-1)*size_x, (4-1)*size_y, size_x, size_y));
-    m_animations["blue_climb"].addFrame(sf::IntRect((7-1)*size_x, (6-1)*size_y, size_x, size_y));
-    
-    m_animations["blue_jump"].setSpriteSheet(spritesheet);
-    m_animations["blue_jump"].addFrame(sf::IntRect((7-1)*size_x, (2-1)*size_y, size_x, size_y));
-    
-    m_animations["blue_fall"].setSpriteSheet(spritesheet);
-    m_animations["blue_fall"].addFrame(sf::IntRect((7-1)*size_x, (3-1)*size_y, size_x, size_y));
+    for(std::size_t i = 0; i < m_manifest.animationCount(); ++i) {
+        const manifest::Animation& a = m_manifest.getAnimation(i);
+        
+        Animation& animation = m_animations[m_manifest.getString(a.name)];
+        animation.setSpriteSheet(spritesheet);
+        animation.setFrames(&m_player_frames[a.first_frame], a.frame_count);
+    }
 }
@@ -4,10 +4,24 @@
 #include <SFML/Graphics.hpp>
 #include <SFML/Audio.hpp>
 #include <unordered_map>
+#include <map>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
 
-#include "Entity.hpp"
-#include "Hole.hpp"
-#include "Player.hpp"
+#include "World.hpp"
+#include "Planner.hpp"
+#include "Replay.hpp"
+#include "FrameWriter.hpp"
+#include "Audio.hpp"
+#include "FlightRecorder.hpp"
+#include "Ghost.hpp"
+#include "Versus.hpp"
+#include "Spectator.hpp"
+#include "Manifest.hpp"
+#include "Library/TripleBuffer.hpp"
 
 class Game {
     Game();
@@ -16,133 +30,176 @@ public:
     static Game& i() { return m_instance; }
     
     // Called by main.cpp
-    void run();
-    
-    // Events
-    enum GAME_EVENT {
-        GAME_OVER,
-        DROPPED_TO_BOTTOM, REACHED_TO_TOP,
-        STARTED_JUMPING, STOPPED_JUMPING,
-        STARTED_FALLING, STOPPED_FALLING,
-        HIT_BY_HAZARD, STOPPED_HAZARD_HIT,
-        HIT_HEAD, STOPPED_HIT_HEAD,
-        STARTED_WALKING, STOPPED_WALKING,
-        STOPPED_STUN, PLAYER_TURNED
-    };
-    
-    // Game
-    void trigger(GAME_EVENT event);
-    float getGlobalTimer();
-    sf::Vector2f getViewSize();
-    float getSpritesheetBlockSize();
-    float getTileHeight();
-    const Animation& getAnimation(std::string name);
-    
-    // World
-    float getFloorHeight();
-    int getBottomFloor();
-    
-    // Objects
-    const std::vector<std::unique_ptr<Entity>>& getHazards();
-    const std::vector<std::unique_ptr<Hole>>& getHoles();
+    void setSeed(unsigned seed);
+    void setFloorCount(int floor_count);
+    void setEndless(bool endless);
+    void setGenerateLevels(bool generate_levels);
+    void setFlightFile(const std::string& file_name);
+    void setTimeAttack(const std::string& ghost_file);
+    void setVersus(std::uint16_t local_port, const std::string& host, std::uint16_t remote_port);
+    void setInputDelay(std::size_t tick_count);
+    void setSimulatedLink(float latency, float loss);
+    void setBroadcast(const std::string& path);
+    void run(const std::string& record_file = "");
+    bool renderReplay(const std::string& replay_file, const std::string& output, const sf::Vector2u& size,
+                      unsigned fps, FrameWriter::FORMAT format);
+    bool verifyReplay(const std::string& replay_file, const std::string& tick_hash = "");
+    bool verifyGolden();
+    bool soak(std::size_t tick_count);
+    bool versusTest(std::size_t tick_count);
+    bool allocTest(std::size_t frame_count);
+    bool spectate(const std::string& path);
     
 private:
 // Functions
     // Global
     void init();
+    void simulate();
     void update();
+    void updateRun(bool game_over);
     void render();
-    void checkGameEvents();
+    void playEventSounds();
+    unsigned readKeys() const;
+    void setSimulationInput(unsigned keys, bool paused);
+    bool handleEvent(const sf::Event& event);
+    void drawFrame(sf::RenderTarget& target, World& world);
+    void drawVersusFrame(sf::RenderTarget& target, World& local, World& remote);
 
     void playSound(const std::string& name);
     void setSoundLoop(const std::string& name, bool loop);
-    void drawText(const std::string& text, const sf::Vector2f& pos, bool centered = false,
+    void drawText(sf::RenderTarget& target, const char* text, const sf::Vector2f& pos, bool centered = false,
                   const sf::Color& color = sf::Color::White, const sf::Color& background_color = sf::Color::Transparent);
 
-    void drawGameplay();
-    void drawUI();
-    void drawInfoScreen();
+    void drawGameplay(sf::RenderTarget& target, World& world);
+    void drawGhosts(sf::RenderTarget& target, const World& world, int first_floor, int floor_count);
+    float getCameraY(const World& world) const;
+    void drawUI(sf::RenderTarget& target, const World& world);
+    void drawInfoScreen(sf::RenderTarget& target, const World& world);
     
     void loadAssets();
+    void bakePlayerSheet(const sf::Image& sheet);
     void loadAnimations();
     void loadStory();
-    void loadSound(const std::string& name);
+    void loadSound(const std::string& name, bool looping = false);
     
     void changeTheme(int level);
     
-    // Game
-    void changeLevel(int level);
-    void nextLevel();
-    void prevLevel();
-    void restart();
-    void addScore();
-    void levelFinished();
-    void gameOver();
-    bool inInfoScreen();
-    void resetEffects();
-
-    // Objects
-    void spawnHole();
-    void spawnHazard();
+    // Level generation
+    void startLevelGeneration();
+    float targetWinRate(int level);
+    const LevelLayout* getGeneratedLayout(int level);
 
 // Variables
     // Assets
+    Manifest m_manifest;
     std::string m_game_title;
     std::vector<std::vector<std::string>> m_story_texts;
-    std::unordered_map<std::string, sf::Texture> m_textures;
+    std::map<std::string, sf::Texture, std::less<>> m_textures;
     std::unordered_map<std::string, sf::Sprite> m_sprites;
-    std::unordered_map<std::string, Animation> m_animations;
-    std::unordered_map<std::string, sf::SoundBuffer> m_sound_buffers;
-    std::unordered_map<std::string, sf::Sound> m_looping_sounds;
-    std::vector<sf::Sound> m_sounds;
-    sf::Music* m_music;
+    AnimationTable m_animations;
+    std::vector<manifest::Frame> m_player_frames; // Manifest frames moved to the baked players sheet
+    const std::size_t m_sound_cache_size;
+    std::unique_ptr<sf::Music> m_music;
     sf::Font m_font;
-
-    unsigned m_background_count;
-    std::size_t m_curr_hazard;
-    std::vector<std::string> m_hazard_names;
-    const unsigned m_sheet_block_size;
-    const float m_tile_height;
     
-    // Global
-    const float m_dt;
-    const sf::Vector2f m_view_size;
-    float m_line_height;
-    
-    float m_global_timer;
-    float m_timescale;
-    const float m_slow_mo_timescale;
-    
-    // Game
-    std::vector<GAME_EVENT> m_events;
-    int m_level;
-    int m_last_level;
-    bool m_game_over;
-    bool m_changing_level;
-    unsigned m_health;
-    
-    const float m_changing_level_time;
-    const unsigned m_start_health;
-    
-    // Objects
-    std::vector<std::unique_ptr<Entity>> m_hazards;
-    std::vector<std::unique_ptr<Hole>> m_holes;
-    std::unique_ptr<Player> m_player;
-    const int m_floor_count;
-    const std::size_t m_max_hole_count;
-    
-    // Score
-    const unsigned m_score_base;
-    unsigned m_score_increase;
-    unsigned m_score;
-    unsigned m_highscore;
-    bool m_new_high;
+    // World, only touched by the simulation thread while running
+    World m_world;
+    int m_theme_level;
+    unsigned m_seed;
+    int m_floor_count;
+    bool m_endless;
+    
+    // Simulation thread
+    // The window thread samples the keys, the simulation thread sends back copies of the world to draw
+    enum CHEAT_KEY {
+        CHEAT_PREV_LEVEL = 1 << 8, CHEAT_NEXT_LEVEL = 1 << 9, CHEAT_GAME_OVER = 1 << 10,
+        CHEAT_FINISH_LEVEL = 1 << 11, CHEAT_AUTOPLAY = 1 << 12,
+        LEVEL_CHEATS = CHEAT_PREV_LEVEL | CHEAT_NEXT_LEVEL | CHEAT_GAME_OVER | CHEAT_FINISH_LEVEL
+    };
+    std::thread m_sim_thread;
+    std::atomic<bool> m_running;
+    std::atomic<unsigned> m_keys;
+    unsigned m_prev_keys;
+    TripleBuffer<World> m_snapshots;
+    
+    // Power saving
+    // Nothing ticks or draws while the window is in the background, info screens tick and draw
+    // only a few times a second. Key changes and the window coming back wake the simulation.
+    std::mutex m_sim_mutex;
+    std::condition_variable m_sim_wake;
+    bool m_paused; // Guarded by m_sim_mutex
+    bool m_focused;
+    const float m_idle_interval;
+    const float m_idle_poll_interval;
+    
+    // Replay, recorded only when there is a file to save it to. Level cheats change the world
+    // outside its inputs, a replay they were used in couldn't be played back and isn't saved.
+    std::string m_record_file;
+    Replay m_replay;
+    bool m_replay_cheated;
+    
+    // Flight recorder, dumped on a crash, on game over and on F12
+    FlightRecorder m_flight_recorder;
+    
+    // Time attack, runs from the first level on are recorded and the best are kept in the ghost
+    // file. The ghosts drawn are the best runs there were when the game started.
+    static const unsigned NO_RUN = ~0u;
+    std::string m_ghost_file;
+    BestRuns m_best_runs;
+    BestRuns::Run m_run;
+    bool m_run_cheated;
+    std::atomic<unsigned> m_run_start_tick; // World tick of the run's first sample, NO_RUN between runs
+    std::vector<BestRuns::Run> m_ghost_runs;
+    std::vector<GhostTrack::Cursor> m_ghost_cursors; // Window thread
+    unsigned m_ghost_run_start;
+    sf::VertexArray m_ghost_vertices;
+    const sf::Texture* m_ghost_texture; // Looked up once the mode starts
+    
+    // Versus, a race against a player on another machine. The level cheats are off, they change
+    // the world without going through the input.
+    Versus m_versus;
+    std::string m_versus_host; // Empty when playing alone
+    std::uint16_t m_versus_local_port;
+    std::uint16_t m_versus_remote_port;
+    std::size_t m_input_delay;
+    float m_net_latency;
+    float m_net_loss;
+    TripleBuffer<World> m_remote_snapshots;
+    std::atomic<int> m_race_result;
+    std::atomic<bool> m_opponent_waiting;
+    
+    // Spectators, other processes on this machine that watch the game over a socket
+    std::string m_broadcast_path;
+    SpectatorFeed m_spectators;
+    
+    // Autoplay
+    Planner m_planner;
+    bool m_autoplay;
+    
+    // Level generation
+    bool m_generate_levels;
+    std::vector<LevelLayout> m_level_layouts;
+    std::atomic<int> m_generated_level_count;
+    std::atomic<bool> m_stop_generation;
+    std::thread m_generator_thread;
+    
+    // Audio
+    Audio m_audio;
     
     // Render
+    Arena m_frame_arena; // Reset after every frame
+    sf::Clock m_frame_clock;
+    std::vector<sf::Text> m_texts;
+    std::vector<std::string> m_text_strings;
+    std::size_t m_text_count;
+    sf::RectangleShape m_text_background;
+    sf::RectangleShape m_info_filter;
     sf::RenderWindow m_window;
+    sf::Image m_ground_image;
+    sf::Texture m_tile_texture;
+    sf::RenderTexture m_level_layer;
     sf::RenderTexture m_hole_texture;
     sf::RectangleShape m_effect_rect;
-    sf::Color m_effect_color;
 };
 
 #endif /* Game_hpp */
@@ -0,0 +1,271 @@
+#include "Ghost.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+// A tick is a byte of CHANGE flags and then, for each flag set in order, a varint of the zigzagged
+// difference or a raw byte. X is predicted to move by the same step as the tick before.
+// A ghost file is the header and then each run as its level count, tick count, byte count and bytes.
+namespace {
+    enum CHANGE {
+        FLOOR = 1 << 0, X = 1 << 1, DRAW_OFFSET = 1 << 2,
+        ANIMATION = 1 << 3, FRAME = 1 << 4, FACING = 1 << 5
+    };
+    
+    const float POSITION_SCALE = 16;
+    
+    const char MAGIC[4] = { 'J', 'J', 'G', 'H' };
+    const std::uint32_t VERSION = 1;
+    
+    struct Header {
+        char magic[4];
+        std::uint32_t version;
+        std::uint32_t seed;
+        std::int32_t floor_count;
+        std::uint32_t endless;
+        std::uint32_t run_count;
+    };
+    
+    struct RunHeader {
+        std::int32_t level_count;
+        std::uint32_t tick_count;
+        std::uint32_t byte_count;
+    };
+    
+    std::int32_t quantize(float position) { return static_cast<std::int32_t>(std::lround(position * POSITION_SCALE)); }
+    
+    bool readDelta(const std::vector<std::uint8_t>& bytes, std::size_t& offset, std::int32_t& delta) {
+        std::uint32_t zigzag = 0;
+        for(unsigned shift = 0; shift < 35; shift += 7) {
+            if(offset >= bytes.size()) return false;
+            const std::uint8_t byte = bytes[offset++];
+            zigzag |= static_cast<std::uint32_t>(byte & 0x7F) << shift;
+            if(!(byte & 0x80)) {
+                delta = static_cast<std::int32_t>(zigzag >> 1) ^ -static_cast<std::int32_t>(zigzag & 1);
+                return true;
+            }
+        }
+        return false;
+    }
+}
+
+GhostTrack::GhostTrack() :
+    m_tick_count(0) {}
+
+GhostTrack::Cursor::Cursor() :
+    offset(0),
+    tick_count(0),
+    x_step(0),
+    sample() {}
+
+// Recording
+void GhostTrack::record(const Entity::Look& look) {
+    Sample sample;
+    sample.floor = look.floor;
+    sample.x = quantize(look.x);
+    sample.draw_offset_y = quantize(look.draw_offset_y);
+    sample.animation = look.animation;
+    sample.frame = look.frame;
+    sample.facing = look.facing;
+    
+    const Sample& last = m_end.sample;
+    const std::int32_t x_step = sample.x - last.x;
+    
+    std::uint8_t changes = 0;
+    if(sample.floor != last.floor) changes |= FLOOR;
+    if(x_step != m_end.x_step) changes |= X;
+    if(sample.draw_offset_y != last.draw_offset_y) changes |= DRAW_OFFSET;
+    if(sample.animation != last.animation) changes |= ANIMATION;
+    if(sample.frame != last.frame) changes |= FRAME;
+    if(sample.facing != last.facing) changes |= FACING;
+    
+    m_bytes.push_back(changes);
+    if(changes & FLOOR) writeDelta(sample.floor - last.floor);
+    if(changes & X) writeDelta(x_step - m_end.x_step);
+    if(changes & DRAW_OFFSET) writeDelta(sample.draw_offset_y - last.draw_offset_y);
+    if(changes & ANIMATION) m_bytes.push_back(sample.animation);
+    if(changes & FRAME) m_bytes.push_back(sample.frame);
+    if(changes & FACING) m_bytes.push_back(static_cast<std::uint8_t>(sample.facing));
+    
+    m_end.offset = m_bytes.size();
+    m_end.tick_count = ++m_tick_count;
+    m_end.x_step = x_step;
+    m_end.sample = sample;
+}
+
+void GhostTrack::writeDelta(std::int32_t delta) {
+    std::uint32_t zigzag = (static_cast<std::uint32_t>(delta) << 1) ^ static_cast<std::uint32_t>(delta >> 31);
+    while(zigzag >= 0x80) {
+        m_bytes.push_back(static_cast<std::uint8_t>(zigzag | 0x80));
+        zigzag >>= 7;
+    }
+    m_bytes.push_back(static_cast<std::uint8_t>(zigzag));
+}
+
+void GhostTrack::clear() {
+    m_bytes.clear();
+    m_tick_count = 0;
+    m_end = Cursor();
+}
+
+void GhostTrack::reserve(std::size_t byte_count) { m_bytes.reserve(byte_count); }
+
+// Playback, false at the end of the track or on bytes that don't decode
+bool GhostTrack::next(Cursor& cursor) const {
+    if(cursor.tick_count >= m_tick_count || cursor.offset >= m_bytes.size()) return false;
+    
+    std::size_t offset = cursor.offset;
+    Sample sample = cursor.sample;
+    std::int32_t x_step = cursor.x_step;
+    std::int32_t delta = 0;
+    
+    const std::uint8_t changes = m_bytes[offset++];
+    if(changes & FLOOR) {
+        if(!readDelta(m_bytes, offset, delta)) return false;
+        sample.floor += delta;
+    }
+    if(changes & X) {
+        if(!readDelta(m_bytes, offset, delta)) return false;
+        x_step += delta;
+    }
+    if(changes & DRAW_OFFSET) {
+        if(!readDelta(m_bytes, offset, delta)) return false;
+        sample.draw_offset_y += delta;
+    }
+    const std::size_t raw_count = (changes & ANIMATION ? 1 : 0) + (changes & FRAME ? 1 : 0) + (changes & FACING ? 1 : 0);
+    if(offset + raw_count > m_bytes.size()) return false;
+    if(changes & ANIMATION) sample.animation = m_bytes[offset++];
+    if(changes & FRAME) sample.frame = m_bytes[offset++];
+    if(changes & FACING) sample.facing = static_cast<std::int8_t>(m_bytes[offset++]);
+    sample.x += x_step;
+    
+    cursor.offset = offset;
+    ++cursor.tick_count;
+    cursor.x_step = x_step;
+    cursor.sample = sample;
+    return true;
+}
+
+Entity::Look GhostTrack::Cursor::getLook() const {
+    Entity::Look look;
+    look.floor = sample.floor;
+    look.x = sample.x / POSITION_SCALE;
+    look.draw_offset_y = sample.draw_offset_y / POSITION_SCALE;
+    look.animation = sample.animation;
+    look.frame = sample.frame;
+    look.facing = sample.facing;
+    return look;
+}
+
+// Files
+bool GhostTrack::write(std::ostream& out) const {
+    out.write(reinterpret_cast<const char*>(m_bytes.data()), m_bytes.size());
+    return static_cast<bool>(out);
+}
+
+// Decoded once to find where recording left off, a track that doesn't decode is cleared
+bool GhostTrack::read(std::istream& in, std::size_t tick_count, std::size_t byte_count) {
+    m_bytes.resize(byte_count);
+    m_tick_count = tick_count;
+    if(!in.read(reinterpret_cast<char*>(m_bytes.data()), m_bytes.size())) {
+        clear();
+        return false;
+    }
+    
+    Cursor cursor;
+    while(next(cursor)) {}
+    if(cursor.tick_count != m_tick_count || cursor.offset != m_bytes.size()) {
+        clear();
+        return false;
+    }
+    m_end = cursor;
+    return true;
+}
+
+// Getters
+std::size_t GhostTrack::getTickCount() const { return m_tick_count; }
+std::size_t GhostTrack::getByteCount() const { return m_bytes.size(); }
+
+BestRuns::Run::Run() :
+    level_count(0) {}
+
+BestRuns::BestRuns() :
+    m_seed(0),
+    m_floor_count(0),
+    m_endless(false) {}
+
+void BestRuns::setWorld(unsigned seed, int floor_count, bool endless) {
+    if(seed == m_seed && floor_count == m_floor_count && endless == m_endless) return;
+    
+    m_seed = seed;
+    m_floor_count = floor_count;
+    m_endless = endless;
+    m_runs.clear();
+}
+
+bool BestRuns::add(const Run& run) {
+    auto better = [](const Run& a, const Run& b) {
+        if(a.level_count != b.level_count) return a.level_count > b.level_count;
+        return a.track.getTickCount() < b.track.getTickCount();
+    };
+    
+    if(run.track.getTickCount() == 0) return false;
+    if(m_runs.size() == MAX_COUNT && !better(run, m_runs.back())) return false;
+    
+    m_runs.insert(std::upper_bound(m_runs.begin(), m_runs.end(), run, better), run);
+    if(m_runs.size() > MAX_COUNT) m_runs.pop_back();
+    return true;
+}
+
+// The runs are only kept when it is a ghost file of the world set
+bool BestRuns::loadFromFile(const std::string& file_name) {
+    std::ifstream file(file_name, std::ios::binary);
+    if(!file) return false;
+    
+    Header header;
+    if(!file.read(reinterpret_cast<char*>(&header), sizeof(header))) return false;
+    if(std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION) return false;
+    if(header.seed != m_seed || header.floor_count != m_floor_count || (header.endless != 0) != m_endless) return false;
+    
+    std::vector<Run> runs(std::min<std::size_t>(header.run_count, MAX_COUNT));
+    for(Run& run : runs) {
+        RunHeader run_header;
+        if(!file.read(reinterpret_cast<char*>(&run_header), sizeof(run_header))) return false;
+        
+        run.level_count = run_header.level_count;
+        if(!run.track.read(file, run_header.tick_count, run_header.byte_count)) return false;
+    }
+    
+    m_runs = std::move(runs);
+    return true;
+}
+
+bool BestRuns::saveToFile(const std::string& file_name) const {
+    std::ofstream file(file_name, std::ios::binary);
+    if(!file) return false;
+    
+    Header header;
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.seed = m_seed;
+    header.floor_count = m_floor_count;
+    header.endless = m_endless;
+    header.run_count = static_cast<std::uint32_t>(m_runs.size());
+    
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    for(const Run& run : m_runs) {
+        RunHeader run_header;
+        run_header.level_count = run.level_count;
+        run_header.tick_count = static_cast<std::uint32_t>(run.track.getTickCount());
+        run_header.byte_count = static_cast<std::uint32_t>(run.track.getByteCount());
+        
+        file.write(reinterpret_cast<const char*>(&run_header), sizeof(run_header));
+        run.track.write(file);
+    }
+    return static_cast<bool>(file);
+}
+
+// Getters
+const std::vector<BestRuns::Run>& BestRuns::getRuns() const { return m_runs; }
@@ -0,0 +1,90 @@
+#ifndef Ghost_hpp
+#define Ghost_hpp
+
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include "Entity.hpp"
+
+// Where the player was and how it looked on every tick of a run, delta compressed. A tick that
+// only walks on at the same speed takes a byte. Positions are kept to a sixteenth of a pixel.
+// Played back with cursors that decode one tick at a time without allocating.
+class GhostTrack {
+public:
+    GhostTrack();
+    
+    void record(const Entity::Look& look);
+    void clear();
+    void reserve(std::size_t byte_count);
+    
+    // Playback, a cursor starts before the first tick and next() moves it on
+    struct Sample {
+        std::int32_t floor;
+        std::int32_t x;
+        std::int32_t draw_offset_y;
+        std::uint8_t animation;
+        std::uint8_t frame;
+        std::int8_t facing;
+    };
+    struct Cursor {
+        Cursor();
+        Entity::Look getLook() const;
+        
+        std::size_t offset;
+        std::size_t tick_count; // Decoded so far, the sample is of tick tick_count - 1
+        std::int32_t x_step;
+        Sample sample;
+    };
+    bool next(Cursor& cursor) const;
+    
+    bool write(std::ostream& out) const;
+    bool read(std::istream& in, std::size_t tick_count, std::size_t byte_count);
+    
+    // Getters
+    std::size_t getTickCount() const;
+    std::size_t getByteCount() const;
+    
+private:
+// Functions
+    void writeDelta(std::int32_t delta);
+    
+// Variables
+    std::vector<std::uint8_t> m_bytes;
+    std::size_t m_tick_count;
+    Cursor m_end; // Where recording left off
+};
+
+// The best runs of a world, ghosts of them show while playing it again. A run is better with
+// more levels finished and then with fewer ticks.
+class BestRuns {
+public:
+    static const std::size_t MAX_COUNT = 3;
+    
+    struct Run {
+        Run();
+        
+        int level_count;
+        GhostTrack track;
+    };
+    
+    BestRuns();
+    
+    void setWorld(unsigned seed, int floor_count, bool endless); // Clears the runs of another world
+    bool add(const Run& run); // False if it isn't better than the ones kept
+    
+    bool loadFromFile(const std::string& file_name);
+    bool saveToFile(const std::string& file_name) const;
+    
+    // Getters
+    const std::vector<Run>& getRuns() const;
+    
+private:
+    unsigned m_seed;
+    int m_floor_count;
+    bool m_endless;
+    std::vector<Run> m_runs; // Best first
+};
+
+#endif /* Ghost_hpp */
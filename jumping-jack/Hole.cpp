@@ -1,21 +1,31 @@
 #include "Hole.hpp"
 #include <SFML/Graphics.hpp>
 
-#include "Game.hpp"
+#include "World.hpp"
 
 // Render model, same for all holes
 sf::RectangleShape Hole::m_rect;
 
-Hole::Hole() : Entity(true, 72) {
-    m_draw_offset_y = -Game::i().getFloorHeight();
-    m_rect.setSize(sf::Vector2f(m_collision_size_x, Game::i().getTileHeight()));
-    m_rect.setOrigin(m_rect.getSize().x*0.5f, 0);
-    m_rect.setFillColor(sf::Color::Black);
+Hole::Hole(World& world) : Entity(world, true, 72) {
+    m_draw_offset_y = -m_world->getFloorHeight();
 }
 
-int Hole::getLowestFloor() { return Game::i().getBottomFloor(); }
+void Hole::resetState() {
+    Entity::resetState();
+    m_draw_offset_y = -m_world->getFloorHeight();
+}
+
+int Hole::getLowestFloor() const { return m_world->getBottomFloor(); }
 
 void Hole::drawSelf(sf::RenderTarget& target) {
+    // Shared model is set up on the first draw, worlds may be created on other threads
+    const float size_x = static_cast<float>(m_collision_size_x);
+    if(m_rect.getSize().x != size_x) {
+        m_rect.setSize(sf::Vector2f(size_x, m_world->getHoleHeight()));
+        m_rect.setOrigin(m_rect.getSize().x*0.5f, 0);
+        m_rect.setFillColor(sf::Color::Black);
+    }
+    
     // Draw a black rectangle
     m_rect.setPosition(getPosition());
     target.draw(m_rect, sf::BlendAlpha);
@@ -7,11 +7,12 @@
 
 class Hole : public Entity {
 public:
-    Hole();
+    Hole(World& world);
 
 protected:
     // Gameplay
-    virtual int getLowestFloor();
+    virtual int getLowestFloor() const;
+    virtual void resetState();
 
     // Render
     virtual void drawSelf(sf::RenderTarget& target);
@@ -0,0 +1,139 @@
+#include "LevelGenerator.hpp"
+#include "Library/Utility.hpp"
+
+#include <SFML/System/Clock.hpp>
+#include <cmath>
+
+#include "Bot.hpp"
+
+LevelGenerator::LevelGenerator(const Manifest& manifest, unsigned seed, std::size_t worker_count) :
+    m_manifest(manifest),
+    m_pool(worker_count),
+    m_random(seed),
+    m_last_win_rate(0),
+    m_max_candidates(24),
+    m_runs_per_candidate(48),
+    m_tolerance(0.05f),
+    m_time_budget(0.9f),
+    m_run_time_limit(40),
+    m_run_health(3),
+    m_min_skill(0.55f),
+    m_max_skill(1),
+    m_difficulty_step(1.5f),
+    m_min_hole_count(2),
+    m_max_hole_count(6) {
+    
+    for(std::size_t i = 0; i < m_pool.getWorkerCount(); ++i) {
+        m_worlds.push_back(std::make_unique<World>());
+        m_worlds.back()->setManifest(m_manifest);
+    }
+    m_results.resize(m_runs_per_candidate);
+}
+
+LevelLayout LevelGenerator::generate(int level, float target_win_rate) {
+    sf::Clock clock;
+    
+    LevelLayout best;
+    float best_error = 2;
+    
+    // Easy targets start easy, every miss moves the difficulty towards the target
+    float difficulty = 1 - target_win_rate;
+    
+    // Stop at the first close enough candidate, or when time is up
+    for(std::size_t i = 0; i < m_max_candidates && clock.getElapsedTime().asSeconds() < m_time_budget; ++i) {
+        LevelLayout candidate = propose(level, difficulty);
+        float win_rate = winRate(candidate, level);
+        
+        float error = std::abs(win_rate - target_win_rate);
+        if(error < best_error) {
+            best_error = error;
+            best = std::move(candidate);
+            m_last_win_rate = win_rate;
+        }
+        
+        if(best_error <= m_tolerance) break;
+        difficulty = std::min(std::max(difficulty + m_difficulty_step * (win_rate - target_win_rate), 0.0f), 1.0f);
+    }
+    
+    return best;
+}
+
+// Difficulty 0 has no hazards and the most holes, 1 has the hand made level's hazards and the
+// fewest holes. Where everything starts is random either way.
+LevelLayout LevelGenerator::propose(int level, float difficulty) {
+    const World& world = *m_worlds.front();
+    const int lowest_floor = world.getBottomFloor();
+    const float width = world.getViewSize().x;
+    const manifest::Level& params = m_manifest.getLevel(level);
+    
+    LevelLayout layout;
+    
+    const unsigned hazard_count = static_cast<unsigned>(std::lround(difficulty * params.hazard_count));
+    for(unsigned i = 0; i < hazard_count; ++i) {
+        LevelLayout::Spawn spawn;
+        spawn.floor = random_int(m_random, 0, lowest_floor - 1);
+        spawn.x = random_float(m_random, 0, width);
+        spawn.direction = random_int(m_random, 0, 3) == 0 ? 1 : -1;
+        spawn.speed = 300;
+        spawn.type = random_int(m_random, 0, static_cast<int>(world.getHazardTypeCount()) - 1);
+        layout.hazards.push_back(spawn);
+    }
+    
+    // Holes share one speed, more holes make it easier. Jumps are timed for holes near 300,
+    // much slower or faster ones are missed whatever the rest of the level is.
+    const int hole_count = static_cast<int>(std::lround(m_max_hole_count - difficulty * (m_max_hole_count - m_min_hole_count)));
+    const float hole_speed = random_float(m_random, 280, 320);
+    for(int i = 0; i < hole_count; ++i) {
+        LevelLayout::Spawn spawn;
+        spawn.floor = random_int(m_random, 0, lowest_floor);
+        spawn.x = random_float(m_random, 0, width);
+        spawn.direction = i % 2 == 0 ? 1 : -1;
+        spawn.speed = hole_speed;
+        spawn.type = 0;
+        layout.holes.push_back(spawn);
+    }
+    
+    return layout;
+}
+
+float LevelGenerator::winRate(const LevelLayout& layout, int level) {
+    const unsigned base_seed = m_random();
+    
+    m_pool.run(m_runs_per_candidate, [&](std::size_t run, std::size_t worker) {
+        m_results[run] = playthrough(*m_worlds[worker], layout, level, base_seed + static_cast<unsigned>(run));
+    });
+    
+    std::size_t wins = 0;
+    for(char won : m_results) wins += won;
+    return static_cast<float>(wins) / m_results.size();
+}
+
+bool LevelGenerator::playthrough(World& world, const LevelLayout& layout, int level, unsigned seed) {
+    world.seed(seed);
+    world.reset();
+    world.changeLevel(level, layout);
+    world.setHealth(m_run_health);
+    
+    // Skill is spread evenly over the runs
+    std::mt19937 random(seed);
+    Bot bot(seed, random_float(random, m_min_skill, m_max_skill));
+    
+    const int max_ticks = static_cast<int>(m_run_time_limit / world.getDt());
+    for(int tick = 0; tick < max_ticks; ++tick) {
+        // Bots have nothing to decide while the player is out of control
+        int skipped = world.fastForward(max_ticks - tick);
+        if(skipped > 0) {
+            tick += skipped - 1;
+            continue;
+        }
+        
+        world.update(bot.decide(world));
+        
+        if(world.isGameOver()) return false;
+        if(world.isChangingLevel()) return true;
+    }
+    
+    return false;
+}
+
+float LevelGenerator::getLastWinRate() const { return m_last_win_rate; }
@@ -0,0 +1,50 @@
+#ifndef LevelGenerator_hpp
+#define LevelGenerator_hpp
+
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "Library/ThreadPool.hpp"
+#include "World.hpp"
+
+// Proposes spawn layouts for a level and scores each one by letting bots of mixed skill
+// play it in headless worlds, spread over the workers. Each candidate is made harder or
+// easier by how far the last one missed, the layout whose win rate is closest to the
+// requested one is kept.
+class LevelGenerator {
+public:
+    LevelGenerator(const Manifest& manifest, unsigned seed, std::size_t worker_count = 0);
+    
+    LevelLayout generate(int level, float target_win_rate);
+    float getLastWinRate() const;
+    
+private:
+// Functions
+    LevelLayout propose(int level, float difficulty);
+    float winRate(const LevelLayout& layout, int level);
+    bool playthrough(World& world, const LevelLayout& layout, int level, unsigned seed);
+    
+// Variables
+    const Manifest& m_manifest;
+    ThreadPool m_pool;
+    std::vector<std::unique_ptr<World>> m_worlds; // One per worker
+    std::vector<char> m_results;
+    std::mt19937 m_random;
+    float m_last_win_rate;
+    
+    // Parameters
+    const std::size_t m_max_candidates;
+    const std::size_t m_runs_per_candidate;
+    const float m_tolerance;
+    const float m_time_budget;
+    const float m_run_time_limit;
+    const unsigned m_run_health;
+    const float m_min_skill;
+    const float m_max_skill;
+    const float m_difficulty_step; // Per unit of win rate missed
+    const int m_min_hole_count;
+    const int m_max_hole_count;
+};
+
+#endif /* LevelGenerator_hpp */
@@ -0,0 +1,28 @@
+#include "AllocationCounter.hpp"
+
+#include <cstdlib>
+#include <new>
+
+namespace {
+    thread_local bool t_counting = false;
+    thread_local std::size_t t_count = 0;
+}
+
+void start_counting_allocations() {
+    t_count = 0;
+    t_counting = true;
+}
+
+std::size_t stop_counting_allocations() {
+    t_counting = false;
+    return t_count;
+}
+
+void* operator new(std::size_t size) {
+    if(t_counting) ++t_count;
+    if(void* memory = std::malloc(size > 0 ? size : 1)) return memory;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept { std::free(memory); }
+void operator delete(void* memory, std::size_t) noexcept { std::free(memory); }
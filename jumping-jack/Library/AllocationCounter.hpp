@@ -0,0 +1,13 @@
+#ifndef ALLOCATIONCOUNTER_H
+#define ALLOCATIONCOUNTER_H
+
+#include <cstddef>
+
+// Counts what goes through operator new on the calling thread, other threads are left out.
+// Linking AllocationCounter.cpp replaces the global operator new and delete.
+void start_counting_allocations();
+
+// Returns the allocations since start_counting_allocations()
+std::size_t stop_counting_allocations();
+
+#endif // ALLOCATIONCOUNTER_H
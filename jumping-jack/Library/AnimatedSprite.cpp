@@ -1,5 +1,7 @@
 #include "AnimatedSprite.hpp"
 
+#include <algorithm>
+
 AnimatedSprite::AnimatedSprite(sf::Time frameTime, bool paused, bool looped) :
     m_animation(nullptr), m_frameTime(frameTime), m_currentFrame(0), m_isPaused(paused), m_isLooped(looped), m_texture(nullptr) {}
 
@@ -24,8 +26,7 @@ void AnimatedSprite::stop() {
 }
 
 void AnimatedSprite::resetAnim(){
-    m_currentFrame = 0;
-    m_currentTime = sf::Time::Zero;
+    setFrame(0);
 }
 
 void AnimatedSprite::setColor(const sf::Color& color) {
@@ -37,6 +38,8 @@ void AnimatedSprite::setColor(const sf::Color& color) {
 }
 
 sf::FloatRect AnimatedSprite::getLocalBounds() const {
+    if(!m_animation) return sf::FloatRect();
+
     sf::IntRect rect = m_animation->getFrame(m_currentFrame);
 
     float width = static_cast<float>(std::abs(rect.width));
@@ -53,13 +56,11 @@ bool AnimatedSprite::isPlaying() const { return !m_isPaused; }
 sf::Time AnimatedSprite::getFrameTime() const { return m_frameTime; }
 void AnimatedSprite::setFrameTime(sf::Time time) { m_frameTime = time; }
 std::size_t AnimatedSprite::getCurrentFrame() const { return m_currentFrame; }
-sf::Time AnimatedSprite::getCurrentTime() const { return m_currentTime; }
-void AnimatedSprite::setCurrentTime(const sf::Time& currentTime) { m_currentTime = currentTime; }
 const Animation* AnimatedSprite::getAnimation() const { return m_animation; }
 const sf::IntRect& AnimatedSprite::getAnimFrame() const { return getAnimation()->getFrame(getCurrentFrame()); }
 sf::FloatRect AnimatedSprite::getGlobalBounds() const { return getTransform().transformRect(getLocalBounds()); }
 
-void AnimatedSprite::setFrame(std::size_t newFrame, bool resetTime) {
+void AnimatedSprite::setFrame(std::size_t newFrame) {
     if(m_animation) {
         //calculate new vertex positions and texture coordiantes
         if(newFrame >= m_animation->getSize()) newFrame = m_animation->getSize() - 1;
@@ -80,34 +81,27 @@ void AnimatedSprite::setFrame(std::size_t newFrame, bool resetTime) {
         m_vertices[2].texCoords = sf::Vector2f(right, bottom);
         m_vertices[3].texCoords = sf::Vector2f(right, top);
     }
+}
 
-    if(resetTime)
-        m_currentTime = sf::Time::Zero;
+// Shows the frame for the given time since the animation started, nothing is kept between calls.
+// Vertices are only rewritten when the frame changes.
+void AnimatedSprite::setTime(sf::Time time) {
+    if(m_isPaused || !m_animation || m_animation->getSize() == 0) return;
+    
+    const std::size_t frame = getFrameAt(*m_animation, time);
+    if(frame != m_currentFrame) setFrame(frame);
 }
 
-void AnimatedSprite::updateAnim(float deltaTime) {
-    // if not paused and we have a valid animation
-    if(!m_isPaused && m_animation) {
-        // add delta time
-        m_currentTime += sf::seconds(deltaTime);
-
-        // if current time is bigger then the frame time advance one frame
-        if(m_currentTime >= m_frameTime) {
-            // reset time, but keep the remainder
-            m_currentTime = sf::microseconds(m_currentTime.asMicroseconds() % m_frameTime.asMicroseconds());
-
-            // get next Frame index
-            if(m_currentFrame + 1 < m_animation->getSize()) m_currentFrame++;
-            else {
-                // animation has ended
-                if(!m_isLooped) m_isPaused = true;
-                else m_currentFrame = 0; // reset to start
-            }
-
-            // set the current frame, not reseting the time
-            setFrame(m_currentFrame, false);
-        }
-    }
+// Frame of the animation at the given time since it started, with this sprite's timing
+std::size_t AnimatedSprite::getFrameAt(const Animation& animation, sf::Time time) const {
+    const std::size_t count = animation.getSize();
+    if(count == 0) return 0;
+    
+    const sf::Int64 frame_time = m_frameTime.asMicroseconds();
+    std::size_t frame = time > sf::Time::Zero && frame_time > 0 ? static_cast<std::size_t>(time.asMicroseconds() / frame_time) : 0;
+    
+    // Loop or stay on the last frame
+    return m_isLooped ? frame % count : std::min(frame, count - 1);
 }
 
 void AnimatedSprite::draw(sf::RenderTarget& target, sf::RenderStates states) const {
@@ -18,6 +18,12 @@ public:
     void addFrame(sf::IntRect rect) {
         m_frames.push_back(rect);
     }
+    template<class FrameRect> void setFrames(const FrameRect* frames, std::size_t count) {
+        m_frames.clear();
+        m_frames.reserve(count);
+        for(std::size_t i = 0; i < count; ++i)
+            m_frames.emplace_back(frames[i].left, frames[i].top, frames[i].width, frames[i].height);
+    }
     void setSpriteSheet(const sf::Texture& texture) {
         m_texture = &texture;
     }
@@ -41,10 +47,9 @@ public:
     explicit AnimatedSprite(sf::Time frameTime = sf::seconds(0.2f), bool paused = false, bool looped = true);
     virtual ~AnimatedSprite(){};
 
-    void updateAnim(float deltaTime);
+    void setTime(sf::Time time);
     void setAnimation(const Animation& animation);
     void setFrameTime(sf::Time time);
-    void setCurrentTime(const sf::Time& currentTime);
     void play();
     void play(const Animation& animation);
     void resetAnim();
@@ -56,17 +61,16 @@ public:
     sf::FloatRect getLocalBounds() const;
     sf::FloatRect getGlobalBounds() const;
     std::size_t getCurrentFrame() const;
-    sf::Time getCurrentTime() const;
     bool isLooped() const;
     bool isPlaying() const;
     sf::Time getFrameTime() const;
-    void setFrame(std::size_t newFrame, bool resetTime = true);
+    void setFrame(std::size_t newFrame);
+    std::size_t getFrameAt(const Animation& animation, sf::Time time) const;
     const sf::IntRect& getAnimFrame() const;
 
 private:
     const Animation* m_animation;
     sf::Time m_frameTime;
-    sf::Time m_currentTime;
     std::size_t m_currentFrame;
     bool m_isPaused;
     bool m_isLooped;
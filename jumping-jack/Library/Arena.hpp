@@ -0,0 +1,76 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <algorithm>
+#include <cstdarg>
+#include <cstddef>
+#include <cstdio>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Monotonic buffer for short lived data, allocating only moves a pointer and reset() frees
+// everything at once. When full it falls back to the heap until the next reset, the high-water
+// mark tells how big it should have been.
+class Arena {
+public:
+    explicit Arena(std::size_t capacity) :
+        m_buffer(new char[capacity]), m_capacity(capacity), m_used(0), m_requested(0), m_high_water(0), m_overflow_count(0) {}
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    void* allocate(std::size_t size, std::size_t alignment = alignof(std::max_align_t)) {
+        m_requested += size;
+        m_high_water = std::max(m_high_water, m_requested);
+
+        const std::uintptr_t base = reinterpret_cast<std::uintptr_t>(m_buffer.get());
+        const std::size_t offset = ((base + m_used + alignment - 1) & ~(alignment - 1)) - base;
+        if(offset + size <= m_capacity) {
+            m_used = offset + size;
+            return m_buffer.get() + offset;
+        }
+
+        // Full
+        ++m_overflow_count;
+        m_overflow.emplace_back(new char[size + alignment]);
+        const std::uintptr_t block = reinterpret_cast<std::uintptr_t>(m_overflow.back().get());
+        return reinterpret_cast<void*>((block + alignment - 1) & ~(alignment - 1));
+    }
+
+    // printf into the arena, the text lives until the next reset
+    const char* format(const char* format, ...) {
+        va_list args, size_args;
+        va_start(args, format);
+        va_copy(size_args, args);
+        const int length = std::vsnprintf(nullptr, 0, format, size_args);
+        va_end(size_args);
+
+        char* text = static_cast<char*>(allocate(std::max(length, 0) + 1, 1));
+        std::vsnprintf(text, std::max(length, 0) + 1, format, args);
+        va_end(args);
+        return text;
+    }
+
+    void reset() {
+        m_used = 0;
+        m_requested = 0;
+        m_overflow.clear();
+    }
+
+    // Getters
+    std::size_t getCapacity() const { return m_capacity; }
+    std::size_t getHighWaterMark() const { return m_high_water; }
+    std::size_t getOverflowCount() const { return m_overflow_count; }
+
+private:
+    std::unique_ptr<char[]> m_buffer;
+    const std::size_t m_capacity;
+    std::size_t m_used;
+    std::size_t m_requested;
+    std::size_t m_high_water;
+    std::size_t m_overflow_count;
+    std::vector<std::unique_ptr<char[]>> m_overflow;
+};
+
+#endif // ARENA_H
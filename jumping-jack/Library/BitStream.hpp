@@ -0,0 +1,108 @@
+#ifndef BITSTREAM_H
+#define BITSTREAM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Bits packed lowest first into bytes. Counts go in as Exp-Golomb codes, small numbers take a
+// few bits and there is no upper limit to plan for; signed ones are zigzagged first.
+class BitWriter {
+public:
+    BitWriter() : m_bit_count(0) {}
+
+    void clear() {
+        m_bytes.clear();
+        m_bit_count = 0;
+    }
+
+    // Up to 64 bits of the value
+    void writeBits(std::uint64_t value, unsigned count) {
+        for(unsigned i = 0; i < count; ++i, ++m_bit_count) {
+            if(m_bit_count % 8 == 0) m_bytes.push_back(0);
+            if((value >> i) & 1) m_bytes.back() |= static_cast<std::uint8_t>(1 << (m_bit_count % 8));
+        }
+    }
+
+    void writeBit(bool bit) { writeBits(bit ? 1 : 0, 1); }
+
+    // As many zeros as the value plus one has bits after the first, then those bits from the top
+    void writeUnsigned(std::uint32_t value) {
+        const std::uint64_t coded = static_cast<std::uint64_t>(value) + 1;
+        unsigned length = 0;
+        while((coded >> (length + 1)) != 0) ++length;
+
+        writeBits(0, length);
+        for(unsigned i = length + 1; i-- > 0;) writeBit((coded >> i) & 1);
+    }
+
+    void writeSigned(std::int32_t value) {
+        writeUnsigned((static_cast<std::uint32_t>(value) << 1) ^ static_cast<std::uint32_t>(value >> 31));
+    }
+
+    void append(const BitWriter& other) {
+        for(std::size_t i = 0; i < other.m_bit_count; ++i) writeBit((other.m_bytes[i / 8] >> (i % 8)) & 1);
+    }
+
+    const std::uint8_t* getData() const { return m_bytes.data(); }
+    std::size_t getSize() const { return m_bytes.size(); }
+    std::size_t getBitCount() const { return m_bit_count; }
+
+private:
+    std::vector<std::uint8_t> m_bytes;
+    std::size_t m_bit_count;
+};
+
+// Reads what a BitWriter wrote. Reading past the end gives zeros and marks the reader failed.
+class BitReader {
+public:
+    BitReader() : m_data(nullptr), m_bit_count(0), m_position(0), m_failed(false) {}
+
+    BitReader(const std::uint8_t* data, std::size_t size, std::size_t bit_offset = 0) :
+        m_data(data), m_bit_count(size * 8), m_position(bit_offset), m_failed(false) {}
+
+    std::uint64_t readBits(unsigned count) {
+        std::uint64_t value = 0;
+        for(unsigned i = 0; i < count; ++i) {
+            if(m_position >= m_bit_count) {
+                m_failed = true;
+                return 0;
+            }
+            if((m_data[m_position / 8] >> (m_position % 8)) & 1) value |= std::uint64_t(1) << i;
+            ++m_position;
+        }
+        return value;
+    }
+
+    bool readBit() { return readBits(1) != 0; }
+
+    std::uint32_t readUnsigned() {
+        unsigned length = 0;
+        while(!readBit()) {
+            if(m_failed || ++length > 32) {
+                m_failed = true;
+                return 0;
+            }
+        }
+
+        std::uint64_t coded = 1;
+        for(unsigned i = 0; i < length; ++i) coded = (coded << 1) | (readBit() ? 1 : 0);
+        return static_cast<std::uint32_t>(coded - 1);
+    }
+
+    std::int32_t readSigned() {
+        const std::uint32_t zigzag = readUnsigned();
+        return static_cast<std::int32_t>(zigzag >> 1) ^ -static_cast<std::int32_t>(zigzag & 1);
+    }
+
+    std::size_t getPosition() const { return m_position; }
+    bool hasFailed() const { return m_failed; }
+
+private:
+    const std::uint8_t* m_data;
+    std::size_t m_bit_count;
+    std::size_t m_position;
+    bool m_failed;
+};
+
+#endif // BITSTREAM_H
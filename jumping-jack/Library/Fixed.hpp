@@ -0,0 +1,72 @@
+#ifndef FIXED_H
+#define FIXED_H
+
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+// Signed 48.16 fixed point number. Only integer math after construction, so the same inputs
+// give the same bits with any compiler flags and on any CPU, and it needs no FPU.
+// Products and dividends have to stay below 2^31 in magnitude, both are shifted up by the 16
+// fraction bits in the 64 bit raw value on the way.
+class Fixed {
+public:
+    static const int FRACTION_BITS = 16;
+    static const std::int64_t ONE = std::int64_t(1) << FRACTION_BITS;
+
+    constexpr Fixed() : m_raw(0) {}
+
+    // Implicit so constants and setup values can be written as usual
+    template<class T, typename std::enable_if<std::is_integral<T>::value, int>::type = 0>
+    constexpr Fixed(T value) : m_raw(static_cast<std::int64_t>(value) * ONE) {}
+
+    // Rounds to the nearest step, scaling by a power of two is exact so this is deterministic too
+    template<class T, typename std::enable_if<std::is_floating_point<T>::value, int>::type = 0>
+    constexpr Fixed(T value) : m_raw(static_cast<std::int64_t>(value * ONE + (value < 0 ? -0.5 : 0.5))) {}
+
+    static constexpr Fixed fromRaw(std::int64_t raw) { Fixed f; f.m_raw = raw; return f; }
+    constexpr std::int64_t getRaw() const { return m_raw; }
+
+    // Conversions out are explicit, they are only for drawing and tools
+    template<class T, typename std::enable_if<std::is_floating_point<T>::value, int>::type = 0>
+    explicit constexpr operator T() const { return static_cast<T>(m_raw) / ONE; }
+
+    // Truncates towards zero like a float cast
+    template<class T, typename std::enable_if<std::is_integral<T>::value, int>::type = 0>
+    explicit constexpr operator T() const { return static_cast<T>(m_raw / ONE); }
+
+    // Arithmetic
+    constexpr Fixed operator-() const { return fromRaw(-m_raw); }
+    Fixed& operator+=(Fixed other) { m_raw += other.m_raw; return *this; }
+    Fixed& operator-=(Fixed other) { m_raw -= other.m_raw; return *this; }
+    Fixed& operator*=(Fixed other) { return *this = *this * other; }
+    Fixed& operator/=(Fixed other) { return *this = *this / other; }
+
+    friend constexpr Fixed operator+(Fixed a, Fixed b) { return fromRaw(a.m_raw + b.m_raw); }
+    friend constexpr Fixed operator-(Fixed a, Fixed b) { return fromRaw(a.m_raw - b.m_raw); }
+    friend constexpr Fixed operator*(Fixed a, Fixed b) { return fromRaw((a.m_raw * b.m_raw) >> FRACTION_BITS); }
+    friend constexpr Fixed operator/(Fixed a, Fixed b) { return fromRaw((a.m_raw * ONE) / b.m_raw); }
+
+    // Comparison
+    friend constexpr bool operator==(Fixed a, Fixed b) { return a.m_raw == b.m_raw; }
+    friend constexpr bool operator!=(Fixed a, Fixed b) { return a.m_raw != b.m_raw; }
+    friend constexpr bool operator<(Fixed a, Fixed b) { return a.m_raw < b.m_raw; }
+    friend constexpr bool operator>(Fixed a, Fixed b) { return a.m_raw > b.m_raw; }
+    friend constexpr bool operator<=(Fixed a, Fixed b) { return a.m_raw <= b.m_raw; }
+    friend constexpr bool operator>=(Fixed a, Fixed b) { return a.m_raw >= b.m_raw; }
+
+private:
+    std::int64_t m_raw;
+};
+
+namespace std {
+    template<> class numeric_limits<Fixed> {
+    public:
+        static const bool is_specialized = true;
+        static constexpr Fixed min() { return Fixed::fromRaw(1); }
+        static constexpr Fixed max() { return Fixed::fromRaw(numeric_limits<std::int64_t>::max()); }
+        static constexpr Fixed lowest() { return Fixed::fromRaw(numeric_limits<std::int64_t>::min()); }
+    };
+}
+
+#endif // FIXED_H
@@ -0,0 +1,150 @@
+#ifndef LOCALSOCKET_H
+#define LOCALSOCKET_H
+
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <string>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Non-blocking Unix domain stream socket, for processes on one machine. A listening one hands
+// out a socket for every connection made to its path.
+class LocalSocket {
+public:
+    LocalSocket() : m_socket(-1) {}
+    ~LocalSocket() { close(); }
+
+    LocalSocket(const LocalSocket&) = delete;
+    LocalSocket& operator=(const LocalSocket&) = delete;
+
+    // A file left at the path by an earlier listener is removed
+    bool listen(const std::string& path) {
+        sockaddr_un address;
+        if(!makeAddress(path, address)) return false;
+
+        close();
+        m_socket = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if(m_socket < 0) return false;
+
+        ::unlink(path.c_str());
+        if(::bind(m_socket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+           ::listen(m_socket, SOMAXCONN) != 0 || !setUp()) {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    // False when nobody is waiting to connect
+    bool accept(LocalSocket& connection) {
+        if(m_socket < 0) return false;
+
+        const int handle = ::accept(m_socket, nullptr, nullptr);
+        if(handle < 0) return false;
+
+        connection.close();
+        connection.m_socket = handle;
+        if(!connection.setUp()) {
+            connection.close();
+            return false;
+        }
+        return true;
+    }
+
+    bool connect(const std::string& path) {
+        sockaddr_un address;
+        if(!makeAddress(path, address)) return false;
+
+        close();
+        m_socket = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if(m_socket < 0) return false;
+
+        if(::connect(m_socket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || !setUp()) {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void close() {
+        if(m_socket >= 0) ::close(m_socket);
+        m_socket = -1;
+    }
+
+    // Bytes written, fewer when the system buffer is full. Closes on errors.
+    std::size_t send(const void* data, std::size_t size) {
+        if(m_socket < 0) return 0;
+
+        const ssize_t sent = ::send(m_socket, data, size, SEND_FLAGS);
+        if(sent >= 0) return static_cast<std::size_t>(sent);
+        if(errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) close();
+        return 0;
+    }
+
+    // Waits up to timeout milliseconds for room while writing, false if it didn't all go
+    bool sendAll(const void* data, std::size_t size, int timeout) {
+        const char* bytes = static_cast<const char*>(data);
+        while(size > 0 && m_socket >= 0) {
+            const std::size_t sent = send(bytes, size);
+            bytes += sent;
+            size -= sent;
+            if(sent == 0 && size > 0 && !wait(POLLOUT, timeout)) return false;
+        }
+        return size == 0;
+    }
+
+    // Bytes read, 0 when nothing is waiting. Closes once the other end did.
+    std::size_t receive(void* data, std::size_t capacity) {
+        if(m_socket < 0) return 0;
+
+        const ssize_t size = ::recv(m_socket, data, capacity, 0);
+        if(size > 0) return static_cast<std::size_t>(size);
+        if(size == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) close();
+        return 0;
+    }
+
+    // False on timeout, events are POLLIN or POLLOUT
+    bool wait(short events, int timeout) const {
+        if(m_socket < 0) return false;
+
+        pollfd entry = { m_socket, events, 0 };
+        return ::poll(&entry, 1, timeout) > 0;
+    }
+
+    bool isOpen() const { return m_socket >= 0; }
+    int getHandle() const { return m_socket; } // For poll()
+
+private:
+#ifdef MSG_NOSIGNAL
+    static const int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+    static const int SEND_FLAGS = 0;
+#endif
+
+    static bool makeAddress(const std::string& path, sockaddr_un& address) {
+        std::memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        if(path.empty() || path.size() >= sizeof(address.sun_path)) return false;
+
+        std::memcpy(address.sun_path, path.c_str(), path.size());
+        return true;
+    }
+
+    // Non-blocking, and writing to a closed connection fails instead of raising SIGPIPE
+    bool setUp() {
+#ifdef SO_NOSIGPIPE
+        const int on = 1;
+        if(::setsockopt(m_socket, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on)) != 0) return false;
+#endif
+        return ::fcntl(m_socket, F_SETFL, ::fcntl(m_socket, F_GETFL, 0) | O_NONBLOCK) == 0;
+    }
+
+    int m_socket;
+};
+
+#endif // LOCALSOCKET_H
@@ -0,0 +1,43 @@
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+#include <atomic>
+#include <cstddef>
+
+// Fixed size single-producer single-consumer queue, never blocks or allocates
+// One slot is kept empty to tell full and empty apart
+template<class T, std::size_t Capacity>
+class SpscQueue {
+public:
+    SpscQueue() : m_head(0), m_tail(0) {}
+    
+    // Producer side, returns false if the queue is full
+    bool push(const T& item) {
+        const std::size_t tail = m_tail.load(std::memory_order_relaxed);
+        const std::size_t next = (tail + 1) % Capacity;
+        if(next == m_head.load(std::memory_order_acquire)) return false;
+        
+        m_items[tail] = item;
+        m_tail.store(next, std::memory_order_release);
+        return true;
+    }
+    
+    // Consumer side, returns false if the queue is empty
+    bool pop(T& item) {
+        const std::size_t head = m_head.load(std::memory_order_relaxed);
+        if(head == m_tail.load(std::memory_order_acquire)) return false;
+        
+        item = m_items[head];
+        m_head.store((head + 1) % Capacity, std::memory_order_release);
+        return true;
+    }
+    
+private:
+    T m_items[Capacity];
+    
+    // Separate cache lines so producer and consumer don't fight over them
+    alignas(64) std::atomic<std::size_t> m_head;
+    alignas(64) std::atomic<std::size_t> m_tail;
+};
+
+#endif // SPSCQUEUE_H
@@ -0,0 +1,96 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fork-join pool, run() splits a batch of tasks over the workers and waits for all of them.
+// The calling thread works too, so a pool of N workers starts N-1 threads.
+class ThreadPool {
+public:
+    typedef std::function<void(std::size_t index, std::size_t worker)> Task;
+    
+    // 0 means one worker per hardware thread
+    explicit ThreadPool(std::size_t worker_count = 0) :
+        m_task(nullptr), m_count(0), m_next(0), m_busy(0), m_generation(0), m_quit(false) {
+        if(worker_count == 0) worker_count = std::max(1u, std::thread::hardware_concurrency());
+        
+        for(std::size_t i = 0; i + 1 < worker_count; ++i)
+            m_threads.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+    
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_quit = true;
+        }
+        m_start.notify_all();
+        for(auto& t : m_threads) t.join();
+    }
+    
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    
+    std::size_t getWorkerCount() const { return m_threads.size() + 1; }
+    
+    // Calls task(i, worker) for every i in [0, count), worker is below getWorkerCount()
+    void run(std::size_t count, const Task& task) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_task = &task;
+            m_count = count;
+            m_next = 0;
+            m_busy = m_threads.size();
+            ++m_generation;
+        }
+        m_start.notify_all();
+        
+        // Caller is the last worker
+        work(m_threads.size());
+        
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_done.wait(lock, [this] { return m_busy == 0; });
+        m_task = nullptr;
+    }
+    
+private:
+    void workerLoop(std::size_t worker) {
+        unsigned long seen = 0;
+        while(true) {
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_start.wait(lock, [&] { return m_quit || m_generation != seen; });
+                if(m_quit) return;
+                seen = m_generation;
+            }
+            
+            work(worker);
+            
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if(--m_busy == 0) m_done.notify_one();
+        }
+    }
+    
+    void work(std::size_t worker) {
+        for(std::size_t i = m_next++; i < m_count; i = m_next++) (*m_task)(i, worker);
+    }
+    
+    std::vector<std::thread> m_threads;
+    std::mutex m_mutex;
+    std::condition_variable m_start;
+    std::condition_variable m_done;
+    
+    const Task* m_task;
+    std::size_t m_count;
+    std::atomic<std::size_t> m_next;
+    std::size_t m_busy;
+    unsigned long m_generation;
+    bool m_quit;
+};
+
+#endif // THREADPOOL_H
@@ -0,0 +1,50 @@
+#ifndef TRIPLEBUFFER_H
+#define TRIPLEBUFFER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Hands the latest value from one producer thread to one consumer thread, neither ever waits.
+// The producer fills the back slot and publishes it, the consumer takes the newest published
+// slot as its front. Values the consumer was too slow to see are skipped.
+template<class T>
+class TripleBuffer {
+public:
+    TripleBuffer() : m_back(0), m_front(2), m_middle(1) {}
+
+    TripleBuffer(const TripleBuffer&) = delete;
+    TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+    // Producer side, fill this then publish it
+    T& getWriteBuffer() { return m_slots[m_back]; }
+
+    void publish() {
+        m_back = m_middle.exchange(m_back | FRESH, std::memory_order_acq_rel) & INDEX;
+    }
+
+    // Consumer side, returns false if nothing was published since the last call
+    bool update() {
+        if(!(m_middle.load(std::memory_order_relaxed) & FRESH)) return false;
+
+        m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) & INDEX;
+        return true;
+    }
+
+    T& getReadBuffer() { return m_slots[m_front]; }
+
+    // Both sides, only before the other thread starts
+    T& getSlot(std::size_t i) { return m_slots[i]; }
+
+private:
+    enum : std::uint8_t { INDEX = 3, FRESH = 4 };
+
+    T m_slots[3];
+
+    // Owned by one side each, the middle one is traded between them
+    std::uint8_t m_back;
+    std::uint8_t m_front;
+    alignas(64) std::atomic<std::uint8_t> m_middle;
+};
+
+#endif // TRIPLEBUFFER_H
@@ -0,0 +1,92 @@
+#ifndef UDPSOCKET_H
+#define UDPSOCKET_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// Non-blocking IPv4 datagram socket talking to one peer. Datagrams from anyone else are dropped
+// by the system once the peer is set.
+class UdpSocket {
+public:
+    UdpSocket() : m_socket(-1) {}
+    ~UdpSocket() { close(); }
+
+    UdpSocket(const UdpSocket&) = delete;
+    UdpSocket& operator=(const UdpSocket&) = delete;
+
+    // Port 0 picks a free one, see getLocalPort()
+    bool bind(std::uint16_t port) {
+        close();
+        m_socket = ::socket(AF_INET, SOCK_DGRAM, 0);
+        if(m_socket < 0) return false;
+
+        sockaddr_in address;
+        std::memset(&address, 0, sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_ANY);
+        address.sin_port = htons(port);
+        if(::bind(m_socket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+           ::fcntl(m_socket, F_SETFL, ::fcntl(m_socket, F_GETFL, 0) | O_NONBLOCK) != 0) {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    bool setPeer(const std::string& host, std::uint16_t port) {
+        addrinfo hints;
+        std::memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_DGRAM;
+
+        addrinfo* found = nullptr;
+        if(m_socket < 0 || ::getaddrinfo(host.c_str(), nullptr, &hints, &found) != 0) return false;
+
+        sockaddr_in address;
+        std::memcpy(&address, found->ai_addr, sizeof(address));
+        address.sin_port = htons(port);
+        ::freeaddrinfo(found);
+        return ::connect(m_socket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0;
+    }
+
+    void close() {
+        if(m_socket >= 0) ::close(m_socket);
+        m_socket = -1;
+    }
+
+    // Datagrams go whole or not at all
+    bool send(const void* data, std::size_t size) {
+        return m_socket >= 0 && ::send(m_socket, data, size, 0) == static_cast<ssize_t>(size);
+    }
+
+    // Size of the next waiting datagram, 0 when there is none. Longer ones are cut to the capacity.
+    std::size_t receive(void* data, std::size_t capacity) {
+        if(m_socket < 0) return 0;
+
+        const ssize_t size = ::recv(m_socket, data, capacity, 0);
+        return size > 0 ? static_cast<std::size_t>(size) : 0;
+    }
+
+    bool isOpen() const { return m_socket >= 0; }
+
+    std::uint16_t getLocalPort() const {
+        sockaddr_in address;
+        socklen_t size = sizeof(address);
+        if(m_socket < 0 || ::getsockname(m_socket, reinterpret_cast<sockaddr*>(&address), &size) != 0) return 0;
+        return ntohs(address.sin_port);
+    }
+
+private:
+    int m_socket;
+};
+
+#endif // UDPSOCKET_H
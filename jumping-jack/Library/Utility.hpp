@@ -3,13 +3,13 @@
 
 #include <random>
 
-static std::mt19937 mt(1337);
-static int random_int(int lower, int higher) {
+// Every world owns its own generator, so worlds can run side by side on different threads
+inline int random_int(std::mt19937& mt, int lower, int higher) {
     std::uniform_int_distribution<int> dist(lower, higher);
     return dist(mt);
 }
 
-static float random_float(float lower, float higher) {
+inline float random_float(std::mt19937& mt, float lower, float higher) {
     std::uniform_real_distribution<float> dist(lower, higher);
     return dist(mt);
 }
@@ -0,0 +1,112 @@
+#include "Manifest.hpp"
+
+#include <fstream>
+#include <cstring>
+
+bool Manifest::loadFromFile(const std::string& file_name) {
+    std::ifstream file(file_name, std::ios::binary | std::ios::ate);
+    if(!file) return false;
+    
+    // Single read, no parsing
+    const std::size_t size = static_cast<std::size_t>(file.tellg());
+    if(size < sizeof(manifest::Header)) return false;
+    
+    m_blob.resize((size + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t));
+    file.seekg(0);
+    if(!file.read(reinterpret_cast<char*>(m_blob.data()), size)) return false;
+    
+    // Reject blobs from another version or cut short
+    const manifest::Header& h = header();
+    if(std::memcmp(h.magic, manifest::MAGIC, sizeof(h.magic)) != 0 ||
+       h.version != manifest::VERSION || h.size != size) {
+        m_blob.clear();
+        return false;
+    }
+    
+    // Every section has to fit in the blob
+    const std::size_t record_sizes[manifest::SECTION_COUNT] = {
+        sizeof(char), sizeof(manifest::Frame), sizeof(manifest::Animation), sizeof(manifest::Hazard),
+        sizeof(manifest::Theme), sizeof(manifest::StoryLine), sizeof(manifest::Stanza), sizeof(manifest::Level)
+    };
+    for(int i = 0; i < manifest::SECTION_COUNT; ++i) {
+        const manifest::Section& section = h.sections[i];
+        if(section.offset % alignof(std::uint32_t) != 0 ||
+           section.offset + std::uint64_t(section.count)*record_sizes[i] > size) {
+            m_blob.clear();
+            return false;
+        }
+    }
+    
+    if(!validate()) {
+        m_blob.clear();
+        return false;
+    }
+    
+    return true;
+}
+
+// Every index and offset in a record has to point inside its section, the getters don't check
+bool Manifest::validate() const {
+    const manifest::Header& h = header();
+    const std::uint32_t string_count = h.sections[manifest::STRINGS].count;
+    if(string_count > 0 && record<char>(manifest::STRINGS, string_count - 1) != '\0') return false;
+    
+    // A world starts on the first level with the first hazard type, and every level shows a stanza
+    if(levelCount() == 0 || hazardCount() == 0 || stanzaCount() < levelCount()) return false;
+    
+    for(std::size_t i = 0; i < animationCount(); ++i) {
+        const manifest::Animation& animation = getAnimation(i);
+        if(!isString(animation.name) ||
+           std::uint64_t(animation.first_frame) + animation.frame_count > h.sections[manifest::FRAMES].count) return false;
+    }
+    for(std::size_t i = 0; i < hazardCount(); ++i) {
+        if(!isString(getHazard(i).name)) return false;
+    }
+    for(std::size_t i = 0; i < themeCount(); ++i) {
+        const manifest::Theme& theme = getTheme(i);
+        if(!isString(theme.name) || !isString(theme.background)) return false;
+    }
+    for(std::size_t i = 0; i < h.sections[manifest::STORY_LINES].count; ++i) {
+        if(!isString(getStoryLine(i).text)) return false;
+    }
+    for(std::size_t i = 0; i < stanzaCount(); ++i) {
+        const manifest::Stanza& stanza = getStanza(i);
+        if(std::uint64_t(stanza.first_line) + stanza.line_count > h.sections[manifest::STORY_LINES].count) return false;
+    }
+    for(std::size_t i = 0; i < levelCount(); ++i) {
+        if(getLevel(i).theme >= themeCount()) return false;
+    }
+    
+    return true;
+}
+
+// The string section ends with a zero, so any offset inside it starts a terminated string
+bool Manifest::isString(std::uint32_t offset) const {
+    return offset < header().sections[manifest::STRINGS].count;
+}
+
+const manifest::Header& Manifest::header() const {
+    return *reinterpret_cast<const manifest::Header*>(m_blob.data());
+}
+
+template<class T>
+const T& Manifest::record(manifest::SECTION section, std::size_t i) const {
+    const char* base = reinterpret_cast<const char*>(m_blob.data());
+    return reinterpret_cast<const T*>(base + header().sections[section].offset)[i];
+}
+
+// Getters
+std::size_t Manifest::animationCount() const { return header().sections[manifest::ANIMATIONS].count; }
+std::size_t Manifest::frameCount() const { return header().sections[manifest::FRAMES].count; }
+std::size_t Manifest::hazardCount() const { return header().sections[manifest::HAZARDS].count; }
+std::size_t Manifest::themeCount() const { return header().sections[manifest::THEMES].count; }
+std::size_t Manifest::stanzaCount() const { return header().sections[manifest::STANZAS].count; }
+std::size_t Manifest::levelCount() const { return header().sections[manifest::LEVELS].count; }
+const manifest::Animation& Manifest::getAnimation(std::size_t i) const { return record<manifest::Animation>(manifest::ANIMATIONS, i); }
+const manifest::Frame& Manifest::getFrame(std::size_t i) const { return record<manifest::Frame>(manifest::FRAMES, i); }
+const manifest::Hazard& Manifest::getHazard(std::size_t i) const { return record<manifest::Hazard>(manifest::HAZARDS, i); }
+const manifest::Theme& Manifest::getTheme(std::size_t i) const { return record<manifest::Theme>(manifest::THEMES, i); }
+const manifest::Stanza& Manifest::getStanza(std::size_t i) const { return record<manifest::Stanza>(manifest::STANZAS, i); }
+const manifest::StoryLine& Manifest::getStoryLine(std::size_t i) const { return record<manifest::StoryLine>(manifest::STORY_LINES, i); }
+const manifest::Level& Manifest::getLevel(std::size_t i) const { return record<manifest::Level>(manifest::LEVELS, i); }
+const char* Manifest::getString(std::uint32_t offset) const { return &record<char>(manifest::STRINGS, offset); }
@@ -0,0 +1,98 @@
+#ifndef Manifest_hpp
+#define Manifest_hpp
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Content that used to be hard-coded in Game: animations, hazard types, themes, story and levels.
+// data/manifest.txt is compiled by tools/manifestc into data/manifest.bin, which is
+// read in one go and used in place. Every record below is plain data. Section offsets are in
+// bytes from the start of the blob, names and texts are offsets into the zero terminated string section.
+namespace manifest {
+    const char MAGIC[4] = { 'J', 'J', 'M', 'F' };
+    const std::uint32_t VERSION = 1;
+    
+    enum SECTION { STRINGS, FRAMES, ANIMATIONS, HAZARDS, THEMES, STORY_LINES, STANZAS, LEVELS, SECTION_COUNT };
+    
+    struct Section {
+        std::uint32_t offset;
+        std::uint32_t count;
+    };
+    
+    struct Header {
+        char magic[4];
+        std::uint32_t version;
+        std::uint32_t size;
+        Section sections[SECTION_COUNT];
+    };
+    
+    // Pixel rectangle on the sprite sheet
+    struct Frame { std::int32_t left, top, width, height; };
+    
+    struct Animation {
+        std::uint32_t name;
+        std::uint32_t first_frame;
+        std::uint32_t frame_count;
+    };
+    
+    struct Hazard { std::uint32_t name; };
+    
+    struct Theme {
+        std::uint32_t name;
+        std::uint32_t background;
+        std::int32_t tile_x, tile_y;
+    };
+    
+    struct StoryLine { std::uint32_t text; };
+    
+    struct Stanza {
+        std::uint32_t first_line;
+        std::uint32_t line_count;
+    };
+    
+    struct Level {
+        std::uint32_t hazard_count;
+        std::uint32_t hole_count;
+        std::uint32_t bonus_health;
+        std::uint32_t theme;
+    };
+}
+
+class Manifest {
+public:
+    bool loadFromFile(const std::string& file_name);
+    
+    // Records
+    std::size_t animationCount() const;
+    const manifest::Animation& getAnimation(std::size_t i) const;
+    std::size_t frameCount() const;
+    const manifest::Frame& getFrame(std::size_t i) const;
+    
+    std::size_t hazardCount() const;
+    const manifest::Hazard& getHazard(std::size_t i) const;
+    
+    std::size_t themeCount() const;
+    const manifest::Theme& getTheme(std::size_t i) const;
+    
+    std::size_t stanzaCount() const;
+    const manifest::Stanza& getStanza(std::size_t i) const;
+    const manifest::StoryLine& getStoryLine(std::size_t i) const;
+    
+    std::size_t levelCount() const;
+    const manifest::Level& getLevel(std::size_t i) const;
+    
+    const char* getString(std::uint32_t offset) const;
+    
+private:
+    template<class T> const T& record(manifest::SECTION section, std::size_t i) const;
+    bool validate() const;
+    bool isString(std::uint32_t offset) const;
+    const manifest::Header& header() const;
+    
+    // Whole blob, 8 byte aligned so records can be used in place
+    std::vector<std::uint64_t> m_blob;
+};
+
+#endif /* Manifest_hpp */
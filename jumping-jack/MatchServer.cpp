@@ -0,0 +1,386 @@
+#include "MatchServer.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+#include <poll.h>
+
+#include "Bot.hpp"
+
+namespace {
+    const std::size_t ROUND_TICK_COUNT = 125;              // Most a session plays in a round
+    const std::size_t MAX_WAITING_INPUTS = 125 * 60;       // Sessions this far behind aren't read from
+    const std::size_t RECEIVE_SIZE = 4096;
+    const std::size_t MAX_ROUND_RECEIVE_SIZE = 16 * RECEIVE_SIZE; // Most read from a session at once
+    const double SESSION_TIMEOUT = 30;                     // Seconds with nothing read or played
+    const int IDLE_TIMEOUT = 10;                           // Milliseconds, when nothing is left to play
+    const int RESULT_TIMEOUT = 1000;
+    const double PROGRESS_INTERVAL = 5;                    // Seconds
+    const std::size_t BENCH_STREAM_COUNT = 16;
+    
+    typedef std::chrono::steady_clock Clock;
+    
+    double secondsSince(Clock::time_point start) { return std::chrono::duration<double>(Clock::now() - start).count(); }
+    
+    // Like a replay sets up a world
+    void setUp(World& world, const Manifest& manifest, const match::Start& start) {
+        world.setManifest(manifest);
+        world.setSize(start.floor_count, start.max_hole_count);
+        world.setEndless(start.endless != 0);
+        world.seed(start.seed);
+        world.changeLevel(0);
+    }
+}
+
+MatchServer::Stats::Stats() :
+    session_count(0),
+    failed_count(0),
+    tick_count(0),
+    tick_time(0),
+    max_tick_cost(0),
+    wall_time(0) {}
+
+MatchServer::Session::Session() :
+    id(0),
+    started(false),
+    finished(false),
+    timed_out(false),
+    last_active(Clock::now()),
+    next_input(0),
+    next_check(0),
+    last_check_tick(0),
+    tick_count(0),
+    check_count(0),
+    mismatch_tick(0),
+    round_tick_count(0),
+    round_time(0),
+    tick_time(0),
+    max_tick_cost(0) {}
+
+MatchServer::MatchServer(const Manifest& manifest, std::size_t thread_count) :
+    m_manifest(manifest),
+    m_dt(static_cast<float>(World().getDt())),
+    m_pool(thread_count),
+    m_quit(false),
+    m_next_id(0) {}
+
+// Serving
+bool MatchServer::listen(const std::string& path) { return m_listener.listen(path); }
+void MatchServer::stop() { m_quit = true; }
+
+void MatchServer::serve(std::size_t session_limit) {
+    std::vector<pollfd> entries;
+    std::vector<Session*> polled;
+    
+    Clock::time_point progress_start = Clock::now();
+    Stats progress_stats = m_stats;
+    
+    while(!m_quit && (session_limit == 0 || m_stats.session_count < session_limit)) {
+        // Sockets are only waited on when there is nothing to play
+        entries.clear();
+        polled.clear();
+        entries.push_back({ m_listener.getHandle(), POLLIN, 0 });
+        
+        bool playable = false;
+        for(auto& session : m_sessions) {
+            const std::size_t waiting = session->inputs.size() - session->next_input;
+            playable = playable || waiting > 0;
+            if(waiting >= MAX_WAITING_INPUTS || !session->socket.isOpen() || session->finished) continue;
+            
+            entries.push_back({ session->socket.getHandle(), POLLIN, 0 });
+            polled.push_back(session.get());
+        }
+        
+        if(::poll(entries.data(), entries.size(), playable ? 0 : IDLE_TIMEOUT) > 0) {
+            for(std::size_t i = 0; i < polled.size(); ++i)
+                if(entries[i + 1].revents != 0) receive(*polled[i]);
+            
+            if(entries[0].revents & POLLIN) {
+                while(true) {
+                    Session& session = addSession();
+                    if(!m_listener.accept(session.socket)) break;
+                    session.id = m_next_id++;
+                }
+                m_sessions.pop_back();
+            }
+        }
+        
+        playRound();
+        
+        // Ended ones are answered, or dropped once their client is gone or stalled. One that never
+        // started or stopped sending before its Finish would keep its socket and world forever.
+        for(std::size_t i = 0; i < m_sessions.size();) {
+            Session& session = *m_sessions[i];
+            const bool played = session.next_input == session.inputs.size();
+            if(played && !session.finished && secondsSince(session.last_active) >= SESSION_TIMEOUT) {
+                session.timed_out = true;
+                session.socket.close();
+            }
+            if((session.finished && played) || !session.socket.isOpen()) {
+                end(session);
+                m_sessions[i] = std::move(m_sessions.back());
+                m_sessions.pop_back();
+            }
+            else ++i;
+        }
+        
+        if(secondsSince(progress_start) >= PROGRESS_INTERVAL) {
+            printProgress(m_sessions.size(), m_stats.tick_count - progress_stats.tick_count,
+                          m_stats.tick_time - progress_stats.tick_time, m_stats.wall_time - progress_stats.wall_time);
+            progress_start = Clock::now();
+            progress_stats = m_stats;
+        }
+    }
+}
+
+MatchServer::Session& MatchServer::addSession() {
+    m_sessions.emplace_back(new Session());
+    return *m_sessions.back();
+}
+
+// Worlds too big to play are refused
+bool MatchServer::start(Session& session, const match::Start& start) {
+    if(start.floor_count < 1 || start.floor_count > match::MAX_FLOOR_COUNT) return false;
+    if(start.max_hole_count > static_cast<std::uint32_t>(match::MAX_FLOOR_COUNT)) return false;
+    
+    setUp(session.world, m_manifest, start);
+    session.started = true;
+    return true;
+}
+
+// Whole messages are handled as they come in, a client breaking the protocol is dropped. A round
+// reads a limited amount, a client sending fast can't hold up the others.
+void MatchServer::receive(Session& session) {
+    std::uint8_t bytes[RECEIVE_SIZE];
+    std::size_t round_size = 0;
+    while(session.inputs.size() - session.next_input < MAX_WAITING_INPUTS && round_size < MAX_ROUND_RECEIVE_SIZE) {
+        const std::size_t size = session.socket.receive(bytes, sizeof(bytes));
+        if(size == 0) return;
+        round_size += size;
+        session.last_active = Clock::now();
+        session.received.insert(session.received.end(), bytes, bytes + size);
+        
+        std::size_t offset = 0;
+        while(session.received.size() - offset >= sizeof(match::Header)) {
+            match::Header header;
+            std::memcpy(&header, &session.received[offset], sizeof(header));
+            if(header.size > match::MAX_INPUTS) {
+                session.socket.close();
+                return;
+            }
+            if(session.received.size() - offset - sizeof(header) < header.size) break;
+            
+            if(!handle(session, header.type, &session.received[offset + sizeof(header)], header.size)) {
+                session.socket.close();
+                return;
+            }
+            offset += sizeof(header) + header.size;
+        }
+        session.received.erase(session.received.begin(), session.received.begin() + offset);
+    }
+}
+
+bool MatchServer::handle(Session& session, std::uint32_t type, const std::uint8_t* data, std::size_t size) {
+    if(session.finished) return false;
+    if(!session.started) {
+        match::Start start;
+        if(type != match::START || size != sizeof(start)) return false;
+        
+        std::memcpy(&start, data, sizeof(start));
+        return this->start(session, start);
+    }
+    
+    switch(type) {
+        case match::INPUTS:
+            session.inputs.insert(session.inputs.end(), data, data + size);
+            return true;
+        
+        // Of as many ticks as there are inputs so far, and of more than the last one. The same
+        // check sent again would only pile up and count twice.
+        case match::CHECK: {
+            match::Check check;
+            if(size != sizeof(check)) return false;
+            
+            std::memcpy(&check, data, sizeof(check));
+            if(check.tick_count <= session.last_check_tick || check.tick_count != session.tick_count + session.inputs.size() - session.next_input) return false;
+            session.last_check_tick = check.tick_count;
+            session.checks.push_back(check);
+            compareChecks(session); // Its ticks may be played already
+            return true;
+        }
+        
+        case match::FINISH:
+            session.finished = true;
+            return size == 0;
+        
+        default:
+            return false;
+    }
+}
+
+// Sessions with inputs waiting play a second of them each, spread over the workers
+bool MatchServer::playRound() {
+    m_playing.clear();
+    for(auto& session : m_sessions)
+        if(session->next_input < session->inputs.size()) m_playing.push_back(session.get());
+    if(m_playing.empty()) return false;
+    
+    const Clock::time_point start = Clock::now();
+    m_pool.run(m_playing.size(), [this](std::size_t index, std::size_t) { play(*m_playing[index]); });
+    m_stats.wall_time += secondsSince(start);
+    
+    for(const Session* session : m_playing) {
+        m_stats.tick_count += session->round_tick_count;
+        m_stats.tick_time += session->round_time;
+        m_stats.max_tick_cost = std::max(m_stats.max_tick_cost, session->round_time / session->round_tick_count);
+    }
+    return true;
+}
+
+// On a worker, sessions are only touched by one at a time
+void MatchServer::play(Session& session) {
+    const Clock::time_point start = Clock::now();
+    const std::size_t first = session.next_input;
+    const std::size_t last = std::min(session.inputs.size(), first + ROUND_TICK_COUNT);
+    
+    for(; session.next_input < last; ++session.next_input) {
+        session.world.update(session.inputs[session.next_input]);
+        ++session.tick_count;
+        compareChecks(session);
+    }
+    
+    // Played inputs and checks aren't kept
+    if(session.next_input == session.inputs.size()) {
+        session.inputs.clear();
+        session.next_input = 0;
+    }
+    if(session.next_check == session.checks.size()) {
+        session.checks.clear();
+        session.next_check = 0;
+    }
+    
+    session.last_active = Clock::now();
+    session.round_tick_count = last - first;
+    session.round_time = static_cast<float>(secondsSince(start));
+    session.tick_time += session.round_time;
+    session.max_tick_cost = std::max(session.max_tick_cost, session.round_time / session.round_tick_count);
+}
+
+// The ones of the ticks played so far
+void MatchServer::compareChecks(Session& session) {
+    for(; session.next_check < session.checks.size() && session.checks[session.next_check].tick_count == session.tick_count; ++session.next_check) {
+        if(session.checks[session.next_check].tick_hash == session.world.getTickHash()) ++session.check_count;
+        else if(session.mismatch_tick == 0) session.mismatch_tick = session.tick_count;
+    }
+}
+
+void MatchServer::end(Session& session) {
+    const bool complete = session.finished && session.next_input == session.inputs.size();
+    const double tick_cost = session.tick_count > 0 ? session.tick_time / session.tick_count : 0;
+    
+    ++m_stats.session_count;
+    if(!complete || session.mismatch_tick != 0) ++m_stats.failed_count;
+    
+    std::cout << "Session " << session.id;
+    if(session.timed_out) std::cout << " timed out";
+    else if(!complete) std::cout << " dropped";
+    else if(session.mismatch_tick != 0) std::cout << " differed after tick " << session.mismatch_tick;
+    else std::cout << " matched " << session.check_count << " checks";
+    std::cout << ", " << session.tick_count << " ticks, level " << session.world.getLevel() << ", score " << session.world.getScore()
+              << ", " << tick_cost * 1e6 << " us a tick, slowest " << session.max_tick_cost * 1e6 << " us" << std::endl;
+    if(!complete) return;
+    
+    match::Result result;
+    result.tick_count = session.tick_count;
+    result.level = session.world.getLevel();
+    result.score = session.world.getScore();
+    result.game_over = session.world.isGameOver();
+    result.check_count = session.check_count;
+    result.mismatch_tick = session.mismatch_tick;
+    result.state_hash = session.world.getStateHash();
+    result.tick_hash = session.world.getTickHash();
+    result.tick_cost = static_cast<std::uint64_t>(tick_cost * 1e9);
+    
+    const match::Header header = { match::RESULT, sizeof(result) };
+    std::uint8_t bytes[sizeof(header) + sizeof(result)];
+    std::memcpy(bytes, &header, sizeof(header));
+    std::memcpy(bytes + sizeof(header), &result, sizeof(result));
+    session.socket.sendAll(bytes, sizeof(bytes), RESULT_TIMEOUT);
+}
+
+void MatchServer::printProgress(std::size_t open_count, std::size_t tick_count, double tick_time, double wall_time) const {
+    if(tick_count == 0) return;
+    
+    std::cout << open_count << " sessions open, " << tick_count << " ticks in the last " << PROGRESS_INTERVAL << " s, "
+              << tick_time / tick_count * 1e6 << " us a tick, " << getSessionsPerCore(tick_time, tick_count) << " sessions per core, "
+              << (wall_time > 0 ? tick_time / wall_time : 0) << " workers busy" << std::endl;
+}
+
+// Sessions a core could play at the speed of the game, going by the average tick cost
+float MatchServer::getSessionsPerCore(double tick_time, std::size_t tick_count) const {
+    return tick_time > 0 ? static_cast<float>(tick_count * m_dt / tick_time) : 0;
+}
+
+// Sessions get the seeds from seed on and share the inputs of a few bot runs, made before
+// the clock starts. A session playing the same inputs as another has to end on the same tick
+// hash, or it counts as failed.
+void MatchServer::bench(std::size_t session_count, std::size_t tick_count, unsigned seed) {
+    const std::size_t stream_count = std::min(session_count, BENCH_STREAM_COUNT);
+    std::vector<std::vector<World::Input>> streams(stream_count);
+    std::vector<std::uint64_t> tick_hashes(stream_count);
+    
+    auto getStart = [seed](std::size_t stream) {
+        const match::Start start = { seed + static_cast<std::uint32_t>(stream), 8, 8, 1 };
+        return start;
+    };
+    
+    m_pool.run(stream_count, [&](std::size_t index, std::size_t) {
+        World world;
+        setUp(world, m_manifest, getStart(index));
+        Bot bot(seed + static_cast<unsigned>(index), 1);
+        
+        streams[index].reserve(tick_count);
+        for(std::size_t tick = 0; tick < tick_count; ++tick) {
+            const World::Input input = world.inInfoScreen() ? static_cast<World::Input>(World::INPUT_CONFIRM) : bot.decide(world);
+            world.update(input);
+            streams[index].push_back(input);
+        }
+        tick_hashes[index] = world.getTickHash();
+    });
+    
+    const std::size_t first = m_sessions.size();
+    for(std::size_t i = 0; i < session_count; ++i) {
+        Session& session = addSession();
+        start(session, getStart(i % stream_count));
+        session.inputs = streams[i % stream_count];
+        session.finished = true;
+    }
+    
+    std::cout << "Playing " << session_count << " sessions of " << tick_count << " ticks on " << getWorkerCount() << " workers" << std::endl;
+    while(playRound()) {}
+    
+    for(std::size_t i = 0; i < session_count; ++i)
+        if(m_sessions[first + i]->world.getTickHash() != tick_hashes[i % stream_count]) ++m_stats.failed_count;
+    m_stats.session_count += session_count;
+    m_sessions.resize(first);
+}
+
+// Getters
+std::size_t MatchServer::getWorkerCount() const { return m_pool.getWorkerCount(); }
+const MatchServer::Stats& MatchServer::getStats() const { return m_stats; }
+
+std::string MatchServer::getReport() const {
+    const std::size_t tick_count = std::max<std::size_t>(m_stats.tick_count, 1);
+    
+    std::ostringstream report;
+    report << "Match server: " << m_stats.session_count << " sessions, " << m_stats.failed_count << " failed, "
+           << m_stats.tick_count << " ticks on " << getWorkerCount() << " workers\n";
+    report << "Tick cost: " << m_stats.tick_time / tick_count * 1e6 << " us on average, slowest round "
+           << m_stats.max_tick_cost * 1e6 << " us a tick\n";
+    report << "Sessions per core: " << getSessionsPerCore(m_stats.tick_time, m_stats.tick_count) << " by tick cost, "
+           << (m_stats.wall_time > 0 ? m_stats.tick_count * m_dt / m_stats.wall_time / getWorkerCount() : 0) << " by wall time\n";
+    return report.str();
+}
@@ -0,0 +1,147 @@
+#ifndef MatchServer_hpp
+#define MatchServer_hpp
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "World.hpp"
+#include "Library/LocalSocket.hpp"
+#include "Library/ThreadPool.hpp"
+
+// Messages between the match server and its clients, each a Header and then size bytes. A client
+// sends Start, then Inputs and Checks while it plays and Finish at the end, the server answers
+// with a Result and closes. A Check is the tick hash the client had after as many ticks as it sent
+// inputs for before it. Native byte order, both ends are on the same machine.
+namespace match {
+    enum TYPE { START, INPUTS, CHECK, FINISH, RESULT };
+    
+    struct Header {
+        std::uint32_t type;
+        std::uint32_t size;
+    };
+    
+    struct Start {
+        std::uint32_t seed;
+        std::int32_t floor_count;
+        std::uint32_t max_hole_count;
+        std::uint32_t endless;
+    };
+    
+    struct Check {
+        std::uint32_t tick_count;
+        std::uint32_t padding;
+        std::uint64_t tick_hash;
+    };
+    
+    struct Result {
+        std::uint32_t tick_count;
+        std::int32_t level;
+        std::uint32_t score;
+        std::uint32_t game_over;
+        std::uint32_t check_count;   // Matched
+        std::uint32_t mismatch_tick; // Of the first check that didn't match, 0 if none
+        std::uint64_t state_hash;
+        std::uint64_t tick_hash;
+        std::uint64_t tick_cost;     // Nanoseconds, on average
+    };
+    
+    const std::uint32_t MAX_INPUTS = 1 << 16; // In one message
+    const std::int32_t MAX_FLOOR_COUNT = World::MAX_FLOOR_COUNT;
+}
+
+// Plays many sessions at once in one process, each a world fed the inputs its client streams in.
+// The server's world is the one that counts, clients only send inputs. Sessions are stepped in
+// rounds on a thread pool, a round plays at most a second of each so a long upload doesn't hold
+// up the rest. Every session is timed, a core keeps up with as many sessions as ticks of the
+// average cost fit in its second at 125 ticks a second.
+class MatchServer {
+public:
+    struct Stats {
+        Stats();
+        
+        std::size_t session_count; // Finished
+        std::size_t failed_count;  // Dropped or with a check that didn't match
+        std::size_t tick_count;
+        double tick_time;          // Seconds, of all sessions together
+        float max_tick_cost;       // Seconds a tick, of the slowest round of a session
+        double wall_time;          // Seconds spent playing rounds
+    };
+    
+    // 0 threads means one per hardware thread
+    MatchServer(const Manifest& manifest, std::size_t thread_count = 0);
+    
+    // Serving, until stopped or until the given number of sessions ended when not 0.
+    // stop() can be called from a signal handler.
+    bool listen(const std::string& path);
+    void serve(std::size_t session_limit = 0);
+    void stop();
+    
+    // Sessions of the given seeds on, each plays the same number of ticks of bot input
+    void bench(std::size_t session_count, std::size_t tick_count, unsigned seed);
+    
+    // Getters
+    std::size_t getWorkerCount() const;
+    const Stats& getStats() const;
+    std::string getReport() const;
+    
+private:
+// Types
+    struct Session {
+        Session();
+        
+        std::size_t id;
+        LocalSocket socket;
+        std::vector<std::uint8_t> received; // Start of a message not all here yet
+        World world;
+        bool started;
+        bool finished; // Sent Finish, ends once the inputs before it are played
+        bool timed_out;
+        std::chrono::steady_clock::time_point last_active; // Last read from or played
+        
+        // Waiting to be played, the ones before next were
+        std::vector<World::Input> inputs;
+        std::size_t next_input;
+        std::vector<match::Check> checks;
+        std::size_t next_check;
+        std::uint32_t last_check_tick; // Each check has to be of more ticks than the one before
+        std::uint32_t tick_count;
+        std::uint32_t check_count;
+        std::uint32_t mismatch_tick;
+        
+        // Cost
+        std::size_t round_tick_count;
+        float round_time;
+        double tick_time;
+        float max_tick_cost;
+    };
+    
+// Functions
+    Session& addSession();
+    bool start(Session& session, const match::Start& start);
+    void receive(Session& session);
+    bool handle(Session& session, std::uint32_t type, const std::uint8_t* data, std::size_t size);
+    bool playRound();
+    void play(Session& session);
+    void compareChecks(Session& session);
+    void end(Session& session);
+    void printProgress(std::size_t open_count, std::size_t tick_count, double tick_time, double wall_time) const;
+    float getSessionsPerCore(double tick_time, std::size_t tick_count) const;
+    
+// Variables
+    const Manifest& m_manifest;
+    const float m_dt;
+    ThreadPool m_pool;
+    LocalSocket m_listener;
+    std::atomic<bool> m_quit;
+    
+    std::vector<std::unique_ptr<Session>> m_sessions;
+    std::vector<Session*> m_playing; // This round
+    std::size_t m_next_id;
+    Stats m_stats;
+};
+
+#endif /* MatchServer_hpp */
@@ -0,0 +1,93 @@
+#include "ObservationEncoder.hpp"
+
+#include <algorithm>
+
+namespace {
+    // Features after the one-hot player state
+    enum FEATURE {
+        PLAYER_FLOOR, PLAYER_X, PLAYER_TIMER, PLAYER_STUN_TIMER,
+        TIMESCALE, HEALTH, LEVEL, HOLE_ABOVE_WAIT, HOLE_BELOW_WAIT,
+        FEATURE_COUNT
+    };
+    
+    // Health and hole waits above these look the same
+    const float MAX_OBSERVED_HEALTH = 10;
+    const float MAX_OBSERVED_WAIT = 4;
+    
+    float observedWait(const World& world, int floor, Real x) {
+        const float wait = static_cast<float>(world.getHoleArrivalTime(floor, x) - world.getEntityTime());
+        return std::min(wait, MAX_OBSERVED_WAIT) / MAX_OBSERVED_WAIT;
+    }
+}
+
+ObservationEncoder::ObservationEncoder(int floor_count, int column_count, std::size_t hazard_type_count) :
+    m_floor_count(std::max(floor_count, 1)),
+    m_column_count(std::max(column_count, 1)),
+    m_channel_count(HAZARDS + hazard_type_count),
+    m_plane_size(static_cast<std::size_t>(m_floor_count) * m_column_count) {}
+
+void ObservationEncoder::encode(const World& world, float* observation) const {
+    encodeGrid(world, observation);
+    encodeFeatures(world, observation + getGridSize());
+}
+
+// Cleared in one go, then only the covered cells are written
+void ObservationEncoder::encodeGrid(const World& world, float* grid) const {
+    std::fill(grid, grid + getGridSize(), 0.0f);
+    
+    const float column_scale = m_column_count / world.getViewSize().x;
+    auto row = [&](std::size_t channel, int floor) { return grid + channel*m_plane_size + floor*m_column_count; };
+    auto inGrid = [&](int floor) { return floor >= 0 && floor < m_floor_count; };
+    
+    for(auto& hole : world.getHoles()) {
+        if(inGrid(hole->getFloor())) fillSpan(row(HOLES, hole->getFloor()), hole->getX(), hole->getCollisionSizeX(), column_scale);
+    }
+    for(auto& hazard : world.getHazards()) {
+        const std::size_t channel = HAZARDS + hazard->getType();
+        if(inGrid(hazard->getFloor()) && channel < m_channel_count)
+            fillSpan(row(channel, hazard->getFloor()), hazard->getX(), hazard->getCollisionSizeX(), column_scale);
+    }
+    
+    const Player& player = world.getPlayer();
+    if(inGrid(player.getFloor())) fillSpan(row(PLAYER, player.getFloor()), player.getX(), 0, column_scale);
+}
+
+// Player state one-hot, then the FEATURE values, all about 0 to 1 except the state timer in seconds
+void ObservationEncoder::encodeFeatures(const World& world, float* features) const {
+    const Player& player = world.getPlayer();
+    
+    std::fill(features, features + Player::STATE_COUNT, 0.0f);
+    features[player.getState()] = 1;
+    features += Player::STATE_COUNT;
+    
+    // Stacked stuns longer than the longest single one look the same
+    static const float max_stun = static_cast<float>(Player::getMaxStunTime());
+    features[PLAYER_FLOOR] = static_cast<float>(player.getFloor()) / std::max(1, world.getBottomFloor());
+    features[PLAYER_X] = static_cast<float>(player.getX()) / world.getViewSize().x;
+    features[PLAYER_TIMER] = static_cast<float>(player.getTimer());
+    features[PLAYER_STUN_TIMER] = std::min(static_cast<float>(player.getStunTimer()), max_stun) / max_stun;
+    features[TIMESCALE] = static_cast<float>(world.getTimescale());
+    features[HEALTH] = std::min(static_cast<float>(world.getHealth()), MAX_OBSERVED_HEALTH) / MAX_OBSERVED_HEALTH;
+    features[LEVEL] = static_cast<float>(world.getLevel()) / std::max(1, world.getLastLevel());
+    features[HOLE_ABOVE_WAIT] = observedWait(world, player.getFloor(), player.getX());
+    features[HOLE_BELOW_WAIT] = observedWait(world, player.getFloor() + 1, player.getX());
+}
+
+// Marks the columns from x - size_x/2 to x + size_x/2, wrapping around the edges like the
+// entities do. Shifted by a lap so truncating rounds down.
+void ObservationEncoder::fillSpan(float* row, Real x, Real size_x, float column_scale) const {
+    const float center = static_cast<float>(x) * column_scale + m_column_count;
+    const float half = 0.5f * static_cast<float>(size_x) * column_scale;
+    
+    const int first = static_cast<int>(center - half);
+    const int last = static_cast<int>(center + half);
+    for(int column = first; column <= last; ++column) row[column % m_column_count] = 1;
+}
+
+// Getters
+int ObservationEncoder::getFloorCount() const { return m_floor_count; }
+int ObservationEncoder::getColumnCount() const { return m_column_count; }
+std::size_t ObservationEncoder::getChannelCount() const { return m_channel_count; }
+std::size_t ObservationEncoder::getGridSize() const { return m_channel_count * m_plane_size; }
+std::size_t ObservationEncoder::getFeatureCount() const { return Player::STATE_COUNT + FEATURE_COUNT; }
+std::size_t ObservationEncoder::getSize() const { return getGridSize() + getFeatureCount(); }
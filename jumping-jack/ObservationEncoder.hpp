@@ -0,0 +1,42 @@
+#ifndef ObservationEncoder_hpp
+#define ObservationEncoder_hpp
+
+#include <cstddef>
+
+#include "World.hpp"
+
+// What a world looks like to a bot, as numbers made straight from the entities without drawing.
+// First a grid per channel, floors by columns, row by row. A cell is 1 where something covers
+// part of it and 0 elsewhere, a hole is in the row of the floor whose ceiling it is.
+// Then the features, see encodeFeatures(). All of it goes to a buffer of getSize() floats.
+class ObservationEncoder {
+public:
+    // Grid channels, hazards have one each from HAZARDS on
+    enum CHANNEL { HOLES, PLAYER, HAZARDS };
+    
+    ObservationEncoder(int floor_count, int column_count, std::size_t hazard_type_count);
+    
+    void encode(const World& world, float* observation) const;
+    
+    // Getters
+    int getFloorCount() const;
+    int getColumnCount() const;
+    std::size_t getChannelCount() const;
+    std::size_t getGridSize() const;
+    std::size_t getFeatureCount() const;
+    std::size_t getSize() const;
+    
+private:
+// Functions
+    void encodeGrid(const World& world, float* grid) const;
+    void encodeFeatures(const World& world, float* features) const;
+    void fillSpan(float* row, Real x, Real size_x, float column_scale) const;
+    
+// Variables
+    const int m_floor_count;
+    const int m_column_count;
+    const std::size_t m_channel_count;
+    const std::size_t m_plane_size;
+};
+
+#endif /* ObservationEncoder_hpp */
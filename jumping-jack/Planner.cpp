@@ -0,0 +1,212 @@
+#include "Planner.hpp"
+#include "Library/Utility.hpp"
+
+#include <sstream>
+#include <cmath>
+
+Planner::Planner(unsigned seed) :
+    m_random(seed),
+    m_ticks_since_plan(0),
+    m_rollout_count(0),
+    m_horizon(300),
+    m_replan_interval(10),
+    m_candidate_count(24),
+    m_min_segment_ticks(15),
+    m_max_segment_ticks(60),
+    m_max_wait(4),
+    m_max_failure_count(1000) {}
+
+World::Input Planner::decide(const World& world) {
+    // Keep pressing enter on the info screens
+    if(world.inInfoScreen()) {
+        m_plan.clear();
+        return World::INPUT_CONFIRM;
+    }
+    
+    if(m_plan.empty() || m_ticks_since_plan >= m_replan_interval) replan(world);
+    
+    ++m_ticks_since_plan;
+    World::Input input = policy(world, m_plan.front());
+    advance(m_plan, 1);
+    
+    return input;
+}
+
+void Planner::replan(const World& world) {
+    // Previous best is a candidate too, so the plan only changes for a better one
+    float best_score = -INFINITY;
+    if(!m_plan.empty()) {
+        randomPlan(m_plan);
+        best_score = rollout(world, m_plan);
+    }
+    
+    for(std::size_t i = 0; i < m_candidate_count; ++i) {
+        // Half are small changes on the best, half are new
+        if(!m_plan.empty() && i % 2 == 0) {
+            m_candidate = m_plan;
+            mutatePlan(m_candidate);
+        }
+        else {
+            m_candidate.clear();
+            randomPlan(m_candidate);
+        }
+        
+        float score = rollout(world, m_candidate);
+        if(score > best_score) {
+            best_score = score;
+            std::swap(m_plan, m_candidate);
+        }
+    }
+    
+    m_ticks_since_plan = 0;
+}
+
+// Fills the plan with random segments up to the horizon
+void Planner::randomPlan(Plan& plan) {
+    int ticks = 0;
+    for(auto& segment : plan) ticks += segment.ticks;
+    
+    static const World::Input moves[] = { 0, World::INPUT_LEFT, World::INPUT_RIGHT };
+    while(ticks < m_horizon) {
+        Segment segment;
+        segment.move = moves[random_int(m_random, 0, 2)];
+        segment.jump = random_int(m_random, 0, 3) != 0;
+        segment.ticks = random_int(m_random, m_min_segment_ticks, m_max_segment_ticks);
+        
+        plan.push_back(segment);
+        ticks += segment.ticks;
+    }
+}
+
+void Planner::mutatePlan(Plan& plan) {
+    Segment& segment = plan[random_int(m_random, 0, static_cast<int>(plan.size()) - 1)];
+    
+    switch(random_int(m_random, 0, 2)) {
+        case 0: segment.move = segment.move == World::INPUT_LEFT ? World::INPUT_RIGHT : World::INPUT_LEFT; break;
+        case 1: segment.jump = !segment.jump; break;
+        case 2: segment.ticks = random_int(m_random, 1, m_max_segment_ticks); break;
+    }
+}
+
+// Drops the given number of ticks from the front of the plan
+void Planner::advance(Plan& plan, int ticks) {
+    while(ticks > 0 && !plan.empty()) {
+        int taken = std::min(ticks, plan.front().ticks);
+        plan.front().ticks -= taken;
+        ticks -= taken;
+        
+        if(plan.front().ticks <= 0) plan.erase(plan.begin());
+    }
+}
+
+// Plays the plan on a copy of the world and scores where it ends up
+float Planner::rollout(const World& world, const Plan& plan) {
+    ++m_rollout_count;
+    m_scratch.copyState(world);
+    
+    int tick = 0;
+    int segment_tick = 0;
+    std::size_t segment = 0;
+    while(tick < m_horizon && segment < plan.size()) {
+        // Input doesn't matter while the player is out of control
+        int ticks = m_scratch.fastForward(m_horizon - tick);
+        if(ticks == 0) {
+            m_scratch.update(policy(m_scratch, plan[segment]));
+            ticks = 1;
+        }
+        if(m_scratch.inInfoScreen()) break;
+        
+        tick += ticks;
+        segment_tick += ticks;
+        while(segment < plan.size() && segment_tick >= plan[segment].ticks) segment_tick -= plan[segment++].ticks;
+    }
+    
+    return evaluate(m_scratch, tick);
+}
+
+float Planner::evaluate(const World& world, int ticks) {
+    // Finishing sooner is better, losing is the worst
+    if(world.isChangingLevel()) return 1e6f - ticks;
+    if(world.isGameOver()) return -1e6f;
+    
+    const Player& player = world.getPlayer();
+    
+    // Every floor climbed and every health kept counts more than anything else
+    float score = (world.getBottomFloor() - player.getFloor()) * 1000.0f + world.getHealth() * 5000.0f;
+    
+    // Less waiting for the next hole above
+    const float wait = static_cast<float>(world.getHoleArrivalTime(player.getFloor(), player.getX()) - world.getEntityTime());
+    score -= 150 * std::min(wait, m_max_wait);
+    
+    // Time lost on the ground
+    if(player.getState() != Player::PLAYER_STATE::FREE &&
+       player.getState() != Player::PLAYER_STATE::JUMPING) score -= 200;
+    
+    return score;
+}
+
+World::Input Planner::policy(const World& world, const Segment& segment) {
+    World::Input input = segment.move;
+    if(!segment.jump) return input;
+    
+    // Only jump into a hole, never into the ceiling
+    const Player& player = world.getPlayer();
+    if(player.getState() != Player::PLAYER_STATE::FREE) return input;
+    
+    for(auto& hole : world.getHoles()) {
+        if(hole->collides(player.getFloor(), player.getX())) return input | World::INPUT_JUMP;
+    }
+    
+    return input;
+}
+
+void Planner::observe(const World& world) {
+    for(World::GAME_EVENT event : world.getTickEvents()) {
+        switch(event) {
+            case World::GAME_EVENT::HIT_BY_HAZARD:
+            case World::GAME_EVENT::HIT_HEAD:
+            case World::GAME_EVENT::STARTED_FALLING:
+            case World::GAME_EVENT::DROPPED_TO_BOTTOM:
+            case World::GAME_EVENT::GAME_OVER: {
+                const Player& player = world.getPlayer();
+                ++m_failure_counts[world.getLevel()][event];
+                m_failures.push_back({ world.getLevel(), static_cast<float>(world.getGlobalTimer()), player.getFloor(), static_cast<float>(player.getX()), event });
+                if(m_failures.size() > m_max_failure_count) m_failures.pop_front();
+                break;
+            }
+                
+            default:
+                break;
+        }
+    }
+}
+
+// Failure counts per level, and where the game was lost in the last failures
+std::string Planner::getReport() const {
+    static const std::map<World::GAME_EVENT, std::string> names = {
+        { World::GAME_EVENT::HIT_BY_HAZARD, "hazard" },
+        { World::GAME_EVENT::HIT_HEAD, "ceiling" },
+        { World::GAME_EVENT::STARTED_FALLING, "fell" },
+        { World::GAME_EVENT::DROPPED_TO_BOTTOM, "bottom" },
+        { World::GAME_EVENT::GAME_OVER, "game over" }
+    };
+    
+    std::ostringstream report;
+    report << "Rollouts: " << m_rollout_count << "\n";
+    for(auto& level : m_failure_counts) {
+        report << "Level " << level.first << ":";
+        for(auto& count : level.second) report << " " << names.at(count.first) << " " << count.second;
+        report << "\n";
+    }
+    
+    for(auto& failure : m_failures) {
+        if(failure.event != World::GAME_EVENT::GAME_OVER) continue;
+        report << "Game over on level " << failure.level << ", floor " << failure.floor << ", x " << failure.x << "\n";
+    }
+    
+    return report.str();
+}
+
+// Getters
+const std::deque<Planner::Failure>& Planner::getFailures() const { return m_failures; }
+std::size_t Planner::getRolloutCount() const { return m_rollout_count; }
@@ -0,0 +1,78 @@
+#ifndef Planner_hpp
+#define Planner_hpp
+
+#include <deque>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "World.hpp"
+
+// Plays by searching ahead: copies the world into a scratch one, tries random move plans
+// on it for a few seconds of game time and follows the best. Used for soak tests and tuning,
+// and keeps track of where it got hurt.
+class Planner {
+public:
+    Planner(unsigned seed);
+    
+    World::Input decide(const World& world);
+    
+    // Call after each update of the played world
+    void observe(const World& world);
+    
+    // Failures, only the last ones are kept but all of them are counted
+    struct Failure {
+        int level;
+        float time;
+        int floor;
+        float x;
+        World::GAME_EVENT event;
+    };
+    const std::deque<Failure>& getFailures() const;
+    std::string getReport() const;
+    std::size_t getRolloutCount() const;
+    
+private:
+    // Holds a move for some ticks, jumps whenever there is a hole above if allowed
+    struct Segment {
+        World::Input move;
+        bool jump;
+        int ticks;
+    };
+    typedef std::vector<Segment> Plan;
+    
+// Functions
+    void replan(const World& world);
+    void randomPlan(Plan& plan);
+    void mutatePlan(Plan& plan);
+    void advance(Plan& plan, int ticks);
+    float rollout(const World& world, const Plan& plan);
+    float evaluate(const World& world, int ticks);
+    
+    static World::Input policy(const World& world, const Segment& segment);
+    
+// Variables
+    std::mt19937 m_random;
+    World m_scratch;
+    
+    // Search
+    Plan m_plan;
+    Plan m_candidate;
+    int m_ticks_since_plan;
+    std::size_t m_rollout_count;
+    
+    const int m_horizon;
+    const int m_replan_interval;
+    const std::size_t m_candidate_count;
+    const int m_min_segment_ticks;
+    const int m_max_segment_ticks;
+    const float m_max_wait;
+    
+    // Report
+    std::deque<Failure> m_failures;
+    std::map<int, std::map<World::GAME_EVENT, unsigned>> m_failure_counts; // Per level
+    const std::size_t m_max_failure_count;
+};
+
+#endif /* Planner_hpp */
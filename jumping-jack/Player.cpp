@@ -1,25 +1,105 @@
 #include "Player.hpp"
 
 #include <SFML/Graphics.hpp>
+#include <algorithm>
 
-#include "Game.hpp"
+#include "World.hpp"
+#include "FlightRecorder.hpp"
 
-Player::Player() :
-    Entity(false),
+// State machine
+// Each state has what happens on entering it, each transition what happens on the way. A new
+// state is a row in STATES and its ways in and out are rows in TRANSITION_ROWS.
+namespace {
+    const World::GAME_EVENT NO_EVENT = World::GAME_EVENT_COUNT;
+    
+    // Seconds
+    constexpr Real MOVE_TIME = 1;
+    constexpr Real HIT_HEAD_TIME = 1;
+    constexpr Real HIT_BY_HAZARD_TIME = 0.5f;
+    constexpr Real STUN_TIME = 0.7f;
+    constexpr Real HAZARD_HIT_STUN_TIME = STUN_TIME * 2;
+    constexpr Real LONG_STUN_TIME = STUN_TIME * 3;
+    
+    struct State {
+        World::GAME_EVENT enter_event;
+        World::GAME_EVENT bottom_event; // Also when entered on the bottom floor
+        Real duration;                  // Sets the timer, 0 leaves it as is
+        float offset;                   // Draw offset in floors at the start, goes to 0 with the timer
+        std::uint32_t color;
+    };
+    
+    constexpr State STATES[Player::STATE_COUNT] = {
+        /* FREE          */ { NO_EVENT,                      NO_EVENT,                     0,                  0,     0xFFFFFFFF },
+        /* JUMPING       */ { World::STARTED_JUMPING,        NO_EVENT,                     MOVE_TIME,          1,     0xFFFFFFFF },
+        /* FALLING       */ { World::STARTED_FALLING,        NO_EVENT,                     MOVE_TIME,          -1,    0xFFFFFFFF },
+        /* HIT_BY_HAZARD */ { World::HIT_BY_HAZARD,          NO_EVENT,                     HIT_BY_HAZARD_TIME, 0,     0xFF0000FF },
+        /* HIT_HEAD      */ { World::HIT_HEAD,               NO_EVENT,                     HIT_HEAD_TIME,      -0.25f, 0xFF00FFFF },
+        /* STUNNED       */ { NO_EVENT,                      World::DROPPED_TO_BOTTOM,     0,                  0,     0xFFFF00FF }
+    };
+    
+    enum MOVE { STAY, CLIMB, DROP };
+    
+    struct Transition {
+        bool valid;
+        Player::PLAYER_STATE from;
+        Player::TRIGGER trigger;
+        Player::PLAYER_STATE to;
+        MOVE move;                      // Before the change
+        World::GAME_EVENT exit_event;
+        World::GAME_EVENT top_event;    // Also when it climbed over the top floor
+        Real stun;                      // Stun time added up, 0 if not stunned
+        Real bottom_stun;               // Instead, on the bottom floor
+    };
+    
+    constexpr Transition TRANSITION_ROWS[] = {
+        { true, Player::FREE,          Player::JUMP_INTO_HOLE,    Player::JUMPING,       CLIMB, NO_EVENT,                  NO_EVENT,              0,                    0                    },
+        { true, Player::FREE,          Player::HOLE_BELOW,        Player::FALLING,       DROP,  NO_EVENT,                  NO_EVENT,              0,                    0                    },
+        { true, Player::FREE,          Player::JUMP_INTO_CEILING, Player::HIT_HEAD,      STAY,  NO_EVENT,                  NO_EVENT,              0,                    0                    },
+        { true, Player::FREE,          Player::HAZARD_HIT,        Player::HIT_BY_HAZARD, STAY,  NO_EVENT,                  NO_EVENT,              0,                    0                    },
+        { true, Player::JUMPING,       Player::TIME_UP,           Player::FREE,          STAY,  World::STOPPED_JUMPING,    World::REACHED_TO_TOP, 0,                    0                    },
+        { true, Player::FALLING,       Player::TIME_UP,           Player::STUNNED,       STAY,  World::STOPPED_FALLING,    NO_EVENT,              STUN_TIME,            LONG_STUN_TIME       },
+        { true, Player::HIT_BY_HAZARD, Player::TIME_UP,           Player::STUNNED,       STAY,  World::STOPPED_HAZARD_HIT, NO_EVENT,              HAZARD_HIT_STUN_TIME, HAZARD_HIT_STUN_TIME },
+        { true, Player::HIT_HEAD,      Player::TIME_UP,           Player::STUNNED,       STAY,  World::STOPPED_HIT_HEAD,   NO_EVENT,              LONG_STUN_TIME,       LONG_STUN_TIME       },
+        { true, Player::STUNNED,       Player::STUN_UP,           Player::FREE,          STAY,  World::STOPPED_STUN,       NO_EVENT,              0,                    0                    },
+        { true, Player::STUNNED,       Player::HOLE_BELOW,        Player::FALLING,       DROP,  NO_EVENT,                  NO_EVENT,              0,                    0                    }
+    };
+    
+    // Rows spread to state x trigger at compile time, a lookup is one index
+    struct TransitionTable {
+        Transition at[Player::STATE_COUNT][Player::TRIGGER_COUNT];
+    };
+    
+    constexpr TransitionTable makeTransitionTable() {
+        TransitionTable table {};
+        for(const Transition& row : TRANSITION_ROWS) table.at[row.from][row.trigger] = row;
+        return table;
+    }
+    
+    constexpr TransitionTable TRANSITIONS = makeTransitionTable();
+    
+    // Every state has a way out, so the player can't get stuck
+    constexpr bool canLeaveEveryState() {
+        for(int state = 0; state < Player::STATE_COUNT; ++state) {
+            bool can_leave = false;
+            for(int trigger = 0; trigger < Player::TRIGGER_COUNT; ++trigger) can_leave |= TRANSITIONS.at[state][trigger].valid;
+            if(!can_leave) return false;
+        }
+        return true;
+    }
+    static_assert(canLeaveEveryState(), "A player state has no transition out of it");
+}
+
+Player::Player(World& world) :
+    Entity(world, false),
     m_state(PLAYER_STATE::FREE),
+    m_transition_counts(),
     m_timer(0),
     m_stun_timer(0),
-    m_move_time(1),
-    m_hit_head_time(1),
-    m_hit_by_hazard_time(0.5f),
-    m_stun_time(0.7f),
-    m_hazard_hit_stun_time(m_stun_time * 2),
-    m_long_stun_time(m_stun_time * 3),
     m_last_facing(m_facing),
     m_facing_timer(0),
     m_facing_interval(0.7f) {}
 
-void Player::updateFacing(float dt) {
+void Player::updateFacing(Real dt) {
     // If controllable
     if(m_state == PLAYER_STATE::FREE) {
         // If standing still
@@ -32,8 +112,9 @@ void Player::updateFacing(float dt) {
                 
                 // Change direction of look
                 m_facing = m_facing == 0 ? -m_last_facing : 0;
+                restartAnimation();
                 
-                Game::i().trigger(Game::GAME_EVENT::PLAYER_TURNED);
+                m_world->trigger(World::GAME_EVENT::PLAYER_TURNED);
             }
         }
         // If moving
@@ -48,121 +129,152 @@ void Player::updateFacing(float dt) {
     if(m_facing != 0) m_last_facing = m_facing;
 }
 
-void Player::update(float dt) {
+void Player::update(Real dt) {
     updateDirection();
     Entity::update(dt);
     checkInteractions();
     updateState(dt);
 }
 
-void Player::changeState(PLAYER_STATE new_state) {
-    switch(new_state) {
-        case PLAYER_STATE::FREE:
-            if(m_state == PLAYER_STATE::JUMPING) {
-                Game::i().trigger(Game::GAME_EVENT::STOPPED_JUMPING);
-                
-                // Finished the level
-                if(m_floor == -1) Game::i().trigger(Game::GAME_EVENT::REACHED_TO_TOP);
-            }
-            else if(m_state == PLAYER_STATE::STUNNED)
-                Game::i().trigger(Game::GAME_EVENT::STOPPED_STUN);
-            
-            m_sprite_color = sf::Color::White;
-            break;
-            
-        case PLAYER_STATE::JUMPING:
-            Game::i().trigger(Game::GAME_EVENT::STARTED_JUMPING);
-            m_sprite_color = sf::Color::White;
-            m_timer = m_move_time;
-            break;
-
-        case PLAYER_STATE::FALLING:
-            Game::i().trigger(Game::GAME_EVENT::STARTED_FALLING);
-            m_sprite_color = sf::Color::White;
-            m_timer = m_move_time;
-            break;
-            
-        case PLAYER_STATE::HIT_HEAD:
-            Game::i().trigger(Game::GAME_EVENT::HIT_HEAD);
-            m_timer = m_hit_head_time;
-            m_sprite_color = sf::Color::Magenta;
-            break;
-            
-        case PLAYER_STATE::HIT_BY_HAZARD:
-            Game::i().trigger(Game::GAME_EVENT::HIT_BY_HAZARD);
-            m_sprite_color = sf::Color::Red;
-            m_timer = m_hit_by_hazard_time;
-            break;
-            
-        case PLAYER_STATE::STUNNED:
-            // Alert about the end of previous state
-            if(m_state == PLAYER_STATE::FALLING)
-                Game::i().trigger(Game::GAME_EVENT::STOPPED_FALLING);
-            else if(m_state == PLAYER_STATE::HIT_BY_HAZARD)
-                Game::i().trigger(Game::GAME_EVENT::STOPPED_HAZARD_HIT);
-            else if(m_state == PLAYER_STATE::HIT_HEAD)
-                Game::i().trigger(Game::GAME_EVENT::STOPPED_HIT_HEAD);
-            
-            // Dropped to the bottom floor
-            if(m_floor == Game::i().getBottomFloor())
-                Game::i().trigger(Game::GAME_EVENT::DROPPED_TO_BOTTOM);
-            
-            // Stack up the stun time
-            if(m_stun_timer < 0) m_stun_timer = 0;
-            
-            if(m_state == PLAYER_STATE::HIT_BY_HAZARD)
-                m_stun_timer += m_hazard_hit_stun_time;
-            else if(m_state == PLAYER_STATE::HIT_HEAD)
-                m_stun_timer += m_long_stun_time;
-            else if(m_floor == Game::i().getBottomFloor()) // Dropped to the bottom floor
-                m_stun_timer += m_long_stun_time;
-            else
-                m_stun_timer += m_stun_time;
-            
-            m_sprite_color = sf::Color::Yellow;
-            break;
-    }
+void Player::resetState() {
+    Entity::resetState();
+    m_state = PLAYER_STATE::FREE;
+    m_timer = 0;
+    m_stun_timer = 0;
+    m_last_facing = m_facing;
+    m_facing_timer = 0;
+}
+
+// Walks by input, wrapping around the edges on the same floor
+void Player::move(Real dt) {
+    const Real width = m_world->getViewSize().x;
+    m_x += getMovementSpeed() * m_direction * dt;
     
-    m_state = new_state;
+    if(m_x < 0) m_x = width;
+    else if(m_x > width) m_x = 0;
 }
 
-void Player::updateState(float dt) {
-    m_timer -= dt;
-    const bool time_is_up = m_timer <= 0;
+// Ticks left in which input is ignored and nothing can be touched: while hit, falling or
+// bumping the head. Two are left for the state to end on a normal update.
+int Player::getUncontrolledTicks(Real dt) const {
+    if(m_direction != 0) return 0;
+    if(m_state != PLAYER_STATE::HIT_BY_HAZARD &&
+       m_state != PLAYER_STATE::FALLING &&
+       m_state != PLAYER_STATE::HIT_HEAD) return 0;
     
+    return std::max(0, static_cast<int>(m_timer / dt) - 2);
+}
+
+// One tick of updateState() without the transitions, the timers come out as update() leaves them
+void Player::skip(Real dt) {
+    m_timer -= dt;
     m_stun_timer -= dt;
-    const bool stun_time_is_up = m_stun_timer <= 0;
     
-    switch(m_state) {
-        case PLAYER_STATE::FREE:
-            m_draw_offset_y = 0;
-            break;
-            
-        case PLAYER_STATE::JUMPING:
-            m_draw_offset_y = Game::i().getFloorHeight()*(m_timer/m_move_time);
-            if(time_is_up) changeState(PLAYER_STATE::FREE);
-            break;
-        
-        case PLAYER_STATE::FALLING:
-            m_draw_offset_y = -Game::i().getFloorHeight()*(m_timer/m_move_time);
-            if(time_is_up) changeState(PLAYER_STATE::STUNNED);
-            break;
-        
-        case PLAYER_STATE::HIT_BY_HAZARD:
-            m_draw_offset_y = 0;
-            if(time_is_up) changeState(PLAYER_STATE::STUNNED);
-            break;
-            
-        case PLAYER_STATE::HIT_HEAD:
-            m_draw_offset_y = -0.25f*Game::i().getFloorHeight()*(m_timer/m_hit_head_time);
-            if(time_is_up) changeState(PLAYER_STATE::STUNNED);
-            break;
-        
-        case PLAYER_STATE::STUNNED:
-            m_draw_offset_y = 0;
-            if(stun_time_is_up) changeState(PLAYER_STATE::FREE);
-            break;
+    const State& state = STATES[m_state];
+    m_draw_offset_y = state.offset == 0 ? Real(0) : state.offset*m_world->getFloorHeight()*(m_timer/state.duration);
+}
+
+Player::Shown Player::getShown() const {
+    Shown shown;
+    shown.state = m_state;
+    shown.floor = m_floor;
+    shown.x = static_cast<float>(m_x);
+    shown.draw_offset_y = static_cast<float>(m_draw_offset_y);
+    shown.direction = m_direction;
+    shown.facing = m_facing;
+    shown.color = m_sprite_color.toInteger();
+    return shown;
+}
+
+void Player::show(const Shown& shown) {
+    m_state = shown.state;
+    m_floor = shown.floor;
+    m_x = shown.x;
+    m_draw_offset_y = shown.draw_offset_y;
+    m_direction = shown.direction;
+    m_facing = shown.facing;
+    m_sprite_color = sf::Color(shown.color);
+}
+
+float Player::getAnimationAge() const { return static_cast<float>(getAnimationClock() - m_animation_start); }
+void Player::showAnimation(float age) { m_animation_start = getAnimationClock() - age; }
+
+void Player::copyState(const Entity& other) {
+    Entity::copyState(other);
+    
+    // Players are only copied from players
+    const Player& player = static_cast<const Player&>(other);
+    m_state = player.m_state;
+    m_timer = player.m_timer;
+    m_stun_timer = player.m_stun_timer;
+    m_last_facing = player.m_last_facing;
+    m_facing_timer = player.m_facing_timer;
+}
+
+void Player::hashState(StateHash& hash) const {
+    Entity::hashState(hash);
+    hash.add(static_cast<std::uint32_t>(m_state));
+    hash.add(m_timer);
+    hash.add(m_stun_timer);
+    hash.add(static_cast<std::int32_t>(m_last_facing));
+    hash.add(m_facing_timer);
+}
+
+std::uint64_t Player::hashTick() const {
+    TickHash hash(Entity::hashTick());
+    hash.add(static_cast<std::uint32_t>(m_state));
+    hash.add(m_timer);
+    hash.add(m_stun_timer);
+    return hash.get();
+}
+
+// Enters the state the table gives for this trigger, returns false if the trigger means nothing now
+bool Player::fire(TRIGGER trigger) {
+    const Transition& transition = TRANSITIONS.at[m_state][trigger];
+    if(!transition.valid) return false;
+    
+    ++m_transition_counts[m_state][trigger];
+    if(FlightRecorder* recorder = m_world->getFlightRecorder()) recorder->recordStateChange(m_state, trigger, transition.to);
+    
+    // Move
+    if(transition.move == MOVE::CLIMB) moveUp(true);
+    else if(transition.move == MOVE::DROP) moveDown();
+    
+    // Leave
+    if(transition.exit_event != NO_EVENT) m_world->trigger(transition.exit_event);
+    if(transition.top_event != NO_EVENT && m_floor == -1) m_world->trigger(transition.top_event);
+    
+    // Enter
+    const State& state = STATES[transition.to];
+    const bool on_bottom = m_floor == m_world->getBottomFloor();
+    if(state.enter_event != NO_EVENT) m_world->trigger(state.enter_event);
+    if(state.bottom_event != NO_EVENT && on_bottom) m_world->trigger(state.bottom_event);
+    
+    // Stack up the stun time
+    if(transition.stun > 0) {
+        if(m_stun_timer < 0) m_stun_timer = 0;
+        m_stun_timer += on_bottom ? transition.bottom_stun : transition.stun;
     }
+    
+    if(state.duration > 0) m_timer = state.duration;
+    m_sprite_color = sf::Color(state.color);
+    
+    m_state = transition.to;
+    restartAnimation();
+    return true;
+}
+
+void Player::updateState(Real dt) {
+    m_timer -= dt;
+    m_stun_timer -= dt;
+    
+    // Rises or sinks back to the floor with the timer
+    const State& state = STATES[m_state];
+    m_draw_offset_y = state.offset == 0 ? Real(0) : state.offset*m_world->getFloorHeight()*(m_timer/state.duration);
+    
+    // One transition per update
+    if(m_timer <= 0 && fire(TRIGGER::TIME_UP)) return;
+    if(m_stun_timer <= 0) fire(TRIGGER::STUN_UP);
 }
 
 void Player::updateDirection() {
@@ -170,8 +282,8 @@ void Player::updateDirection() {
     
     // Controllable
     if(m_state == PLAYER_STATE::FREE) {
-        const bool right = sf::Keyboard::isKeyPressed(sf::Keyboard::Right);
-        const bool left = sf::Keyboard::isKeyPressed(sf::Keyboard::Left);
+        const bool right = m_world->getInput() & World::INPUT_RIGHT;
+        const bool left = m_world->getInput() & World::INPUT_LEFT;
         
         m_direction = !(right ^ left) ? 0 : right ? 1 : -1;
     }
@@ -179,61 +291,82 @@ void Player::updateDirection() {
     else m_direction = 0;
     
     // Started or Stopped walking
-         if(dir_before == 0 && m_direction != 0) Game::i().trigger(Game::GAME_EVENT::STARTED_WALKING);
-    else if(dir_before != 0 && m_direction == 0) Game::i().trigger(Game::GAME_EVENT::STOPPED_WALKING);
+         if(dir_before == 0 && m_direction != 0) m_world->trigger(World::GAME_EVENT::STARTED_WALKING);
+    else if(dir_before != 0 && m_direction == 0) m_world->trigger(World::GAME_EVENT::STOPPED_WALKING);
+    
+    // Walking and standing animations
+    if((dir_before == 0) != (m_direction == 0)) restartAnimation();
 }
 
+// Only finds what is touched, the table decides what it means in the current state
 void Player::checkInteractions() {
     // Holes
-    const bool jump = sf::Keyboard::isKeyPressed(sf::Keyboard::Up);
+    const bool jump = m_world->getInput() & World::INPUT_JUMP;
     bool jump_result = false;
-    for(auto& hole : Game::i().getHoles()) {
+    for(auto& hole : m_world->getHoles()) {
         // Jump
-        if(jump) {
-            if(m_state == PLAYER_STATE::FREE) {
-                if(hole->collides(m_floor, getPosition().x)) {
-                    moveUp(true);
-                    changeState(PLAYER_STATE::JUMPING);
-                    jump_result = true;
-                }
-            }
-        }
+        if(jump && hole->collides(m_floor, m_x) && fire(TRIGGER::JUMP_INTO_HOLE)) jump_result = true;
         
         // Fall
-        if(m_state == PLAYER_STATE::FREE || m_state == PLAYER_STATE::STUNNED) {
-            if(hole->collides(m_floor + 1, getPosition().x)) {
-                moveDown();
-                changeState(PLAYER_STATE::FALLING);
-            }
-        }
+        if(hole->collides(m_floor + 1, m_x)) fire(TRIGGER::HOLE_BELOW);
     }
     
     // Hit head to ceiling
-    if(m_state == PLAYER_STATE::FREE && jump && !jump_result)
-        changeState(PLAYER_STATE::HIT_HEAD);
+    if(jump && !jump_result) fire(TRIGGER::JUMP_INTO_CEILING);
     
     // Hit by hazard
-    if(m_state == PLAYER_STATE::FREE) {
-        for(auto& hazard : Game::i().getHazards()) {
-            if(hazard->collides(m_floor, getPosition().x))
-                changeState(PLAYER_STATE::HIT_BY_HAZARD);
-        }
+    for(auto& hazard : m_world->getHazards()) {
+        if(hazard->collides(m_floor, m_x)) fire(TRIGGER::HAZARD_HIT);
     }
 }
 
-void Player::changeAnimations() {
+void Player::findAnimations() {
+    Entity::findAnimations();
+    findAnimation(ANIMATION::STUN, "stun");
+    findAnimation(ANIMATION::FALL, "fall");
+    findAnimation(ANIMATION::CLIMB, "climb");
+    findAnimation(ANIMATION::JUMP, "jump");
+}
+
+Entity::ANIMATION Player::pickAnimation() const {
     if(m_state == PLAYER_STATE::STUNNED)
-        play(Game::i().getAnimation(m_sprite_name + "_stun"));
+        return ANIMATION::STUN;
     else if(m_state == PLAYER_STATE::FALLING || m_state == PLAYER_STATE::HIT_BY_HAZARD)
-        play(Game::i().getAnimation(m_sprite_name + "_fall"));
+        return ANIMATION::FALL;
     else if(m_state == PLAYER_STATE::JUMPING)
-        play(Game::i().getAnimation(m_sprite_name + "_climb"));
+        return ANIMATION::CLIMB;
     else if(m_state == PLAYER_STATE::HIT_HEAD)
-        play(Game::i().getAnimation(m_sprite_name + "_jump"));
-    else Entity::changeAnimations();
+        return ANIMATION::JUMP;
+    else return Entity::pickAnimation();
 }
 
 
 // Getters
-int Player::getLowestFloor() { return Game::i().getBottomFloor(); }
+Player::PLAYER_STATE Player::getState() const { return m_state; }
+Real Player::getTimer() const { return std::max(m_timer, Real(0)); }
+Real Player::getStunTimer() const { return std::max(m_stun_timer, Real(0)); }
+std::uint32_t Player::getTransitionCount(PLAYER_STATE from, TRIGGER trigger) const { return m_transition_counts[from][trigger]; }
+
+Player::PLAYER_STATE Player::getTransitionTarget(PLAYER_STATE from, TRIGGER trigger) {
+    const Transition& transition = TRANSITIONS.at[from][trigger];
+    return transition.valid ? transition.to : PLAYER_STATE::STATE_COUNT;
+}
+
+Real Player::getMaxStunTime() {
+    Real max_stun = 0;
+    for(const Transition& row : TRANSITION_ROWS) max_stun = std::max(max_stun, std::max(row.stun, row.bottom_stun));
+    return max_stun;
+}
+
+const char* Player::getStateName(PLAYER_STATE state) {
+    static const char* names[STATE_COUNT] = { "FREE", "JUMPING", "FALLING", "HIT_BY_HAZARD", "HIT_HEAD", "STUNNED" };
+    return state < STATE_COUNT ? names[state] : "?";
+}
+
+const char* Player::getTriggerName(TRIGGER trigger) {
+    static const char* names[TRIGGER_COUNT] = { "TIME_UP", "STUN_UP", "JUMP_INTO_HOLE", "HOLE_BELOW", "JUMP_INTO_CEILING", "HAZARD_HIT" };
+    return trigger < TRIGGER_COUNT ? names[trigger] : "?";
+}
+Real Player::getAnimationClock() const { return m_world->getGlobalTimer(); }
+int Player::getLowestFloor() const { return m_world->getBottomFloor(); }
 int Player::getSpawnFloor() { return getLowestFloor(); }
@@ -1,55 +1,91 @@
 #ifndef Player_hpp
 #define Player_hpp
 
+#include <cstdint>
+
 #include "Entity.hpp"
 
 class Player : public Entity {
 public:
-    Player();
+    Player(World& world);
     
     // Global
-    virtual void update(float dt);
+    virtual void update(Real dt);
+    virtual void copyState(const Entity& other);
+    virtual void hashState(StateHash& hash) const;
+    virtual std::uint64_t hashTick() const;
+    
+    // State
+    enum PLAYER_STATE { FREE, JUMPING, FALLING, HIT_BY_HAZARD, HIT_HEAD, STUNNED, STATE_COUNT };
+    PLAYER_STATE getState() const;
+    Real getTimer() const;     // Left in the current state, 0 if it doesn't end by itself
+    Real getStunTimer() const; // Left until it can move again
+    static Real getMaxStunTime(); // Given by one transition, stuns that stack up can go over it
+    
+    // State machine, everything that changes the state comes in as one of these.
+    // The transitions are a table in Player.cpp.
+    enum TRIGGER { TIME_UP, STUN_UP, JUMP_INTO_HOLE, HOLE_BELOW, JUMP_INTO_CEILING, HAZARD_HIT, TRIGGER_COUNT };
+    static PLAYER_STATE getTransitionTarget(PLAYER_STATE from, TRIGGER trigger); // STATE_COUNT if there is none
+    static const char* getStateName(PLAYER_STATE state);
+    static const char* getTriggerName(TRIGGER trigger);
+    std::uint32_t getTransitionCount(PLAYER_STATE from, TRIGGER trigger) const;
+    
+    // Skipping
+    int getUncontrolledTicks(Real dt) const;
+    void skip(Real dt);
+    
+    // Spectating, what drawing the player takes, set without playing
+    struct Shown {
+        PLAYER_STATE state;
+        int floor;
+        float x;
+        float draw_offset_y;
+        int direction;
+        int facing;
+        std::uint32_t color;
+    };
+    Shown getShown() const;
+    void show(const Shown& shown);
+    float getAnimationAge() const; // Seconds since the animation started
+    void showAnimation(float age);
 
 protected:
     // Gameplay
-    virtual int getLowestFloor();
+    virtual int getLowestFloor() const;
     virtual int getSpawnFloor();
-    virtual void updateFacing(float dt);
+    virtual void move(Real dt);
+    virtual void resetState();
+    virtual void updateFacing(Real dt);
+    virtual Real getAnimationClock() const;
     
 private:
 // Functions
     // State
-    enum PLAYER_STATE { FREE, JUMPING, FALLING, HIT_BY_HAZARD, HIT_HEAD, STUNNED };
-    void changeState(PLAYER_STATE new_state);
-    void updateState(float dt);
+    bool fire(TRIGGER trigger);
+    void updateState(Real dt);
     
     // Gameplay
     void updateDirection();
     void checkInteractions();
     
     // Render
-    virtual void changeAnimations();
+    virtual void findAnimations();
+    virtual ANIMATION pickAnimation() const;
     
 // Variables
     // State
     PLAYER_STATE m_state;
     
-    // Timers
-    float m_timer;
-    float m_stun_timer;
+    std::uint32_t m_transition_counts[STATE_COUNT][TRIGGER_COUNT]; // Not part of the state, never copied
     
-    // Constants
-    const float m_move_time;
-    const float m_hit_head_time;
-    const float m_hit_by_hazard_time;
-    const float m_stun_time;
-    const float m_hazard_hit_stun_time;
-    const float m_long_stun_time;
+    // Timers
+    Real m_timer;
+    Real m_stun_timer;
     
     // Render
     int m_last_facing;
-    float m_facing_timer;
-    const float m_facing_interval;
+    Real m_facing_timer;
+    const Real m_facing_interval;
 }; 
 
 #endif /* Player_hpp */
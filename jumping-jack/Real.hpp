@@ -0,0 +1,77 @@
+#ifndef Real_hpp
+#define Real_hpp
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <random>
+
+#include "Library/Fixed.hpp"
+
+// Number type of the simulation: positions, speeds and timers.
+// Floats by default. Built with JJ_FIXED_POINT it is fixed point, then a replay plays out bit
+// for bit the same on every build and CPU. Drawing and tools convert with static_cast<float>.
+#ifdef JJ_FIXED_POINT
+typedef Fixed Real;
+#else
+typedef float Real;
+#endif
+
+// Larger than any time or position in the game
+const Real REAL_MAX = std::numeric_limits<Real>::max();
+
+// Uniform in [lower, higher), fixed point draws straight from the generator bits because the
+// standard distributions differ between standard libraries
+inline Real random_real(std::mt19937& mt, Real lower, Real higher) {
+#ifdef JJ_FIXED_POINT
+    const std::uint64_t range = static_cast<std::uint64_t>((higher - lower).getRaw());
+    if(range == 0) return lower;
+    const std::uint64_t bits = (static_cast<std::uint64_t>(mt()) << 32) | mt();
+    return lower + Fixed::fromRaw(static_cast<std::int64_t>(bits % range));
+#else
+    std::uniform_real_distribution<float> dist(lower, higher);
+    return dist(mt);
+#endif
+}
+
+// FNV-1a over the bytes of plain values, for telling apart simulation states
+class StateHash {
+public:
+    StateHash() : m_hash(14695981039346656037ull) {}
+
+    template<class T>
+    void add(const T& value) {
+        static_assert(std::is_trivially_copyable<T>::value, "Only plain values can be hashed");
+        unsigned char bytes[sizeof(T)];
+        std::memcpy(bytes, &value, sizeof(T));
+        for(unsigned char byte : bytes) m_hash = (m_hash ^ byte) * 1099511628211ull;
+    }
+
+    std::uint64_t get() const { return m_hash; }
+
+private:
+    std::uint64_t m_hash;
+};
+
+// Cheap enough for hashing every tick. Whole values of up to 8 bytes are mixed on their own and
+// only then rotated into the hash, so the mixing of many values can overlap.
+class TickHash {
+public:
+    explicit TickHash(std::uint64_t hash = 0) : m_hash(hash) {}
+
+    template<class T>
+    void add(const T& value) {
+        static_assert(std::is_trivially_copyable<T>::value && sizeof(T) <= sizeof(std::uint64_t), "Only plain values up to 8 bytes can be hashed");
+        std::uint64_t word = 0;
+        std::memcpy(&word, &value, sizeof(T));
+        word = (word ^ (word >> 31)) * 0x9e3779b97f4a7c15ull;
+        m_hash = ((m_hash << 7) | (m_hash >> 57)) ^ word ^ (word >> 29);
+    }
+
+    std::uint64_t get() const { return m_hash; }
+
+private:
+    std::uint64_t m_hash;
+};
+
+#endif /* Real_hpp */
@@ -0,0 +1,201 @@
+#include "Replay.hpp"
+
+#include <fstream>
+#include <cstring>
+
+// Version 1 is the header and the inputs, 2 adds the checkpoints after them, 3 the world size
+// after those, 4 the mode and 5 a tick hash for every checkpoint. Older ones are of the normal
+// size and mode. 6 is laid out like 5, the state hashes before it were made from other bytes.
+namespace {
+    const char MAGIC[4] = { 'J', 'J', 'R', 'P' };
+    const std::uint32_t VERSION = 6;
+    const std::uint32_t STATE_HASH_VERSION = 6;
+    const std::uint32_t NORMAL_FLOOR_COUNT = 8;
+    const std::uint32_t NORMAL_MAX_HOLE_COUNT = 8;
+    const World::Input KNOWN_INPUTS = World::INPUT_LEFT | World::INPUT_RIGHT | World::INPUT_JUMP | World::INPUT_CONFIRM;
+    
+    struct Header {
+        char magic[4];
+        std::uint32_t version;
+        std::uint32_t seed;
+        std::uint32_t tick_count;
+    };
+    
+    struct CheckpointHeader {
+        std::uint32_t fixed_point;
+        std::uint32_t count;
+    };
+    
+    struct WorldSize {
+        std::uint32_t floor_count;
+        std::uint32_t max_hole_count;
+    };
+    
+    struct Mode {
+        std::uint32_t endless;
+    };
+    
+#ifdef JJ_FIXED_POINT
+    const bool FIXED_POINT = true;
+#else
+    const bool FIXED_POINT = false;
+#endif
+}
+
+Replay::Replay() :
+    m_seed(0),
+    m_floor_count(NORMAL_FLOOR_COUNT),
+    m_max_hole_count(NORMAL_MAX_HOLE_COUNT),
+    m_endless(false),
+    m_fixed_point(FIXED_POINT),
+    m_current_state_hashes(true) {}
+
+void Replay::start(unsigned seed, const World& world) {
+    m_seed = seed;
+    m_floor_count = world.getBottomFloor() + 1;
+    m_max_hole_count = world.getMaxHoleCount();
+    m_endless = world.isEndless();
+    m_inputs.clear();
+    m_fixed_point = FIXED_POINT;
+    m_current_state_hashes = true;
+    m_checkpoints.clear();
+    m_tick_hashes.clear();
+}
+
+void Replay::record(World::Input input) { m_inputs.push_back(input); }
+
+// Like the recorded world, a changeLevel(0) is expected after
+void Replay::setUp(World& world) const {
+    world.setSize(m_floor_count, m_max_hole_count);
+    world.setEndless(m_endless);
+    world.seed(m_seed);
+}
+
+// Call after the world is updated with the last recorded input
+void Replay::checkpoint(const World& world) {
+    if(m_inputs.size() % CHECKPOINT_INTERVAL != 0) return;
+    
+    m_checkpoints.push_back(world.getStateHash());
+    m_tick_hashes.push_back(world.getTickHash());
+}
+
+bool Replay::loadFromFile(const std::string& file_name) {
+    std::ifstream file(file_name, std::ios::binary);
+    if(!file) return false;
+    
+    Header header;
+    if(!file.read(reinterpret_cast<char*>(&header), sizeof(header))) return false;
+    if(std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version < 1 || header.version > VERSION) return false;
+    
+    m_seed = header.seed;
+    m_floor_count = NORMAL_FLOOR_COUNT;
+    m_max_hole_count = NORMAL_MAX_HOLE_COUNT;
+    m_endless = false;
+    
+    // The inputs have to be in the file, a byte a tick, and be inputs
+    const std::streamoff inputs_start = file.tellg();
+    file.seekg(0, std::ios::end);
+    const std::streamoff file_size = file.tellg();
+    file.seekg(inputs_start);
+    if(header.tick_count > file_size - inputs_start) return false;
+    
+    m_inputs.resize(header.tick_count);
+    if(!file.read(reinterpret_cast<char*>(m_inputs.data()), m_inputs.size())) return false;
+    for(World::Input input : m_inputs) if(input & ~KNOWN_INPUTS) return false;
+    
+    // Checkpoints
+    m_fixed_point = FIXED_POINT;
+    m_current_state_hashes = header.version >= STATE_HASH_VERSION;
+    m_checkpoints.clear();
+    m_tick_hashes.clear();
+    if(header.version < 2) return true;
+    
+    CheckpointHeader checkpoints;
+    if(!file.read(reinterpret_cast<char*>(&checkpoints), sizeof(checkpoints))) return false;
+    if(checkpoints.count > m_inputs.size() / CHECKPOINT_INTERVAL) return false;
+    
+    m_fixed_point = checkpoints.fixed_point != 0;
+    m_checkpoints.resize(checkpoints.count);
+    if(!file.read(reinterpret_cast<char*>(m_checkpoints.data()), m_checkpoints.size() * sizeof(std::uint64_t))) return false;
+    if(header.version < 3) return true;
+    
+    // World size
+    WorldSize size;
+    if(!file.read(reinterpret_cast<char*>(&size), sizeof(size))) return false;
+    
+    if(size.floor_count < 1 || size.floor_count > World::MAX_FLOOR_COUNT) return false;
+    if(size.max_hole_count > static_cast<std::uint32_t>(World::MAX_FLOOR_COUNT)) return false;
+    
+    m_floor_count = size.floor_count;
+    m_max_hole_count = size.max_hole_count;
+    if(header.version < 4) return true;
+    
+    // Mode
+    Mode mode;
+    if(!file.read(reinterpret_cast<char*>(&mode), sizeof(mode))) return false;
+    
+    m_endless = mode.endless != 0;
+    if(header.version < 5) return true;
+    
+    // Tick hashes, as many as checkpoints
+    m_tick_hashes.resize(m_checkpoints.size());
+    return static_cast<bool>(file.read(reinterpret_cast<char*>(m_tick_hashes.data()), m_tick_hashes.size() * sizeof(std::uint64_t)));
+}
+
+bool Replay::saveToFile(const std::string& file_name) const {
+    std::ofstream file(file_name, std::ios::binary);
+    if(!file) return false;
+    
+    Header header;
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.seed = m_seed;
+    header.tick_count = static_cast<std::uint32_t>(m_inputs.size());
+    
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(m_inputs.data()), m_inputs.size());
+    
+    CheckpointHeader checkpoints;
+    checkpoints.fixed_point = m_fixed_point;
+    checkpoints.count = static_cast<std::uint32_t>(m_checkpoints.size());
+    
+    file.write(reinterpret_cast<const char*>(&checkpoints), sizeof(checkpoints));
+    file.write(reinterpret_cast<const char*>(m_checkpoints.data()), m_checkpoints.size() * sizeof(std::uint64_t));
+    
+    WorldSize size;
+    size.floor_count = static_cast<std::uint32_t>(m_floor_count);
+    size.max_hole_count = static_cast<std::uint32_t>(m_max_hole_count);
+    
+    file.write(reinterpret_cast<const char*>(&size), sizeof(size));
+    
+    Mode mode;
+    mode.endless = m_endless;
+    
+    file.write(reinterpret_cast<const char*>(&mode), sizeof(mode));
+    
+    file.write(reinterpret_cast<const char*>(m_tick_hashes.data()), m_tick_hashes.size() * sizeof(std::uint64_t));
+    return static_cast<bool>(file);
+}
+
+// Getters
+unsigned Replay::getSeed() const { return m_seed; }
+int Replay::getFloorCount() const { return m_floor_count; }
+std::size_t Replay::getMaxHoleCount() const { return m_max_hole_count; }
+bool Replay::isEndless() const { return m_endless; }
+std::size_t Replay::getTickCount() const { return m_inputs.size(); }
+World::Input Replay::getInput(std::size_t tick) const { return m_inputs[tick]; }
+bool Replay::isFixedPoint() const { return m_fixed_point; }
+bool Replay::hasCurrentStateHashes() const { return m_current_state_hashes; }
+
+bool Replay::hasCheckpoint(std::size_t tick_count) const {
+    return tick_count > 0 && tick_count % CHECKPOINT_INTERVAL == 0 && tick_count / CHECKPOINT_INTERVAL <= m_checkpoints.size();
+}
+
+std::uint64_t Replay::getCheckpoint(std::size_t tick_count) const { return m_checkpoints[tick_count / CHECKPOINT_INTERVAL - 1]; }
+
+// Replays before version 5 have checkpoints without them
+bool Replay::hasTickHash(std::size_t tick_count) const {
+    return hasCheckpoint(tick_count) && tick_count / CHECKPOINT_INTERVAL <= m_tick_hashes.size();
+}
+
+std::uint64_t Replay::getTickHash(std::size_t tick_count) const { return m_tick_hashes[tick_count / CHECKPOINT_INTERVAL - 1]; }
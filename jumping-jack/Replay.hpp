@@ -0,0 +1,55 @@
+#ifndef Replay_hpp
+#define Replay_hpp
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "World.hpp"
+
+// A session as its seed, world setup and the input of every tick, worlds play it back the same way.
+// Cheats and generated levels are not part of it. Every second the world state and tick hashes
+// are kept too, so a playback can tell where it went different.
+class Replay {
+public:
+    Replay();
+    
+    static const std::size_t CHECKPOINT_INTERVAL = 125;
+    
+    void start(unsigned seed, const World& world);
+    void setUp(World& world) const;
+    void record(World::Input input);
+    void checkpoint(const World& world);
+    
+    bool loadFromFile(const std::string& file_name);
+    bool saveToFile(const std::string& file_name) const;
+    
+    // Getters
+    unsigned getSeed() const;
+    int getFloorCount() const;
+    std::size_t getMaxHoleCount() const;
+    bool isEndless() const;
+    std::size_t getTickCount() const;
+    World::Input getInput(std::size_t tick) const;
+    bool isFixedPoint() const;
+    bool hasCurrentStateHashes() const;
+    bool hasCheckpoint(std::size_t tick_count) const;
+    std::uint64_t getCheckpoint(std::size_t tick_count) const;
+    bool hasTickHash(std::size_t tick_count) const;
+    std::uint64_t getTickHash(std::size_t tick_count) const;
+    
+private:
+    unsigned m_seed;
+    int m_floor_count;
+    std::size_t m_max_hole_count;
+    bool m_endless;
+    std::vector<World::Input> m_inputs;
+    
+    // State hashes after every CHECKPOINT_INTERVAL ticks, only comparable within the same number type
+    bool m_fixed_point;
+    bool m_current_state_hashes; // Older replays hashed the state differently, tick hashes still compare
+    std::vector<std::uint64_t> m_checkpoints;
+    std::vector<std::uint64_t> m_tick_hashes;
+};
+
+#endif /* Replay_hpp */
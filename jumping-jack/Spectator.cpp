@@ -0,0 +1,584 @@
+#include "Spectator.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <sstream>
+
+// A tick is one bit, set when anything changed, then a SECTION mask and the sections in order.
+// The status and player sections start with a mask of their fields. Numbers that change by a
+// little are sent as the difference, a keyframe has everything from scratch instead.
+namespace {
+    enum SECTION {
+        KEYFRAME = 1 << 0, CLOCKS = 1 << 1, STATUS = 1 << 2, PLAYER = 1 << 3, COUNTS = 1 << 4, OBJECTS = 1 << 5,
+        SECTION_BITS = 6
+    };
+    
+    enum STATUS_FIELD {
+        LEVEL = 1 << 0, FLAGS = 1 << 1, HEALTH = 1 << 2, SCORE = 1 << 3, HIGHSCORE = 1 << 4,
+        EFFECT = 1 << 5, TIMESCALE = 1 << 6,
+        STATUS_BITS = 7
+    };
+    
+    enum PLAYER_FIELD {
+        STATE = 1 << 0, FLOOR = 1 << 1, X = 1 << 2, DRAW_OFFSET = 1 << 3, DIRECTION = 1 << 4,
+        FACING = 1 << 5, COLOR = 1 << 6, ANIMATION = 1 << 7,
+        PLAYER_BITS = 8
+    };
+    
+    const float POSITION_SCALE = 16; // Sixteenths of a pixel
+    const float SPEED_SCALE = 16;
+    const float TIMESCALE_SCALE = 1024;
+    const float CLOCK_SCALE = 10000;
+    const float AGE_SCALE = 1000;    // Milliseconds
+    
+    // Off by more than these is corrected
+    const float POSITION_TOLERANCE = 0.5f;
+    const float CLOCK_TOLERANCE = 0.001f;
+    const float AGE_TOLERANCE = 0.002f;
+    
+    const std::uint32_t MAX_OBJECT_COUNT = 1 << 12;
+    const std::size_t MAX_CHUNK_SIZE = 60000; // Bytes, a chunk's size has to fit in 16 bits
+    const std::size_t MAX_UNSENT = 1 << 16; // Bytes a spectator can be behind before it is dropped
+    const std::size_t RECEIVE_SIZE = 4096;
+    
+    std::int32_t quantize(float value, float scale) { return static_cast<std::int32_t>(std::lround(value * scale)); }
+    std::uint32_t quantizeUnsigned(float value, float scale) { return value > 0 ? static_cast<std::uint32_t>(std::lround(value * scale)) : 0; }
+    
+    // The short way around, for distances on something that wraps after the given length
+    float wrapDistance(float distance, float length) { return distance - length * std::round(distance / length); }
+    
+    // Bits of an x from 0 to the view width, in sixteenths of a pixel
+    unsigned getPositionBits(const World& world) {
+        const std::uint32_t max_x = quantizeUnsigned(world.getViewSize().x, POSITION_SCALE);
+        unsigned bits = 1;
+        while(bits < 32 && (std::uint32_t(1) << bits) <= max_x) ++bits;
+        return bits;
+    }
+    
+    // Where the entity is at the time, as a spawn that starts the same path
+    LevelLayout::Spawn getSpawn(const Entity& entity, Real time) {
+        const Entity::Location location = entity.getLocationAt(time);
+        LevelLayout::Spawn spawn;
+        spawn.floor = location.floor;
+        spawn.x = static_cast<float>(location.x);
+        spawn.direction = entity.getDirection();
+        spawn.speed = static_cast<float>(entity.getMovementSpeed());
+        spawn.type = entity.getType();
+        return spawn;
+    }
+    
+    // Whether the view's entity is on another path than the game's. Holes and hazards pass the
+    // lap floors before they come back to the same place.
+    bool isOffPath(const Entity& game, Real game_time, const Entity& view, Real view_time, int lap_floors, float width) {
+        const LevelLayout::Spawn a = getSpawn(game, game_time);
+        const LevelLayout::Spawn b = getSpawn(view, view_time);
+        if(a.direction != b.direction || a.type != b.type) return true;
+        if(quantize(a.speed, SPEED_SCALE) != quantize(b.speed, SPEED_SCALE)) return true;
+        
+        const float distance = (a.floor - b.floor) * width + (a.x - b.x);
+        return std::abs(wrapDistance(distance, lap_floors * width)) > POSITION_TOLERANCE;
+    }
+    
+    void writeSpawn(BitWriter& writer, const LevelLayout::Spawn& spawn, bool hazard, unsigned position_bits) {
+        writer.writeUnsigned(static_cast<std::uint32_t>(std::max(spawn.floor, 0)));
+        writer.writeBits(quantizeUnsigned(spawn.x, POSITION_SCALE), position_bits);
+        writer.writeBits(static_cast<std::uint32_t>(spawn.direction + 1), 2);
+        writer.writeUnsigned(quantizeUnsigned(spawn.speed, SPEED_SCALE));
+        if(hazard) writer.writeUnsigned(static_cast<std::uint32_t>(spawn.type));
+    }
+    
+    LevelLayout::Spawn readSpawn(BitReader& reader, bool hazard, unsigned position_bits) {
+        LevelLayout::Spawn spawn;
+        spawn.floor = static_cast<int>(reader.readUnsigned());
+        spawn.x = reader.readBits(position_bits) / POSITION_SCALE;
+        spawn.direction = static_cast<int>(reader.readBits(2)) - 1;
+        spawn.speed = reader.readUnsigned() / SPEED_SCALE;
+        spawn.type = hazard ? reader.readUnsigned() : 0;
+        return spawn;
+    }
+}
+
+// Codec
+SpectatorCodec::Track::Track() :
+    value(0),
+    anchor(0),
+    step(0),
+    tick_count(0) {}
+
+void SpectatorCodec::Track::reset() { *this = Track(); }
+
+void SpectatorCodec::Track::advance() {
+    value += step;
+    ++tick_count;
+}
+
+void SpectatorCodec::Track::correct(float error) {
+    value += error;
+    if(tick_count > 0) step = (value - anchor) / tick_count;
+    anchor = value;
+    tick_count = 0;
+}
+
+SpectatorCodec::SpectatorCodec() {}
+
+void SpectatorCodec::write(const World& game, World& view, bool keyframe, BitWriter& writer) {
+    advance(view);
+    
+    // Sections go to a writer of their own first, the mask in front says which there are
+    m_sections.clear();
+    unsigned sections = keyframe ? KEYFRAME : 0;
+    sections |= writeClocks(game, view, keyframe, m_sections);
+    sections |= writeStatus(game, view, keyframe, m_sections);
+    sections |= writePlayer(game, view, keyframe, m_sections);
+    sections |= writeObjects(game, view, keyframe, m_sections);
+    
+    const std::size_t start = writer.getBitCount();
+    writer.writeBit(sections != 0);
+    if(sections != 0) {
+        writer.writeBits(sections, SECTION_BITS);
+        writer.append(m_sections);
+    }
+    
+    // The view takes it the same way the spectators do
+    BitReader reader(writer.getData(), writer.getSize(), start);
+    readChanges(reader, view);
+}
+
+bool SpectatorCodec::read(BitReader& reader, World& view) {
+    advance(view);
+    return readChanges(reader, view);
+}
+
+// Time passes the same way at both ends before a tick is read
+void SpectatorCodec::advance(World& view) {
+    view.tickShown();
+    m_x.advance();
+    m_draw_offset_y.advance();
+    showPlayer(view);
+}
+
+bool SpectatorCodec::readChanges(BitReader& reader, World& view) {
+    if(!reader.readBit()) return !reader.hasFailed();
+    
+    const unsigned sections = static_cast<unsigned>(reader.readBits(SECTION_BITS));
+    const bool keyframe = sections & KEYFRAME;
+    if(keyframe) {
+        m_x.reset();
+        m_draw_offset_y.reset();
+    }
+    
+    // Clocks
+    if(sections & CLOCKS) {
+        const float global_timer = reader.readUnsigned() / CLOCK_SCALE;
+        const float entity_time = reader.readUnsigned() / CLOCK_SCALE;
+        view.showClocks(global_timer, entity_time);
+    }
+    
+    // Status
+    if(sections & STATUS) {
+        World::Shown shown = keyframe ? World::Shown() : view.getShown();
+        const unsigned fields = static_cast<unsigned>(reader.readBits(STATUS_BITS));
+        if(fields & LEVEL) shown.level += reader.readSigned();
+        if(fields & FLAGS) {
+            shown.game_over = reader.readBit();
+            shown.changing_level = reader.readBit();
+            shown.new_high = reader.readBit();
+        }
+        if(fields & HEALTH) shown.health += reader.readSigned();
+        if(fields & SCORE) shown.score += reader.readSigned();
+        if(fields & HIGHSCORE) shown.highscore += reader.readSigned();
+        if(fields & EFFECT) shown.effect_color = static_cast<std::uint32_t>(reader.readBits(32));
+        if(fields & TIMESCALE) shown.timescale = reader.readUnsigned() / TIMESCALE_SCALE;
+        view.show(shown);
+    }
+    
+    // Player
+    if(sections & PLAYER) {
+        Player& player = view.getPlayer();
+        Player::Shown shown = player.getShown();
+        if(keyframe) shown.floor = 0;
+        
+        const unsigned fields = static_cast<unsigned>(reader.readBits(PLAYER_BITS));
+        if(fields & STATE) shown.state = static_cast<Player::PLAYER_STATE>(std::min<unsigned>(reader.readBits(3), Player::STATE_COUNT - 1));
+        if(fields & FLOOR) shown.floor += reader.readSigned();
+        if(fields & X) m_x.correct(reader.readSigned() / POSITION_SCALE);
+        if(fields & DRAW_OFFSET) m_draw_offset_y.correct(reader.readSigned() / POSITION_SCALE);
+        if(fields & DIRECTION) shown.direction = static_cast<int>(reader.readBits(2)) - 1;
+        if(fields & FACING) shown.facing = static_cast<int>(reader.readBits(2)) - 1;
+        if(fields & COLOR) shown.color = static_cast<std::uint32_t>(reader.readBits(32));
+        player.show(shown);
+        if(fields & ANIMATION) player.showAnimation(reader.readUnsigned() / AGE_SCALE);
+        showPlayer(view);
+    }
+    
+    // Holes and hazards
+    if(sections & COUNTS) {
+        const std::uint32_t hazard_count = reader.readUnsigned();
+        const std::uint32_t hole_count = reader.readUnsigned();
+        if(reader.hasFailed() || hazard_count > MAX_OBJECT_COUNT || hole_count > MAX_OBJECT_COUNT) return false;
+        view.showObjectCounts(hazard_count, hole_count);
+    }
+    
+    if(sections & OBJECTS) {
+        const unsigned position_bits = getPositionBits(view);
+        const std::uint32_t count = reader.readUnsigned();
+        for(std::uint32_t i = 0; i < count && !reader.hasFailed(); ++i) {
+            const bool hole = reader.readBit();
+            const std::uint32_t index = reader.readUnsigned();
+            const LevelLayout::Spawn spawn = readSpawn(reader, !hole, position_bits);
+            if(index >= (hole ? view.getHoles().size() : view.getHazards().size())) return false;
+            
+            if(hole) view.showHole(index, spawn);
+            else view.showHazard(index, spawn);
+        }
+    }
+    
+    return !reader.hasFailed();
+}
+
+// The player's x wraps around the view like it does in the game
+void SpectatorCodec::showPlayer(World& view) const {
+    const float width = view.getViewSize().x;
+    
+    Player& player = view.getPlayer();
+    Player::Shown shown = player.getShown();
+    shown.x = m_x.value - width * std::floor(m_x.value / width);
+    shown.draw_offset_y = m_draw_offset_y.value;
+    player.show(shown);
+}
+
+unsigned SpectatorCodec::writeClocks(const World& game, const World& view, bool keyframe, BitWriter& writer) const {
+    const float global_timer = static_cast<float>(game.getGlobalTimer());
+    const float entity_time = static_cast<float>(game.getEntityTime());
+    if(!keyframe &&
+       std::abs(global_timer - static_cast<float>(view.getGlobalTimer())) <= CLOCK_TOLERANCE &&
+       std::abs(entity_time - static_cast<float>(view.getEntityTime())) <= CLOCK_TOLERANCE) return 0;
+    
+    writer.writeUnsigned(quantizeUnsigned(global_timer, CLOCK_SCALE));
+    writer.writeUnsigned(quantizeUnsigned(entity_time, CLOCK_SCALE));
+    return CLOCKS;
+}
+
+unsigned SpectatorCodec::writeStatus(const World& game, const World& view, bool keyframe, BitWriter& writer) const {
+    const World::Shown shown = game.getShown();
+    const World::Shown base = keyframe ? World::Shown() : view.getShown();
+    
+    unsigned fields = 0;
+    if(keyframe || shown.level != base.level) fields |= LEVEL;
+    if(keyframe || shown.game_over != base.game_over || shown.changing_level != base.changing_level ||
+       shown.new_high != base.new_high) fields |= FLAGS;
+    if(keyframe || shown.health != base.health) fields |= HEALTH;
+    if(keyframe || shown.score != base.score) fields |= SCORE;
+    if(keyframe || shown.highscore != base.highscore) fields |= HIGHSCORE;
+    if(keyframe || shown.effect_color != base.effect_color) fields |= EFFECT;
+    if(keyframe || quantizeUnsigned(shown.timescale, TIMESCALE_SCALE) != quantizeUnsigned(base.timescale, TIMESCALE_SCALE)) fields |= TIMESCALE;
+    if(fields == 0) return 0;
+    
+    writer.writeBits(fields, STATUS_BITS);
+    if(fields & LEVEL) writer.writeSigned(shown.level - base.level);
+    if(fields & FLAGS) {
+        writer.writeBit(shown.game_over);
+        writer.writeBit(shown.changing_level);
+        writer.writeBit(shown.new_high);
+    }
+    if(fields & HEALTH) writer.writeSigned(static_cast<std::int32_t>(shown.health - base.health));
+    if(fields & SCORE) writer.writeSigned(static_cast<std::int32_t>(shown.score - base.score));
+    if(fields & HIGHSCORE) writer.writeSigned(static_cast<std::int32_t>(shown.highscore - base.highscore));
+    if(fields & EFFECT) writer.writeBits(shown.effect_color, 32);
+    if(fields & TIMESCALE) writer.writeUnsigned(quantizeUnsigned(shown.timescale, TIMESCALE_SCALE));
+    return STATUS;
+}
+
+// X and the draw offset are sent as how far the view's guess is off
+unsigned SpectatorCodec::writePlayer(const World& game, const World& view, bool keyframe, BitWriter& writer) const {
+    const Player::Shown shown = game.getPlayer().getShown();
+    const Player::Shown base = view.getPlayer().getShown();
+    const float x_error = wrapDistance(shown.x - (keyframe ? 0 : m_x.value), game.getViewSize().x);
+    const float draw_offset_error = shown.draw_offset_y - (keyframe ? 0 : m_draw_offset_y.value);
+    const float age = game.getPlayer().getAnimationAge();
+    
+    unsigned fields = 0;
+    if(keyframe || shown.state != base.state) fields |= STATE;
+    if(keyframe || shown.floor != base.floor) fields |= FLOOR;
+    if(keyframe || std::abs(x_error) > POSITION_TOLERANCE) fields |= X;
+    if(keyframe || std::abs(draw_offset_error) > POSITION_TOLERANCE) fields |= DRAW_OFFSET;
+    if(keyframe || shown.direction != base.direction) fields |= DIRECTION;
+    if(keyframe || shown.facing != base.facing) fields |= FACING;
+    if(keyframe || shown.color != base.color) fields |= COLOR;
+    if(keyframe || std::abs(age - view.getPlayer().getAnimationAge()) > AGE_TOLERANCE) fields |= ANIMATION;
+    if(fields == 0) return 0;
+    
+    writer.writeBits(fields, PLAYER_BITS);
+    if(fields & STATE) writer.writeBits(shown.state, 3);
+    if(fields & FLOOR) writer.writeSigned(shown.floor - (keyframe ? 0 : base.floor));
+    if(fields & X) writer.writeSigned(quantize(x_error, POSITION_SCALE));
+    if(fields & DRAW_OFFSET) writer.writeSigned(quantize(draw_offset_error, POSITION_SCALE));
+    if(fields & DIRECTION) writer.writeBits(static_cast<std::uint32_t>(shown.direction + 1), 2);
+    if(fields & FACING) writer.writeBits(static_cast<std::uint32_t>(shown.facing + 1), 2);
+    if(fields & COLOR) writer.writeBits(shown.color, 32);
+    if(fields & ANIMATION) writer.writeUnsigned(quantizeUnsigned(age, AGE_SCALE));
+    return PLAYER;
+}
+
+// Holes and hazards are sent when they are new or the view has them on another path
+unsigned SpectatorCodec::writeObjects(const World& game, const World& view, bool keyframe, BitWriter& writer) const {
+    const std::vector<Entity*>& hazards = game.getHazards();
+    const std::vector<Hole*>& holes = game.getHoles();
+    const std::vector<Entity*>& view_hazards = view.getHazards();
+    const std::vector<Hole*>& view_holes = view.getHoles();
+    const float width = game.getViewSize().x;
+    
+    unsigned sections = 0;
+    if(keyframe || hazards.size() != view_hazards.size() || holes.size() != view_holes.size()) {
+        writer.writeUnsigned(static_cast<std::uint32_t>(hazards.size()));
+        writer.writeUnsigned(static_cast<std::uint32_t>(holes.size()));
+        sections |= COUNTS;
+    }
+    
+    // Hazards pass every floor but the bottom one, holes every floor
+    const int hazard_lap = game.getBottomFloor();
+    const int hole_lap = game.getBottomFloor() + 1;
+    auto isHazardSent = [&](std::size_t i) {
+        return keyframe || i >= view_hazards.size() ||
+               isOffPath(*hazards[i], game.getEntityTime(), *view_hazards[i], view.getEntityTime(), hazard_lap, width);
+    };
+    auto isHoleSent = [&](std::size_t i) {
+        return keyframe || i >= view_holes.size() ||
+               isOffPath(*holes[i], game.getEntityTime(), *view_holes[i], view.getEntityTime(), hole_lap, width);
+    };
+    
+    std::uint32_t count = 0;
+    for(std::size_t i = 0; i < hazards.size(); ++i) count += isHazardSent(i);
+    for(std::size_t i = 0; i < holes.size(); ++i) count += isHoleSent(i);
+    if(count == 0) return sections;
+    
+    const unsigned position_bits = getPositionBits(game);
+    writer.writeUnsigned(count);
+    for(std::size_t i = 0; i < hazards.size(); ++i) {
+        if(!isHazardSent(i)) continue;
+        
+        writer.writeBit(false);
+        writer.writeUnsigned(static_cast<std::uint32_t>(i));
+        writeSpawn(writer, getSpawn(*hazards[i], game.getEntityTime()), true, position_bits);
+    }
+    for(std::size_t i = 0; i < holes.size(); ++i) {
+        if(!isHoleSent(i)) continue;
+        
+        writer.writeBit(true);
+        writer.writeUnsigned(static_cast<std::uint32_t>(i));
+        writeSpawn(writer, getSpawn(*holes[i], game.getEntityTime()), false, position_bits);
+    }
+    return sections | OBJECTS;
+}
+
+// Feed
+SpectatorFeed::Stats::Stats() :
+    tick_count(0),
+    keyframe_count(0),
+    byte_count(0),
+    spectator_count(0),
+    dropped_count(0),
+    max_spectator_count(0) {}
+
+SpectatorFeed::SpectatorFeed() :
+    m_setup(),
+    m_chunk_tick_count(0),
+    m_keyframe_age(spectate::KEYFRAME_CHUNKS),
+    m_chunk_keyframe(false) {}
+
+bool SpectatorFeed::listen(const std::string& path) { return m_listener.listen(path); }
+bool SpectatorFeed::isListening() const { return m_listener.isOpen(); }
+
+// The first tick is a keyframe, so the view only needs the same setup to start with
+void SpectatorFeed::setUp(const World& game) {
+    m_setup.version = spectate::VERSION;
+    m_setup.floor_count = game.getBottomFloor() + 1;
+    m_setup.max_hole_count = static_cast<std::uint32_t>(game.getMaxHoleCount());
+    m_setup.endless = game.isEndless();
+    
+    m_view.copyState(game);
+    m_codec = SpectatorCodec();
+    m_tick.clear();
+    m_writer.clear();
+    m_chunk_tick_count = 0;
+    m_keyframe_age = spectate::KEYFRAME_CHUNKS;
+    m_chunk_keyframe = false;
+    m_backlog.clear();
+}
+
+// A tick that would take the chunk over its size goes out in the next one, on its own if it has to.
+// Keyframes go by the chunks since the last one, as a chunk started early has none.
+void SpectatorFeed::broadcast(const World& game) {
+    const bool keyframe = m_chunk_tick_count == 0 && m_keyframe_age >= spectate::KEYFRAME_CHUNKS;
+    m_tick.clear();
+    m_codec.write(game, m_view, keyframe, m_tick);
+    assert(m_tick.getSize() <= UINT16_MAX);
+    
+    if(m_chunk_tick_count != 0 && m_writer.getSize() + m_tick.getSize() > MAX_CHUNK_SIZE) flush();
+    m_writer.append(m_tick);
+    ++m_chunk_tick_count;
+    ++m_stats.tick_count;
+    if(keyframe) {
+        ++m_stats.keyframe_count;
+        m_keyframe_age = 0;
+        m_chunk_keyframe = true;
+    }
+    
+    if(m_chunk_tick_count >= spectate::CHUNK_TICKS) flush();
+}
+
+// The chunk goes out to everyone, then the ones that connected since get the backlog
+void SpectatorFeed::flush() {
+    const spectate::ChunkHeader header = {
+        static_cast<std::uint16_t>(m_chunk_tick_count), static_cast<std::uint16_t>(m_writer.getSize())
+    };
+    const std::uint8_t* header_bytes = reinterpret_cast<const std::uint8_t*>(&header);
+    m_chunk.assign(header_bytes, header_bytes + sizeof(header));
+    m_chunk.insert(m_chunk.end(), m_writer.getData(), m_writer.getData() + m_writer.getSize());
+    
+    if(m_chunk_keyframe) m_backlog.clear();
+    m_backlog.insert(m_backlog.end(), m_chunk.begin(), m_chunk.end());
+    m_stats.byte_count += m_chunk.size();
+    m_writer.clear();
+    m_chunk_tick_count = 0;
+    ++m_keyframe_age;
+    m_chunk_keyframe = false;
+    
+    for(auto& spectator : m_spectators) send(*spectator, m_chunk.data(), m_chunk.size());
+    acceptSpectators();
+    
+    // Gone or too far behind
+    const std::size_t count = m_spectators.size();
+    m_spectators.erase(std::remove_if(m_spectators.begin(), m_spectators.end(), [](const std::unique_ptr<Spectator>& spectator) {
+        return !spectator->socket.isOpen();
+    }), m_spectators.end());
+    m_stats.dropped_count += count - m_spectators.size();
+}
+
+void SpectatorFeed::acceptSpectators() {
+    while(true) {
+        std::unique_ptr<Spectator> spectator = std::make_unique<Spectator>();
+        if(!m_listener.accept(spectator->socket)) break;
+        
+        send(*spectator, reinterpret_cast<const std::uint8_t*>(&m_setup), sizeof(m_setup));
+        send(*spectator, m_backlog.data(), m_backlog.size());
+        m_spectators.push_back(std::move(spectator));
+        ++m_stats.spectator_count;
+    }
+    m_stats.max_spectator_count = std::max(m_stats.max_spectator_count, m_spectators.size());
+}
+
+// What the socket has no room for waits for the next chunk, whatever waited goes first
+void SpectatorFeed::send(Spectator& spectator, const std::uint8_t* data, std::size_t size) {
+    if(spectator.unsent.empty()) {
+        const std::size_t sent = spectator.socket.send(data, size);
+        spectator.unsent.assign(data + sent, data + size);
+    }
+    else {
+        spectator.unsent.insert(spectator.unsent.end(), data, data + size);
+        const std::size_t sent = spectator.socket.send(spectator.unsent.data(), spectator.unsent.size());
+        spectator.unsent.erase(spectator.unsent.begin(), spectator.unsent.begin() + sent);
+    }
+    
+    if(spectator.unsent.size() > MAX_UNSENT) spectator.socket.close();
+}
+
+// Getters
+const SpectatorFeed::Stats& SpectatorFeed::getStats() const { return m_stats; }
+
+std::string SpectatorFeed::getReport() const {
+    const double seconds = m_stats.tick_count * static_cast<double>(m_view.getDt());
+    
+    std::ostringstream report;
+    report << "Spectator feed: " << m_stats.tick_count << " ticks, " << m_stats.byte_count << " bytes";
+    if(seconds > 0) report << ", " << static_cast<std::size_t>(m_stats.byte_count / seconds) << " bytes a second";
+    report << ", " << m_stats.keyframe_count << " keyframes\n";
+    report << "Spectators: " << m_stats.spectator_count << ", " << m_stats.max_spectator_count << " at once, "
+           << m_stats.dropped_count << " left or dropped\n";
+    return report.str();
+}
+
+// View
+SpectatorView::SpectatorView() :
+    m_set_up(false),
+    m_broken(false),
+    m_setup(),
+    m_next_tick(0),
+    m_waiting_tick_count(0),
+    m_tick_count(0),
+    m_byte_count(0) {}
+
+bool SpectatorView::connect(const std::string& path) { return m_socket.connect(path); }
+
+bool SpectatorView::receive(int timeout) {
+    if(m_broken) return false;
+    
+    if(m_socket.wait(POLLIN, timeout)) {
+        std::uint8_t bytes[RECEIVE_SIZE];
+        while(const std::size_t size = m_socket.receive(bytes, sizeof(bytes))) {
+            m_received.insert(m_received.end(), bytes, bytes + size);
+            m_byte_count += size;
+        }
+    }
+    
+    if(!takeMessages()) m_broken = true;
+    return !m_broken && m_socket.isOpen();
+}
+
+// The setup first, then whole chunks
+bool SpectatorView::takeMessages() {
+    std::size_t offset = 0;
+    if(!m_set_up) {
+        if(m_received.size() < sizeof(m_setup)) return true;
+        
+        std::memcpy(&m_setup, m_received.data(), sizeof(m_setup));
+        if(m_setup.version != spectate::VERSION) return false;
+        if(m_setup.floor_count < 1 || m_setup.floor_count > World::MAX_FLOOR_COUNT) return false;
+        if(m_setup.max_hole_count > static_cast<std::uint32_t>(World::MAX_FLOOR_COUNT)) return false;
+        m_set_up = true;
+        offset = sizeof(m_setup);
+    }
+    
+    spectate::ChunkHeader header;
+    while(m_received.size() - offset >= sizeof(header)) {
+        std::memcpy(&header, &m_received[offset], sizeof(header));
+        if(m_received.size() - offset - sizeof(header) < header.size) break;
+        
+        const std::uint8_t* bytes = &m_received[offset + sizeof(header)];
+        offset += sizeof(header) + header.size;
+        if(header.tick_count == 0) continue;
+        
+        m_chunks.push_back({ std::vector<std::uint8_t>(bytes, bytes + header.size), header.tick_count });
+        m_waiting_tick_count += header.tick_count;
+    }
+    
+    m_received.erase(m_received.begin(), m_received.begin() + offset);
+    return true;
+}
+
+bool SpectatorView::advance(World& view) {
+    if(m_broken || m_waiting_tick_count == 0) return false;
+    
+    Chunk& chunk = m_chunks.front();
+    if(m_next_tick == 0) m_reader = BitReader(chunk.bytes.data(), chunk.bytes.size());
+    if(!m_codec.read(m_reader, view)) {
+        m_broken = true;
+        return false;
+    }
+    
+    --m_waiting_tick_count;
+    ++m_tick_count;
+    if(++m_next_tick == chunk.tick_count) {
+        m_chunks.pop_front();
+        m_next_tick = 0;
+    }
+    return true;
+}
+
+bool SpectatorView::isSetUp() const { return m_set_up; }
+const spectate::Setup& SpectatorView::getSetup() const { return m_setup; }
+std::size_t SpectatorView::getWaitingTickCount() const { return m_waiting_tick_count; }
+std::size_t SpectatorView::getTickCount() const { return m_tick_count; }
+std::size_t SpectatorView::getByteCount() const { return m_byte_count; }
@@ -0,0 +1,188 @@
+#ifndef Spectator_hpp
+#define Spectator_hpp
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "World.hpp"
+#include "Library/BitStream.hpp"
+#include "Library/LocalSocket.hpp"
+
+// Spectators watch a game from other processes on the same machine, each one draws a world that
+// only shows what the game sends. The stream is a Setup and then chunks, each a ChunkHeader and
+// the bits of a number of ticks. Every few seconds a chunk starts with a keyframe that has
+// everything in it, a spectator that connects gets the chunks since the last one.
+// Native byte order, both ends are on the same machine.
+namespace spectate {
+    struct Setup {
+        std::uint32_t version;
+        std::int32_t floor_count;
+        std::uint32_t max_hole_count;
+        std::uint32_t endless;
+    };
+    
+    struct ChunkHeader {
+        std::uint16_t tick_count;
+        std::uint16_t size;
+    };
+    
+    const std::uint32_t VERSION = 1;
+    const std::size_t CHUNK_TICKS = 25;     // A fifth of a second
+    const std::size_t KEYFRAME_CHUNKS = 50; // Ten seconds
+}
+
+// A tick is only what changed in it that a spectator can't work out by itself. Holes and hazards
+// follow their paths, so one is sent again only when its path changes; the player moves on by the
+// step it last moved and is only sent when it is off by more than half a pixel or changes state.
+// Both ends run the same code on what was sent, the game keeps a world as the spectators have it
+// and writes corrections for wherever that one is off.
+class SpectatorCodec {
+public:
+    SpectatorCodec();
+    
+    // The game's end, writes what the view is missing of the game after a tick and reads it back
+    // into the view
+    void write(const World& game, World& view, bool keyframe, BitWriter& writer);
+    
+    // The spectator's end, false when the bits are not a tick
+    bool read(BitReader& reader, World& view);
+    
+private:
+// Types
+    // A value that goes on changing by the same step until corrected, the step is then the
+    // average since the last correction
+    struct Track {
+        Track();
+    
+        void reset();
+        void advance();
+        void correct(float error);
+    
+        float value;
+        float anchor;
+        float step;
+        unsigned tick_count;
+    };
+    
+// Functions
+    void advance(World& view);
+    bool readChanges(BitReader& reader, World& view);
+    void showPlayer(World& view) const;
+    
+    // Each writes its section if it is needed and returns its SECTION bits
+    unsigned writeClocks(const World& game, const World& view, bool keyframe, BitWriter& writer) const;
+    unsigned writeStatus(const World& game, const World& view, bool keyframe, BitWriter& writer) const;
+    unsigned writePlayer(const World& game, const World& view, bool keyframe, BitWriter& writer) const;
+    unsigned writeObjects(const World& game, const World& view, bool keyframe, BitWriter& writer) const;
+    
+// Variables
+    Track m_x;
+    Track m_draw_offset_y;
+    BitWriter m_sections;
+};
+
+// The game's end. Every tick is encoded once, the same bytes go to every spectator a chunk at a
+// time. Spectators that fall too far behind are dropped.
+class SpectatorFeed {
+public:
+    struct Stats {
+        Stats();
+    
+        std::size_t tick_count;
+        std::size_t keyframe_count;
+        std::size_t byte_count;      // Encoded, each spectator got them once
+        std::size_t spectator_count; // Connected at some point
+        std::size_t dropped_count;
+        std::size_t max_spectator_count;
+    };
+    
+    SpectatorFeed();
+    
+    // The stream starts from the game's world as it is, then takes it after every tick
+    bool listen(const std::string& path);
+    bool isListening() const;
+    void setUp(const World& game);
+    void broadcast(const World& game);
+    
+    // Getters
+    const Stats& getStats() const;
+    std::string getReport() const;
+    
+private:
+// Types
+    struct Spectator {
+        LocalSocket socket;
+        std::vector<std::uint8_t> unsent; // The socket had no room for these yet
+    };
+    
+// Functions
+    void flush();
+    void acceptSpectators();
+    void send(Spectator& spectator, const std::uint8_t* data, std::size_t size);
+    
+// Variables
+    LocalSocket m_listener;
+    spectate::Setup m_setup;
+    World m_view; // As the spectators have it
+    SpectatorCodec m_codec;
+    BitWriter m_tick;   // The last tick, before it goes into the chunk
+    BitWriter m_writer; // The chunk so far
+    std::size_t m_chunk_tick_count;
+    std::size_t m_keyframe_age; // Chunks since the one that started with a keyframe
+    bool m_chunk_keyframe;
+    std::vector<std::uint8_t> m_chunk;
+    std::vector<std::uint8_t> m_backlog; // Chunks since the last keyframe
+    std::vector<std::unique_ptr<Spectator>> m_spectators;
+    Stats m_stats;
+};
+
+// The spectator's end, takes the stream in as it comes and plays it into a world a tick at a time
+class SpectatorView {
+public:
+    SpectatorView();
+    
+    // Connection, receive() waits up to timeout milliseconds and is false once the stream ended
+    // or broke
+    bool connect(const std::string& path);
+    bool receive(int timeout);
+    bool isSetUp() const;
+    const spectate::Setup& getSetup() const;
+    
+    // Playing, false when no tick is waiting
+    bool advance(World& view);
+    std::size_t getWaitingTickCount() const;
+    
+    // Getters
+    std::size_t getTickCount() const;
+    std::size_t getByteCount() const;
+    
+private:
+// Types
+    struct Chunk {
+        std::vector<std::uint8_t> bytes;
+        std::size_t tick_count;
+    };
+    
+// Functions
+    bool takeMessages();
+    
+// Variables
+    LocalSocket m_socket;
+    std::vector<std::uint8_t> m_received; // Start of a chunk not all here yet
+    bool m_set_up;
+    bool m_broken;
+    spectate::Setup m_setup;
+    SpectatorCodec m_codec;
+    
+    std::deque<Chunk> m_chunks;
+    BitReader m_reader;      // In the first chunk
+    std::size_t m_next_tick; // Of the first chunk
+    std::size_t m_waiting_tick_count;
+    std::size_t m_tick_count;
+    std::size_t m_byte_count;
+};
+
+#endif /* Spectator_hpp */
@@ -0,0 +1,131 @@
+#include "VecEnv.hpp"
+
+#include <algorithm>
+
+namespace {
+    // Rewards
+    const float SCORE_REWARD = 0.01f; // Per point, points come from jumping up through holes
+    const float TOP_REWARD = 1;
+    const float BOTTOM_REWARD = -1;
+}
+
+VecEnv::VecEnv(const Manifest& manifest, std::size_t env_count, std::size_t thread_count, int column_count) :
+    m_env_count(env_count),
+    m_slice_count(std::max<std::size_t>(1, std::min(env_count, thread_count != 0 ? thread_count : std::thread::hardware_concurrency()))),
+    m_worlds(new World[env_count]),
+    m_seeds(env_count, 0),
+    m_encoder(m_worlds[0].getBottomFloor() + 1, column_count, manifest.hazardCount()),
+    m_observations(env_count * m_encoder.getSize(), 0),
+    m_rewards(env_count, 0),
+    m_dones(env_count, 0),
+    m_actions(nullptr),
+    m_generation(0),
+    m_busy(0),
+    m_quit(false) {
+    
+    for(std::size_t i = 0; i < m_env_count; ++i) m_worlds[i].setManifest(manifest);
+    
+    // The calling thread steps the last slice
+    for(std::size_t i = 0; i + 1 < m_slice_count; ++i) m_threads.emplace_back(&VecEnv::workerLoop, this, i);
+}
+
+VecEnv::~VecEnv() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quit = true;
+    }
+    m_started.notify_all();
+    for(auto& t : m_threads) t.join();
+}
+
+void VecEnv::reset(unsigned seed) {
+    for(std::size_t i = 0; i < m_env_count; ++i) {
+        m_seeds[i] = seed + static_cast<unsigned>(i);
+        startEpisode(i);
+        observe(i);
+    }
+    std::fill(m_rewards.begin(), m_rewards.end(), 0.0f);
+    std::fill(m_dones.begin(), m_dones.end(), 0);
+}
+
+// One tick of every game, actions holds the input of each
+void VecEnv::step(const World::Input* actions) {
+    m_actions = actions;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++m_generation;
+        m_busy = m_threads.size();
+    }
+    m_started.notify_all();
+    
+    stepRange(m_env_count * (m_slice_count - 1) / m_slice_count, m_env_count);
+    
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_finished.wait(lock, [this] { return m_busy == 0; });
+}
+
+void VecEnv::stepRange(std::size_t first, std::size_t last) {
+    for(std::size_t env = first; env < last; ++env) {
+        World& world = m_worlds[env];
+        
+        const unsigned score = world.getScore();
+        world.update(m_actions[env]);
+        
+        // Reward
+        float reward = (world.getScore() - score) * SCORE_REWARD;
+        for(World::GAME_EVENT event : world.getTickEvents()) {
+            if(event == World::GAME_EVENT::REACHED_TO_TOP) reward += TOP_REWARD;
+            else if(event == World::GAME_EVENT::DROPPED_TO_BOTTOM) reward += BOTTOM_REWARD;
+        }
+        m_rewards[env] = reward;
+        
+        // No info screens between levels, the game is done when lost or when the last level is won
+        bool done = world.isGameOver();
+        if(world.isChangingLevel()) {
+            if(world.getLevel() >= world.getLastLevel()) done = true;
+            else world.nextLevel();
+        }
+        m_dones[env] = done;
+        
+        if(done) {
+            m_seeds[env] += static_cast<unsigned>(m_env_count);
+            startEpisode(env);
+        }
+        observe(env);
+    }
+}
+
+void VecEnv::startEpisode(std::size_t env) {
+    World& world = m_worlds[env];
+    world.reset();
+    world.seed(m_seeds[env]);
+    world.changeLevel(0);
+}
+
+void VecEnv::observe(std::size_t env) {
+    m_encoder.encode(m_worlds[env], &m_observations[env * m_encoder.getSize()]);
+}
+
+void VecEnv::workerLoop(std::size_t worker) {
+    std::size_t generation = 0;
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while(true) {
+        m_started.wait(lock, [&] { return m_quit || m_generation != generation; });
+        if(m_quit) return;
+        generation = m_generation;
+        
+        lock.unlock();
+        stepRange(m_env_count * worker / m_slice_count, m_env_count * (worker + 1) / m_slice_count);
+        lock.lock();
+        
+        if(--m_busy == 0) m_finished.notify_one();
+    }
+}
+
+// Getters
+std::size_t VecEnv::getEnvCount() const { return m_env_count; }
+const ObservationEncoder& VecEnv::getEncoder() const { return m_encoder; }
+const float* VecEnv::getObservations() const { return m_observations.data(); }
+const float* VecEnv::getRewards() const { return m_rewards.data(); }
+const std::uint8_t* VecEnv::getDones() const { return m_dones.data(); }
+const World& VecEnv::getWorld(std::size_t env) const { return m_worlds[env]; }
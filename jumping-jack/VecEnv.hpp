@@ -0,0 +1,71 @@
+#ifndef VecEnv_hpp
+#define VecEnv_hpp
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "World.hpp"
+#include "ObservationEncoder.hpp"
+
+// Many independent games stepped together, for training agents. The worlds are one array and
+// every step writes observations, rewards and done flags into buffers made up front, stepping
+// doesn't allocate. No window, sound or assets, only the manifest.
+// An episode is one game from the first level. A finished one is started again with the next
+// seed of that game right away, its done flag tells the step it ended on.
+class VecEnv {
+public:
+    // 0 threads means one per hardware thread, the calling thread is one of them.
+    // Observations have a grid of the given number of columns, see ObservationEncoder.
+    VecEnv(const Manifest& manifest, std::size_t env_count, std::size_t thread_count = 0, int column_count = 32);
+    ~VecEnv();
+    
+    VecEnv(const VecEnv&) = delete;
+    VecEnv& operator=(const VecEnv&) = delete;
+    
+    // Game i plays seeds seed + i, seed + i + env count, ...
+    void reset(unsigned seed);
+    void step(const World::Input* actions);
+    
+    // Getters, env count values each, observations are env count rows of the encoder's size
+    std::size_t getEnvCount() const;
+    const ObservationEncoder& getEncoder() const;
+    const float* getObservations() const;
+    const float* getRewards() const;
+    const std::uint8_t* getDones() const;
+    const World& getWorld(std::size_t env) const;
+    
+private:
+// Functions
+    void stepRange(std::size_t first, std::size_t last);
+    void startEpisode(std::size_t env);
+    void observe(std::size_t env);
+    void workerLoop(std::size_t worker);
+    
+// Variables
+    const std::size_t m_env_count;
+    const std::size_t m_slice_count;
+    std::unique_ptr<World[]> m_worlds;
+    std::vector<unsigned> m_seeds;
+    const ObservationEncoder m_encoder;
+    
+    // Buffers
+    std::vector<float> m_observations;
+    std::vector<float> m_rewards;
+    std::vector<std::uint8_t> m_dones;
+    const World::Input* m_actions;
+    
+    // Workers, each steps its own slice of the games
+    std::vector<std::thread> m_threads;
+    std::mutex m_mutex;
+    std::condition_variable m_started;
+    std::condition_variable m_finished;
+    std::size_t m_generation;
+    std::size_t m_busy;
+    bool m_quit;
+};
+
+#endif /* VecEnv_hpp */
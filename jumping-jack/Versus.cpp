@@ -0,0 +1,340 @@
+#include "Versus.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <sstream>
+
+// A packet is the header and then the local inputs from first_tick on. Inputs are sent again
+// until the remote acknowledges them, so a lost packet is made up for by the next one.
+namespace {
+    struct PacketHeader {
+        std::uint64_t check_hash;
+        std::uint32_t check_tick;
+        std::uint32_t session;
+        std::uint32_t tick;        // Ticks the sender played
+        std::uint32_t first_tick;
+        std::uint32_t input_count;
+        std::uint32_t ack;         // Inputs the sender has, all ticks below this
+        std::uint32_t finish;
+    };
+    
+    const std::size_t MAX_PACKET_INPUTS = 64;
+}
+
+Versus::Stats::Stats() :
+    rollback_count(0),
+    replayed_tick_count(0),
+    max_rollback(0),
+    max_rollback_time(0),
+    wait_count(0),
+    check_count(0),
+    desync_count(0),
+    sent_count(0),
+    received_count(0) {}
+
+Versus::Versus() :
+    m_session(0),
+    m_input_delay(2),
+    m_local_inputs(),
+    m_remote_inputs(),
+    m_local_count(0),
+    m_remote_count(0),
+    m_remote_ack(0),
+    m_tick(0),
+    m_confirmed_tick(0),
+    m_predicted(),
+    m_predicted_hashes(),
+    m_waiting(false),
+    m_local_check(),
+    m_reported(),
+    m_simulated(),
+    m_local_finish(0),
+    m_remote_finish(0),
+    m_remote_tick(0),
+    m_result(RACING),
+    m_delayed_first(0),
+    m_delayed_count(0),
+    m_step(0),
+    m_latency(0),
+    m_latency_steps(0),
+    m_loss(0) {}
+
+// Network
+bool Versus::bind(std::uint16_t local_port) { return m_socket.bind(local_port); }
+bool Versus::connect(const std::string& host, std::uint16_t remote_port) { return m_socket.setPeer(host, remote_port); }
+
+// Both peers need the same delay, it is part of the session
+void Versus::setInputDelay(std::size_t tick_count) { m_input_delay = std::min(tick_count, MAX_ROLLBACK); }
+
+// Latency in seconds one way, loss from 0 to 1
+void Versus::setSimulatedLink(float latency, float loss) {
+    m_latency = std::max(latency, 0.0f);
+    m_loss = std::min(std::max(loss, 0.0f), 1.0f);
+}
+
+std::uint16_t Versus::getLocalPort() const { return m_socket.getLocalPort(); }
+bool Versus::isConnected() const { return m_socket.isOpen(); }
+
+// Playing
+void Versus::start(const World& local) {
+    m_remote.copyState(local);
+    m_tick = 0;
+    m_confirmed_tick = 0;
+    m_waiting = false;
+    
+    const std::uint64_t state_hash = local.getStateHash();
+    m_session = static_cast<std::uint32_t>(state_hash ^ state_hash >> 32) ^ static_cast<std::uint32_t>(m_input_delay * 0x9E3779B9u);
+    
+    // Nobody plays input in the first ticks of the delay
+    std::fill(m_local_inputs, m_local_inputs + INPUT_RING, 0);
+    std::fill(m_remote_inputs, m_remote_inputs + INPUT_RING, 0);
+    m_local_count = m_input_delay;
+    m_remote_count = m_input_delay;
+    m_remote_ack = 0;
+    
+    m_local_check = Check();
+    std::fill(m_reported, m_reported + CHECK_COUNT, Check());
+    std::fill(m_simulated, m_simulated + CHECK_COUNT, Check());
+    m_local_finish = 0;
+    m_remote_finish = 0;
+    m_remote_tick = 0;
+    m_result = RACING;
+    
+    // A packet goes out every step, the ring holds the ones on their way
+    m_step = 0;
+    m_link_random.seed(getLocalPort());
+    m_latency_steps = static_cast<std::size_t>(m_latency / static_cast<float>(local.getDt()) + 0.5f);
+    m_delayed.resize(m_latency_steps > 0 ? m_latency_steps * 2 + 16 : 0);
+    m_delayed_first = 0;
+    m_delayed_count = 0;
+    
+    m_stats = Stats();
+}
+
+bool Versus::advance(World::Input& input) {
+    ++m_step;
+    flushDelayed();
+    receive();
+    reconcile();
+    
+    // Too far ahead to play it again in time, or with a ring full of inputs the remote doesn't
+    // have, the remote has to catch up. The packet goes again in case the last ones were lost.
+    m_waiting = m_tick - m_confirmed_tick >= MAX_ROLLBACK || m_local_count - m_remote_ack >= INPUT_RING;
+    if(m_waiting) {
+        ++m_stats.wait_count;
+        sendInputs();
+        return false;
+    }
+    
+    m_local_inputs[m_local_count++ % INPUT_RING] = input;
+    input = m_local_inputs[m_tick % INPUT_RING];
+    
+    // Remote copy, predicted unless its input is in. The confirmed world is kept from the tick
+    // predicting starts.
+    const bool known = m_tick < m_remote_count;
+    if(!known && m_confirmed_tick == m_tick) m_confirmed.copyState(m_remote);
+    
+    const World::Input remote_input = predict(m_tick);
+    m_remote.update(remote_input);
+    m_predicted[m_tick % MAX_ROLLBACK] = remote_input;
+    m_predicted_hashes[m_tick % MAX_ROLLBACK] = m_remote.getTickHash();
+    ++m_tick;
+    
+    if(known && m_confirmed_tick + 1 == m_tick) {
+        ++m_confirmed_tick;
+        confirmRemote(m_confirmed_tick, m_remote.getTickHash());
+    }
+    return true;
+}
+
+// After the local world played the input advance() gave
+void Versus::sendTick(const World& local) {
+    if(m_tick % CHECK_INTERVAL == 0) {
+        m_local_check.tick = static_cast<std::uint32_t>(m_tick);
+        m_local_check.hash = local.getTickHash();
+    }
+    
+    auto& events = local.getTickEvents();
+    if(!m_local_finish && std::find(events.begin(), events.end(), World::GAME_EVENT::REACHED_TO_TOP) != events.end())
+        m_local_finish = static_cast<std::uint32_t>(m_tick);
+    
+    updateResult();
+    sendInputs();
+}
+
+// Inputs that came in for ticks that were predicted. Predictions that were right up to the
+// present confirm the remote copy as it is, otherwise the confirmed world plays the arrived
+// inputs and the copy is rolled back if one was wrong.
+void Versus::reconcile() {
+    const std::size_t arrived = std::min(m_remote_count, m_tick);
+    if(arrived <= m_confirmed_tick) return;
+    
+    std::size_t wrong = m_confirmed_tick;
+    while(wrong < arrived && m_remote_inputs[wrong % INPUT_RING] == m_predicted[wrong % MAX_ROLLBACK]) ++wrong;
+    
+    if(wrong == m_tick) {
+        for(; m_confirmed_tick < m_tick; ++m_confirmed_tick)
+            confirmRemote(m_confirmed_tick + 1, m_predicted_hashes[m_confirmed_tick % MAX_ROLLBACK]);
+        return;
+    }
+    
+    if(wrong == arrived) catchUp(arrived);
+    else rollBack(wrong, arrived);
+}
+
+void Versus::catchUp(std::size_t arrived) {
+    for(; m_confirmed_tick < arrived; ++m_confirmed_tick) {
+        m_confirmed.update(m_remote_inputs[m_confirmed_tick % INPUT_RING]);
+        confirmRemote(m_confirmed_tick + 1, m_confirmed.getTickHash());
+    }
+}
+
+// The ticks from the wrong one on are played again: up to where the input arrived by the
+// confirmed world, then by the remote copy from there with new predictions
+void Versus::rollBack(std::size_t wrong, std::size_t arrived) {
+    const auto start = std::chrono::steady_clock::now();
+    
+    catchUp(arrived);
+    m_remote.copyState(m_confirmed);
+    for(std::size_t tick = m_confirmed_tick; tick < m_tick; ++tick) {
+        const World::Input input = predict(tick);
+        m_remote.update(input);
+        m_predicted[tick % MAX_ROLLBACK] = input;
+        m_predicted_hashes[tick % MAX_ROLLBACK] = m_remote.getTickHash();
+    }
+    
+    const std::size_t replayed = m_tick - wrong;
+    const float time = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+    ++m_stats.rollback_count;
+    m_stats.replayed_tick_count += replayed;
+    m_stats.max_rollback = std::max(m_stats.max_rollback, replayed);
+    m_stats.max_rollback_time = std::max(m_stats.max_rollback_time, time);
+}
+
+// The remote keeps doing what it did last
+World::Input Versus::predict(std::size_t tick) const {
+    if(tick < m_remote_count) return m_remote_inputs[tick % INPUT_RING];
+    return m_remote_count == 0 ? 0 : m_remote_inputs[(m_remote_count - 1) % INPUT_RING];
+}
+
+// The remote copy after tick_count ticks won't change any more
+void Versus::confirmRemote(std::size_t tick_count, std::uint64_t tick_hash) {
+    if(tick_count % CHECK_INTERVAL != 0) return;
+    
+    Check& simulated = m_simulated[tick_count / CHECK_INTERVAL % CHECK_COUNT];
+    simulated.tick = static_cast<std::uint32_t>(tick_count);
+    simulated.hash = tick_hash;
+    compare(simulated, m_reported[tick_count / CHECK_INTERVAL % CHECK_COUNT]);
+}
+
+// Called once for each check when the second side of it comes in
+void Versus::compare(const Check& a, const Check& b) {
+    if(a.tick == 0 || a.tick != b.tick) return;
+    
+    ++m_stats.check_count;
+    if(a.hash != b.hash) ++m_stats.desync_count;
+}
+
+void Versus::updateResult() {
+    if(m_result != RACING) return;
+    
+    if(m_local_finish && m_remote_finish) {
+        m_result = m_local_finish < m_remote_finish ? WON : m_remote_finish < m_local_finish ? LOST : DRAW;
+    }
+    else if(m_local_finish && m_remote_tick >= m_local_finish) m_result = WON;
+    else if(m_remote_finish && m_tick >= m_remote_finish) m_result = LOST;
+}
+
+// Packets
+void Versus::receive() {
+    std::uint8_t bytes[sizeof(PacketHeader) + MAX_PACKET_INPUTS];
+    while(const std::size_t size = m_socket.receive(bytes, sizeof(bytes))) {
+        PacketHeader header;
+        if(size < sizeof(header)) continue;
+        std::memcpy(&header, bytes, sizeof(header));
+        if(header.session != m_session || header.input_count > MAX_PACKET_INPUTS || size != sizeof(header) + header.input_count) continue;
+        ++m_stats.received_count;
+        
+        // Only inputs that follow on from the ones there are, packets can come late. Ones that
+        // would overwrite inputs from the confirmed tick on come again later.
+        const std::size_t end = std::min(static_cast<std::size_t>(header.first_tick) + header.input_count, m_confirmed_tick + INPUT_RING);
+        if(header.first_tick <= m_remote_count) {
+            for(; m_remote_count < end; ++m_remote_count)
+                m_remote_inputs[m_remote_count % INPUT_RING] = bytes[sizeof(header) + m_remote_count - header.first_tick];
+        }
+        m_remote_ack = std::min(std::max<std::size_t>(m_remote_ack, header.ack), m_local_count);
+        m_remote_tick = std::max(m_remote_tick, header.tick);
+        if(header.finish) m_remote_finish = header.finish;
+        
+        if(header.check_tick != 0 && header.check_tick % CHECK_INTERVAL == 0) {
+            Check& reported = m_reported[header.check_tick / CHECK_INTERVAL % CHECK_COUNT];
+            if(reported.tick != header.check_tick) {
+                reported.tick = header.check_tick;
+                reported.hash = header.check_hash;
+                compare(reported, m_simulated[header.check_tick / CHECK_INTERVAL % CHECK_COUNT]);
+            }
+        }
+    }
+    updateResult();
+}
+
+// The local inputs the remote doesn't have yet, at most a packet of them
+void Versus::sendInputs() {
+    PacketHeader header;
+    header.check_hash = m_local_check.hash;
+    header.check_tick = m_local_check.tick;
+    header.session = m_session;
+    header.tick = static_cast<std::uint32_t>(m_tick);
+    header.first_tick = static_cast<std::uint32_t>(m_remote_ack);
+    header.input_count = static_cast<std::uint32_t>(std::min(m_local_count - m_remote_ack, MAX_PACKET_INPUTS));
+    header.ack = static_cast<std::uint32_t>(m_remote_count);
+    header.finish = m_local_finish;
+    
+    std::uint8_t bytes[sizeof(PacketHeader) + MAX_PACKET_INPUTS];
+    std::memcpy(bytes, &header, sizeof(header));
+    for(std::size_t i = 0; i < header.input_count; ++i) bytes[sizeof(header) + i] = m_local_inputs[(m_remote_ack + i) % INPUT_RING];
+    send(bytes, sizeof(header) + header.input_count);
+}
+
+// Through the simulated link if there is one, packets over its capacity are lost
+void Versus::send(const void* data, std::size_t size) {
+    ++m_stats.sent_count;
+    if(m_loss > 0 && std::uniform_real_distribution<float>(0, 1)(m_link_random) < m_loss) return;
+    
+    if(m_delayed.empty()) {
+        m_socket.send(data, size);
+        return;
+    }
+    if(m_delayed_count == m_delayed.size() || size > sizeof(Delayed::bytes)) return;
+    
+    Delayed& delayed = m_delayed[(m_delayed_first + m_delayed_count++) % m_delayed.size()];
+    delayed.release_step = m_step + m_latency_steps;
+    delayed.size = size;
+    std::memcpy(delayed.bytes, data, size);
+}
+
+void Versus::flushDelayed() {
+    while(m_delayed_count > 0 && m_delayed[m_delayed_first].release_step <= m_step) {
+        const Delayed& delayed = m_delayed[m_delayed_first];
+        m_socket.send(delayed.bytes, delayed.size);
+        m_delayed_first = (m_delayed_first + 1) % m_delayed.size();
+        --m_delayed_count;
+    }
+}
+
+// Getters
+const World& Versus::getRemoteWorld() const { return m_remote; }
+Versus::RESULT Versus::getResult() const { return m_result; }
+bool Versus::isWaiting() const { return m_waiting; }
+const Versus::Stats& Versus::getStats() const { return m_stats; }
+
+std::string Versus::getReport() const {
+    std::ostringstream report;
+    report << "Versus: " << m_tick << " ticks, " << m_stats.wait_count << " waited, " << m_stats.rollback_count << " rollbacks of "
+           << m_stats.replayed_tick_count << " ticks, longest " << m_stats.max_rollback << " ticks in "
+           << m_stats.max_rollback_time * 1000 << " ms\n";
+    report << "Packets: " << m_stats.sent_count << " sent, " << m_stats.received_count << " received\n";
+    report << "Checks: " << m_stats.check_count << ", " << m_stats.desync_count << " out of sync\n";
+    return report.str();
+}
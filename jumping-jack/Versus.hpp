@@ -0,0 +1,142 @@
+#ifndef Versus_hpp
+#define Versus_hpp
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "World.hpp"
+#include "Library/UdpSocket.hpp"
+
+// Two players race the same seeded world side by side, one game on each machine. The peers swap
+// the input of every tick over UDP, each plays its own world and a copy of the other one.
+// Local input takes effect a few ticks after it is read, so it usually arrives before the remote
+// copy needs it. Until it arrives the remote copy runs ahead on the input it last had; when that
+// turns out wrong the copy goes back to the last tick it had every input for and plays the ticks
+// since again. At most MAX_ROLLBACK ticks are ever played again, a peer that gets further ahead
+// waits. Both worlds are independent, so only the remote copy is ever rolled back.
+class Versus {
+public:
+    static const std::size_t MAX_ROLLBACK = 15;
+    
+    // Who reached the top of a level first, by tick
+    enum RESULT { RACING, WON, LOST, DRAW };
+    
+    struct Stats {
+        Stats();
+        
+        std::size_t rollback_count;
+        std::size_t replayed_tick_count;
+        std::size_t max_rollback; // Ticks
+        float max_rollback_time;  // Seconds
+        std::size_t wait_count;   // Ticks that couldn't be played yet
+        std::size_t check_count;
+        std::size_t desync_count;
+        std::size_t sent_count;
+        std::size_t received_count;
+    };
+    
+    Versus();
+    
+    // Network, a simulated link delays and drops the packets sent to try it out on one machine
+    bool bind(std::uint16_t local_port);
+    bool connect(const std::string& host, std::uint16_t remote_port);
+    void setInputDelay(std::size_t tick_count);
+    void setSimulatedLink(float latency, float loss);
+    std::uint16_t getLocalPort() const;
+    bool isConnected() const;
+    
+    // Playing, the remote copy starts as the local world does. Every tick advance() swaps the read
+    // input for the one to play now, then the local world is updated with it and sent with
+    // sendTick(). Ticks advance() returns false for are skipped.
+    void start(const World& local);
+    bool advance(World::Input& input);
+    void sendTick(const World& local);
+    
+    // Getters
+    const World& getRemoteWorld() const;
+    RESULT getResult() const;
+    bool isWaiting() const;
+    const Stats& getStats() const;
+    std::string getReport() const;
+    
+private:
+// Types
+    struct Check {
+        std::uint32_t tick;
+        std::uint64_t hash;
+    };
+    
+    struct Delayed {
+        std::size_t release_step;
+        std::size_t size;
+        std::uint8_t bytes[128];
+    };
+    
+// Functions
+    void reconcile();
+    void catchUp(std::size_t arrived);
+    void rollBack(std::size_t wrong, std::size_t arrived);
+    World::Input predict(std::size_t tick) const;
+    void confirmRemote(std::size_t tick_count, std::uint64_t tick_hash);
+    void compare(const Check& a, const Check& b);
+    void updateResult();
+    
+    // Packets
+    void receive();
+    void sendInputs();
+    void send(const void* data, std::size_t size);
+    void flushDelayed();
+    
+// Variables
+    UdpSocket m_socket;
+    std::uint32_t m_session; // Peers only take packets from the same setup
+    
+    // Inputs by tick in rings, the local ones are ahead by the input delay. The local ring keeps
+    // the ones the remote doesn't have yet, the remote one those from the confirmed tick on.
+    static const std::size_t INPUT_RING = 256;
+    std::size_t m_input_delay;
+    World::Input m_local_inputs[INPUT_RING];
+    World::Input m_remote_inputs[INPUT_RING];
+    std::size_t m_local_count;
+    std::size_t m_remote_count;
+    std::size_t m_remote_ack; // Local inputs the remote has
+    
+    // Remote copy, played up to the local tick with predicted input. The confirmed world is where
+    // it was after the last tick all inputs are known for, it is only kept up while predicting.
+    World m_remote;
+    World m_confirmed;
+    std::size_t m_tick;
+    std::size_t m_confirmed_tick;
+    World::Input m_predicted[MAX_ROLLBACK];
+    std::uint64_t m_predicted_hashes[MAX_ROLLBACK];
+    bool m_waiting;
+    
+    // Desync checks, both peers hash the same world every CHECK_INTERVAL ticks
+    static const std::size_t CHECK_INTERVAL = 25;
+    static const std::size_t CHECK_COUNT = 16;
+    Check m_local_check;
+    Check m_reported[CHECK_COUNT];  // The remote's own world
+    Check m_simulated[CHECK_COUNT]; // The remote copy here
+    
+    // Race, finishes are the tick count a level was finished after, 0 until then
+    std::uint32_t m_local_finish;
+    std::uint32_t m_remote_finish;
+    std::uint32_t m_remote_tick; // Ticks the remote said it played
+    RESULT m_result;
+    
+    // Simulated link, steps count calls to advance() so time goes on while waiting
+    std::vector<Delayed> m_delayed;
+    std::size_t m_delayed_first;
+    std::size_t m_delayed_count;
+    std::size_t m_step;
+    float m_latency;
+    std::size_t m_latency_steps;
+    float m_loss;
+    std::mt19937 m_link_random;
+    
+    Stats m_stats;
+};
+
+#endif /* Versus_hpp */
@@ -0,0 +1,746 @@
+#include "World.hpp"
+
+#include <algorithm>
+
+#include "FlightRecorder.hpp"
+
+// Makes sure the pool has at least the given number of entities
+template<class T> static void reservePool(World& world, std::vector<std::unique_ptr<T>>& pool, std::vector<T*>& active, std::size_t count) {
+    while(pool.size() < count) pool.push_back(std::make_unique<T>(world));
+    active.reserve(pool.size());
+}
+
+// Next unused entity of the pool, it only grows when a level needs more than the biggest one before
+template<class T> static T& acquire(World& world, std::vector<std::unique_ptr<T>>& pool, std::vector<T*>& active) {
+    if(active.size() == pool.size()) pool.push_back(std::make_unique<T>(world));
+    
+    active.push_back(pool[active.size()].get());
+    return *active.back();
+}
+
+// Copies entities into ones taken from the pool
+template<class T> static void copyEntities(World& world, std::vector<std::unique_ptr<T>>& pool, std::vector<T*>& active, const std::vector<T*>& from) {
+    active.clear();
+    for(T* e : from) acquire(world, pool, active).copyState(*e);
+}
+
+World::World() :
+    m_manifest(nullptr),
+    m_animations(nullptr),
+    m_flight_recorder(nullptr),
+    m_random(1337),
+    m_dt(1/125.0f),
+    m_view_size(800, 600),
+    m_sheet_block_size(128),
+    m_tile_height(32),
+    m_visible_floor_count(MIN_FLOOR_COUNT),
+    m_line_height(m_view_size.y / m_visible_floor_count),
+    m_floor_count(m_visible_floor_count),
+    m_spawn_multiplier(1),
+    m_near_floor_margin(2),
+    m_far_update_interval(16),
+    m_tick(0),
+    m_tick_hash(0),
+    m_input(0),
+    m_global_timer(0),
+    m_timescale(1),
+    m_entity_time(0),
+    m_slow_mo_timescale(0.25f),
+    m_level(0),
+    m_last_level(0),
+    m_game_over(false),
+    m_changing_level(false),
+    m_health(0),
+    m_effect_color(sf::Color::Transparent),
+    m_level_arena(2048),
+    m_changing_level_time(6),
+    m_start_health(6),
+    m_player(*this),
+    m_curr_hazard(0),
+    m_max_hole_count(8),
+    m_score_base(5),
+    m_score_increase(0),
+    m_score(0),
+    m_highscore(0),
+    m_new_high(false),
+    m_endless(false),
+    m_stream_interval(8),
+    m_stream_interval_step(0.3f),
+    m_min_stream_interval(2),
+    m_stream_timer(0),
+    m_max_hazard_count(0),
+    m_next_recycled_hazard(0),
+    m_next_recycled_hole(0),
+    m_clock_period(64) {
+    
+    // A tick hardly ever has more events than there are kinds, so updates don't allocate
+    m_events.reserve(GAME_EVENT_COUNT);
+    m_tick_events.reserve(GAME_EVENT_COUNT);
+}
+
+void World::setManifest(const Manifest& manifest) {
+    m_manifest = &manifest;
+    m_last_level = static_cast<int>(m_manifest->levelCount()) - 1;
+    
+    m_hazard_names.clear();
+    for(std::size_t i = 0; i < m_manifest->hazardCount(); ++i)
+        m_hazard_names.push_back(m_manifest->getString(m_manifest->getHazard(i).name));
+    
+    reservePools();
+}
+
+// Floors beyond the 8 in view, with hazards and holes in the same density
+void World::setSize(int floor_count, std::size_t max_hole_count) {
+    m_floor_count = std::max(floor_count, m_visible_floor_count);
+    m_max_hole_count = max_hole_count;
+    m_spawn_multiplier = m_floor_count / m_visible_floor_count;
+    
+    if(m_manifest) reservePools();
+}
+
+// Entities for the biggest level are made up front, so changing levels doesn't allocate
+void World::reservePools() {
+    m_max_hazard_count = 0;
+    for(std::size_t i = 0; i < m_manifest->levelCount(); ++i)
+        m_max_hazard_count = std::max<std::size_t>(m_max_hazard_count, m_manifest->getLevel(i).hazard_count * m_spawn_multiplier);
+    
+    reservePool(*this, m_hazard_pool, m_hazards, m_max_hazard_count);
+    reservePool(*this, m_hole_pool, m_holes, m_max_hole_count);
+}
+
+void World::setEndless(bool endless) { m_endless = endless; }
+
+void World::setAnimations(const AnimationTable* animations) { m_animations = animations; }
+void World::setLayoutProvider(std::function<const LevelLayout*(int level)> provider) { m_layout_provider = provider; }
+void World::setFlightRecorder(FlightRecorder* recorder) { m_flight_recorder = recorder; }
+// A session starts from a seed, so does the tick hash chain
+void World::seed(unsigned seed) {
+    m_random.seed(seed);
+    m_tick_hash = 0;
+}
+
+// Takes the whole gameplay state of another world, used to search ahead on copies.
+// Copying into the same world again reuses its entities, so it doesn't allocate once grown.
+void World::copyState(const World& other) {
+    // Setup, the layout provider stays
+    m_manifest = other.m_manifest;
+    m_animations = other.m_animations;
+    m_hazard_names = other.m_hazard_names;
+    m_random = other.m_random;
+    m_floor_count = other.m_floor_count;
+    m_spawn_multiplier = other.m_spawn_multiplier;
+    m_max_hole_count = other.m_max_hole_count;
+    m_max_hazard_count = other.m_max_hazard_count;
+    m_endless = other.m_endless;
+    
+    // Global
+    m_input = other.m_input;
+    m_tick = other.m_tick;
+    m_tick_hash = other.m_tick_hash;
+    m_global_timer = other.m_global_timer;
+    m_timescale = other.m_timescale;
+    m_entity_time = other.m_entity_time;
+    
+    // Game
+    m_events = other.m_events;
+    m_tick_events = other.m_tick_events;
+    m_level = other.m_level;
+    m_last_level = other.m_last_level;
+    m_game_over = other.m_game_over;
+    m_changing_level = other.m_changing_level;
+    m_health = other.m_health;
+    m_effect_color = other.m_effect_color;
+    
+    // Objects
+    copyEntities(*this, m_hazard_pool, m_hazards, other.m_hazards);
+    copyEntities(*this, m_hole_pool, m_holes, other.m_holes);
+    m_player.copyState(other.m_player);
+    m_curr_hazard = other.m_curr_hazard;
+    
+    // Score
+    m_score_increase = other.m_score_increase;
+    m_score = other.m_score;
+    m_highscore = other.m_highscore;
+    m_new_high = other.m_new_high;
+    
+    // Endless
+    m_stream_timer = other.m_stream_timer;
+    m_next_recycled_hazard = other.m_next_recycled_hazard;
+    m_next_recycled_hole = other.m_next_recycled_hole;
+}
+
+// Same on every build for the same seed and inputs when built with JJ_FIXED_POINT, replays
+// keep some of these to check that they play out as recorded. Everything goes in with a fixed
+// width, size_t, enums and bool are not the same size everywhere.
+std::uint64_t World::getStateHash() const {
+    StateHash hash;
+    
+    // Global
+    hash.add(m_input);
+    hash.add(m_global_timer);
+    hash.add(m_timescale);
+    hash.add(m_entity_time);
+    
+    // Game
+    for(GAME_EVENT event : m_events) hash.add(static_cast<std::uint32_t>(event));
+    hash.add(static_cast<std::int32_t>(m_level));
+    hash.add(static_cast<std::uint8_t>(m_game_over));
+    hash.add(static_cast<std::uint8_t>(m_changing_level));
+    hash.add(static_cast<std::uint32_t>(m_health));
+    
+    // Objects
+    for(auto& e : m_hazards) e->hashState(hash);
+    for(auto& e : m_holes) e->hashState(hash);
+    m_player.hashState(hash);
+    hash.add(static_cast<std::uint32_t>(m_curr_hazard));
+    
+    // Score
+    hash.add(static_cast<std::uint32_t>(m_score));
+    hash.add(static_cast<std::uint32_t>(m_highscore));
+    
+    // Endless
+    if(m_endless) {
+        hash.add(m_stream_timer);
+        hash.add(static_cast<std::uint32_t>(m_next_recycled_hazard));
+        hash.add(static_cast<std::uint32_t>(m_next_recycled_hole));
+    }
+    return hash.get();
+}
+
+// Every update adds what it left on screen and in the player's state machine to the chain, so
+// two runs have the same tick hash until the first tick they differ in and never after.
+// Fast forwarding doesn't add to it.
+std::uint64_t World::getTickHash() const { return m_tick_hash; }
+
+// Holes and hazards are hashed as they move, given here
+void World::hashTick(std::uint64_t moved_hash) {
+    TickHash hash(m_tick_hash);
+    hash.add(m_input);
+    hash.add(m_entity_time);
+    hash.add(static_cast<std::int32_t>(m_level));
+    hash.add(static_cast<std::uint8_t>(m_game_over));
+    hash.add(static_cast<std::uint8_t>(m_changing_level));
+    hash.add(static_cast<std::uint32_t>(m_health));
+    hash.add(static_cast<std::uint32_t>(m_score));
+    
+    hash.add(moved_hash);
+    hash.add(m_player.hashTick());
+    m_tick_hash = hash.get();
+}
+
+// Add a new event to the events list
+void World::trigger(GAME_EVENT event) {
+    m_events.push_back(event);
+    if(m_flight_recorder) m_flight_recorder->recordEvent(event);
+}
+
+const char* World::getEventName(GAME_EVENT event) {
+    static const char* names[GAME_EVENT_COUNT] = {
+        "GAME_OVER",
+        "DROPPED_TO_BOTTOM", "REACHED_TO_TOP",
+        "STARTED_JUMPING", "STOPPED_JUMPING",
+        "STARTED_FALLING", "STOPPED_FALLING",
+        "HIT_BY_HAZARD", "STOPPED_HAZARD_HIT",
+        "HIT_HEAD", "STOPPED_HIT_HEAD",
+        "STARTED_WALKING", "STOPPED_WALKING",
+        "STOPPED_STUN", "PLAYER_TURNED"
+    };
+    return event < GAME_EVENT_COUNT ? names[event] : "?";
+}
+
+void World::update(Input input) {
+    m_input = input;
+    m_tick_events.clear();
+    
+    m_global_timer += m_dt;
+    
+    Real timescaled_time = m_timescale * m_dt;
+    m_entity_time += timescaled_time;
+    
+    // Update entities, the ones away from the view take turns. Hashed right after they move, the
+    // ones that didn't are as they were when last hashed.
+    const int near_first = getViewTopFloor() - m_near_floor_margin;
+    const int near_count = m_visible_floor_count + 2*m_near_floor_margin;
+    ++m_tick;
+    TickHash moved_hash;
+    for(std::size_t i = 0; i < m_holes.size(); ++i) {
+        if(isFloorInRange(m_holes[i]->getFloor(), near_first, near_count) || (m_tick + i) % m_far_update_interval == 0) {
+            m_holes[i]->update(timescaled_time);
+            moved_hash.add(m_holes[i]->hashTick());
+        }
+    }
+    for(std::size_t i = 0; i < m_hazards.size(); ++i) {
+        if(isFloorInRange(m_hazards[i]->getFloor(), near_first, near_count) || (m_tick + i) % m_far_update_interval == 0) {
+            m_hazards[i]->update(timescaled_time);
+            moved_hash.add(m_hazards[i]->hashTick());
+        }
+    }
+    if(!inInfoScreen()) m_player.update(m_dt);
+    
+    // Endless runs get new holes and hazards every so often
+    if(m_endless && !inInfoScreen()) {
+        m_stream_timer -= timescaled_time;
+        if(m_stream_timer <= 0) streamEntities();
+        rebaseClocks();
+    }
+    
+    // Check game over condition
+    if(m_game_over) {
+        if(m_input & INPUT_CONFIRM) restart();
+    }
+    else if(m_changing_level) {
+        if(m_global_timer >= m_changing_level_time ||
+           m_input & INPUT_CONFIRM) nextLevel();
+    }
+    
+    checkGameEvents();
+    hashTick(moved_hash.get());
+}
+
+// Jumps over the ticks in which nothing can happen: while the player is hit, falling or
+// bumping its head, input is ignored and everything else only moves along its path.
+// Returns how many ticks were skipped, the rest is left to update().
+// The clocks still count a tick at a time, adding up the steps in one go rounds differently,
+// so the world comes out as update() would leave it. The tick hash is not advanced, which is
+// why only scratch worlds skip: the game hashes, records and draws every tick.
+int World::fastForward(int max_ticks) {
+    if(inInfoScreen() || !m_events.empty()) return 0;
+    
+    const int max_skipped = std::min(max_ticks, m_player.getUncontrolledTicks(m_dt));
+    int ticks = 0;
+    for(; ticks < max_skipped; ++ticks) {
+        // New entities come in on a normal update
+        const Real timescaled_time = m_timescale * m_dt;
+        if(m_endless && m_stream_timer - timescaled_time <= 0) break;
+    
+        m_global_timer += m_dt;
+        m_entity_time += timescaled_time;
+        ++m_tick;
+        m_player.skip(m_dt);
+        
+        if(m_endless) {
+            m_stream_timer -= timescaled_time;
+            rebaseClocks();
+        }
+    }
+    if(ticks == 0) return 0;
+    
+    m_tick_events.clear();
+    for(auto& e : m_holes) e->update(0);
+    for(auto& e : m_hazards) e->update(0);
+    
+    return ticks;
+}
+
+void World::checkGameEvents() {
+    // Events
+    while(!m_events.empty()) {
+        GAME_EVENT event = m_events.back();
+        m_events.pop_back();
+        
+        // Game plays sounds for these after the tick
+        m_tick_events.push_back(event);
+        
+        switch(event) {
+            case GAME_EVENT::REACHED_TO_TOP:
+                if(m_endless) climbedToTop();
+                else levelFinished();
+                break;
+                
+            case GAME_EVENT::GAME_OVER:
+                gameOver();
+                break;
+                
+            case GAME_EVENT::DROPPED_TO_BOTTOM:
+                if(--m_health <= 0) {
+                    m_health = 0;
+                    trigger(GAME_EVENT::GAME_OVER);
+                }
+                break;
+                
+            case GAME_EVENT::STOPPED_JUMPING:
+                spawnHole();
+                resetEffects();
+                break;
+                
+            case GAME_EVENT::STOPPED_HIT_HEAD:
+            case GAME_EVENT::STOPPED_HAZARD_HIT:
+            case GAME_EVENT::STOPPED_FALLING:
+                resetEffects();
+                break;
+                
+            case GAME_EVENT::STARTED_FALLING:
+                m_timescale = m_slow_mo_timescale;
+                m_effect_color = sf::Color::Transparent;
+                break;
+                
+            case GAME_EVENT::STARTED_JUMPING:
+                m_timescale = m_slow_mo_timescale;
+                m_effect_color = sf::Color::Transparent;
+                addScore();
+                break;
+                
+            case GAME_EVENT::HIT_BY_HAZARD:
+                m_timescale = 0;
+                m_effect_color = sf::Color::Red;
+                break;
+                
+            case GAME_EVENT::HIT_HEAD:
+                m_timescale = m_slow_mo_timescale;
+                m_effect_color = sf::Color::White;
+                break;
+                
+            default:
+                break;
+        }
+    }
+}
+
+void World::spawnHole() {
+    if(m_holes.size() >= m_max_hole_count) return;
+    
+    int direction =
+    // First two are in reversed directions
+    m_holes.size() == 0 ? 1 :
+    m_holes.size() == 1 ? -1 :
+    // Next 3 holes descend, last 3 ascend
+    m_holes.size() <= 4 ? 1 : -1;
+    
+    acquire(*this, m_hole_pool, m_holes).spawn(true, "", direction);
+}
+
+void World::spawnHazard() {
+    respawnHazard(acquire(*this, m_hazard_pool, m_hazards));
+}
+
+// Hazard types take turns, always goes left
+void World::respawnHazard(Entity& hazard) {
+    if(++m_curr_hazard >= m_hazard_names.size()) m_curr_hazard = 0;
+    
+    hazard.spawn(true, m_hazard_names[m_curr_hazard], -1);
+    hazard.setType(m_curr_hazard);
+}
+
+// Adds a hazard and a hole, once there are as many as the pools hold the oldest ones are
+// respawned somewhere else instead
+void World::streamEntities() {
+    m_stream_timer = std::max(m_min_stream_interval, m_stream_interval - m_level * m_stream_interval_step);
+    
+    // Animation names are only needed while they are looked up
+    m_level_arena.reset();
+    
+    if(m_hazards.size() < m_max_hazard_count) spawnHazard();
+    else if(!m_hazards.empty()) {
+        respawnHazard(*m_hazards[m_next_recycled_hazard]);
+        m_next_recycled_hazard = (m_next_recycled_hazard + 1) % m_hazards.size();
+    }
+    
+    if(m_holes.size() < m_max_hole_count) spawnHole();
+    else if(!m_holes.empty()) {
+        Hole& hole = *m_holes[m_next_recycled_hole];
+        hole.spawn(true, "", hole.getDirection());
+        m_next_recycled_hole = (m_next_recycled_hole + 1) % m_holes.size();
+    }
+}
+
+void World::gameOver() {
+    m_game_over = true;
+    
+    if(m_score > m_highscore) {
+        m_highscore = m_score;
+        m_new_high = true;
+    }
+}
+
+World::Shown World::getShown() const {
+    Shown shown;
+    shown.level = m_level;
+    shown.game_over = m_game_over;
+    shown.changing_level = m_changing_level;
+    shown.new_high = m_new_high;
+    shown.health = m_health;
+    shown.score = m_score;
+    shown.highscore = m_highscore;
+    shown.effect_color = m_effect_color.toInteger();
+    shown.timescale = static_cast<float>(m_timescale);
+    return shown;
+}
+
+void World::show(const Shown& shown) {
+    m_level = shown.level;
+    m_game_over = shown.game_over;
+    m_changing_level = shown.changing_level;
+    m_new_high = shown.new_high;
+    m_health = shown.health;
+    m_score = shown.score;
+    m_highscore = shown.highscore;
+    m_effect_color = sf::Color(shown.effect_color);
+    m_timescale = shown.timescale;
+}
+
+// Everything timed by the clocks stays where it is, as when they are rebased
+void World::showClocks(float global_timer, float entity_time) {
+    const Real global_shift = m_global_timer - global_timer;
+    const Real entity_shift = m_entity_time - entity_time;
+    m_global_timer = global_timer;
+    m_entity_time = entity_time;
+    
+    m_player.shiftClock(global_shift);
+    for(auto& e : m_hazards) e->shiftClock(entity_shift);
+    for(auto& e : m_holes) e->shiftClock(entity_shift);
+}
+
+// New ones stand still at the top left until they are shown, so what a pooled one was before
+// doesn't matter
+void World::showObjectCounts(std::size_t hazard_count, std::size_t hole_count) {
+    const LevelLayout::Spawn still = { 0, 0, 0, 0, 0 };
+    
+    if(m_hazards.size() > hazard_count) m_hazards.resize(hazard_count);
+    while(m_hazards.size() < hazard_count) {
+        acquire(*this, m_hazard_pool, m_hazards);
+        showHazard(m_hazards.size() - 1, still);
+    }
+    
+    if(m_holes.size() > hole_count) m_holes.resize(hole_count);
+    while(m_holes.size() < hole_count) {
+        acquire(*this, m_hole_pool, m_holes);
+        showHole(m_holes.size() - 1, still);
+    }
+}
+
+// A new path from where the spawn says at the current time
+void World::showHazard(std::size_t index, const LevelLayout::Spawn& spawn) {
+    if(index >= m_hazards.size() || m_hazard_names.empty()) return;
+    
+    Entity& hazard = *m_hazards[index];
+    const std::size_t type = spawn.type % m_hazard_names.size();
+    hazard.spawnAt(spawn.floor, spawn.x, m_hazard_names[type], spawn.direction);
+    hazard.setType(type);
+    hazard.setMovementSpeed(spawn.speed);
+}
+
+void World::showHole(std::size_t index, const LevelLayout::Spawn& spawn) {
+    if(index >= m_holes.size()) return;
+    
+    Hole& hole = *m_holes[index];
+    hole.spawnAt(spawn.floor, spawn.x, "", spawn.direction);
+    hole.setMovementSpeed(spawn.speed);
+}
+
+// Only time passes, the player stays as last shown
+void World::tickShown() {
+    ++m_tick;
+    m_tick_events.clear();
+    m_global_timer += m_dt;
+    m_entity_time += m_timescale * m_dt;
+    
+    for(auto& e : m_holes) e->update(0);
+    for(auto& e : m_hazards) e->update(0);
+}
+
+void World::nextLevel() {
+    changeLevel(m_level + 1);
+    m_changing_level = false;
+}
+
+void World::prevLevel() {
+    changeLevel(m_level - 1);
+    m_changing_level = false;
+}
+
+void World::resetEffects() {
+    // Reset variables
+    m_timescale = 1;
+    m_effect_color = sf::Color::Transparent;
+}
+
+void World::startLevel(int level) {
+    resetEffects();
+    
+    // Don't exceed the level limit
+    level = std::min(std::max(level, 0), m_last_level);
+    m_level = level;
+    m_entity_time = 0;
+    m_level_arena.reset();
+    
+    // Reset score
+    if(m_level == 0) m_score = 0;
+    // Set the score increase amount depending on the level
+    m_score_increase = m_score_base * (1 + m_level);
+    
+    m_hazards.clear();
+    m_holes.clear();
+    
+    // Endless
+    m_stream_timer = m_stream_interval;
+    m_next_recycled_hazard = 0;
+    m_next_recycled_hole = 0;
+}
+
+void World::changeLevel(int level) {
+    // Generated layout if there is one for this level
+    const LevelLayout* layout = m_layout_provider ? m_layout_provider(std::min(std::max(level, 0), m_last_level)) : nullptr;
+    if(layout) {
+        changeLevel(level, *layout);
+        return;
+    }
+    
+    startLevel(level);
+    
+    const manifest::Level& params = m_manifest->getLevel(m_level);
+    
+    // Spawn hazards
+    for(unsigned i = 0; i < params.hazard_count * m_spawn_multiplier; ++i) spawnHazard();
+    
+    // Spawn holes
+    for(unsigned i = 0; i < params.hole_count * m_spawn_multiplier; ++i) spawnHole();
+    
+    // Health
+    if(m_level == 0) m_health = m_start_health;
+    else m_health += params.bonus_health;
+    
+    // Player
+    m_player.spawn(false, "pink");
+}
+
+void World::changeLevel(int level, const LevelLayout& layout) {
+    startLevel(level);
+    
+    // Spawn hazards
+    for(auto& spawn : layout.hazards) {
+        Entity& hazard = acquire(*this, m_hazard_pool, m_hazards);
+        const std::size_t type = spawn.type % m_hazard_names.size();
+        hazard.spawnAt(spawn.floor, spawn.x, m_hazard_names[type], spawn.direction);
+        hazard.setType(type);
+        hazard.setMovementSpeed(spawn.speed);
+    }
+    
+    // Spawn holes
+    for(auto& spawn : layout.holes) {
+        Hole& hole = acquire(*this, m_hole_pool, m_holes);
+        hole.spawnAt(spawn.floor, spawn.x, "", spawn.direction);
+        hole.setMovementSpeed(spawn.speed);
+    }
+    
+    // Health
+    if(m_level == 0) m_health = m_start_health;
+    else m_health += m_manifest->getLevel(m_level).bonus_health;
+    
+    // Player
+    m_player.spawn(false, "pink");
+}
+
+void World::restart() {
+    changeLevel(0);
+    m_game_over = false;
+    m_new_high = false;
+}
+
+// Clears the session flags, a changeLevel() is expected right after
+void World::reset() {
+    m_events.clear();
+    m_global_timer = 0;
+    m_game_over = false;
+    m_changing_level = false;
+    m_new_high = false;
+}
+
+void World::levelFinished() {
+    m_changing_level = true;
+    m_global_timer = 0;
+}
+
+// Endless runs carry on from the bottom with the next level's score and health, the holes and
+// hazards stay where they are
+void World::climbedToTop() {
+    m_level = std::min(m_level + 1, m_last_level);
+    m_score_increase = m_score_base * (1 + m_level);
+    m_health += m_manifest->getLevel(m_level).bonus_health;
+    
+    m_player.spawn(false, "pink");
+    streamEntities();
+}
+
+// Moves the clocks back once they pass a period, with everything that was timed by them
+void World::rebaseClocks() {
+    if(m_global_timer >= m_clock_period) {
+        m_global_timer -= m_clock_period;
+        m_player.shiftClock(m_clock_period);
+    }
+    if(m_entity_time >= m_clock_period) {
+        m_entity_time -= m_clock_period;
+        for(auto& e : m_hazards) e->shiftClock(m_clock_period);
+        for(auto& e : m_holes) e->shiftClock(m_clock_period);
+    }
+}
+
+bool World::inInfoScreen() const {
+    return m_changing_level || m_game_over;
+}
+
+bool World::isEndless() const { return m_endless; }
+
+FlightRecorder* World::getFlightRecorder() const { return m_flight_recorder; }
+
+const Animation* World::getAnimation(const char* name) const {
+    if(!m_animations) return nullptr;
+    
+    auto it = m_animations->find(name);
+    return it != m_animations->end() ? &it->second : nullptr;
+}
+
+// Time at which the next hole is above the given place, counted in entity time
+Real World::getHoleArrivalTime(int floor, Real x) const {
+    Real arrival = REAL_MAX;
+    for(auto& hole : m_holes) arrival = std::min(arrival, hole->getArrivalTime(floor, x, m_entity_time));
+    return arrival;
+}
+
+// Getters
+const std::vector<Entity*>& World::getHazards() const { return m_hazards; }
+const std::vector<Hole*>& World::getHoles() const { return m_holes; }
+const Player& World::getPlayer() const { return m_player; }
+Player& World::getPlayer() { return m_player; }
+const std::vector<World::GAME_EVENT>& World::getTickEvents() const { return m_tick_events; }
+World::Input World::getInput() const { return m_input; }
+Real World::getDt() const { return m_dt; }
+unsigned World::getTick() const { return m_tick; }
+Real World::getGlobalTimer() const { return m_global_timer; }
+Real World::getTimescale() const { return m_timescale; }
+Real World::getEntityTime() const { return m_entity_time; }
+sf::Vector2f World::getViewSize() const { return m_view_size; }
+float World::getSpritesheetBlockSize() const { return m_sheet_block_size; }
+float World::getTileHeight() const { return m_tile_height; }
+float World::getHoleHeight() const { return m_tile_height - 14; }
+float World::getFloorHeight() const { return m_line_height; }
+int World::getBottomFloor() const { return m_floor_count - 1; }
+int World::getVisibleFloorCount() const { return m_visible_floor_count; }
+
+// First floor in view when the player is in the middle of it, stops at the ends of the world
+int World::getViewTopFloor() const {
+    return std::min(std::max(m_player.getFloor() - m_visible_floor_count / 2, 0), m_floor_count - m_visible_floor_count);
+}
+
+// Holes and hazards wrap from the bottom floor to the top one, so floor ranges wrap too
+bool World::isFloorInRange(int floor, int first, int count) const {
+    if(count >= m_floor_count) return true;
+    return ((floor - first) % m_floor_count + m_floor_count) % m_floor_count < count;
+}
+std::size_t World::getMaxHoleCount() const { return m_max_hole_count; }
+std::size_t World::getPoolSize() const { return m_hazard_pool.size() + m_hole_pool.size(); }
+std::mt19937& World::getRandom() { return m_random; }
+bool World::hasAnimations() const { return m_animations != nullptr; }
+Arena& World::getLevelArena() { return m_level_arena; }
+const Arena& World::getLevelArena() const { return m_level_arena; }
+int World::getLevel() const { return m_level; }
+int World::getLastLevel() const { return m_last_level; }
+bool World::isGameOver() const { return m_game_over; }
+bool World::isChangingLevel() const { return m_changing_level; }
+unsigned World::getHealth() const { return m_health; }
+void World::setHealth(unsigned health) { m_health = health; }
+unsigned World::getScore() const { return m_score; }
+unsigned World::getHighscore() const { return m_highscore; }
+bool World::isNewHigh() const { return m_new_high; }
+const sf::Color& World::getEffectColor() const { return m_effect_color; }
+std::size_t World::getHazardTypeCount() const { return m_hazard_names.size(); }
+void World::addScore() { m_score += m_score_increase; }
@@ -0,0 +1,253 @@
+#ifndef World_hpp
+#define World_hpp
+
+#include <SFML/Graphics/Color.hpp>
+#include <SFML/System/Vector2.hpp>
+#include <map>
+#include <functional>
+#include <memory>
+#include <random>
+#include <vector>
+#include <cstdint>
+
+#include "Entity.hpp"
+#include "Hole.hpp"
+#include "Player.hpp"
+#include "Manifest.hpp"
+#include "Library/Arena.hpp"
+
+class FlightRecorder;
+
+// Animations by name, looked up with plain C strings without making a std::string
+typedef std::map<std::string, Animation, std::less<>> AnimationTable;
+
+// Explicit spawn layout of a level, made by LevelGenerator
+struct LevelLayout {
+    struct Spawn {
+        int floor;
+        float x;
+        int direction;
+        float speed;
+        std::size_t type; // Hazard type, unused for holes
+    };
+    
+    std::vector<Spawn> hazards;
+    std::vector<Spawn> holes;
+};
+
+// Gameplay state and rules, no window, sound or keyboard.
+// Game owns one and feeds it the keyboard, tools can run many of them headless on any thread.
+class World {
+public:
+    World();
+    World(const World&) = delete;
+    World& operator=(const World&) = delete;
+    
+    // Setup, sizes from outside have to be checked against the limits first. Fewer floors than
+    // fit in the view are made up to that many.
+    static const int MIN_FLOOR_COUNT = 8;
+    static const int MAX_FLOOR_COUNT = 256;
+    void setManifest(const Manifest& manifest);
+    void setSize(int floor_count, std::size_t max_hole_count);
+    void setEndless(bool endless);
+    void setAnimations(const AnimationTable* animations);
+    void setLayoutProvider(std::function<const LevelLayout*(int level)> provider);
+    void setFlightRecorder(FlightRecorder* recorder);
+    void seed(unsigned seed);
+    void copyState(const World& other);
+    std::uint64_t getStateHash() const;
+    std::uint64_t getTickHash() const;
+    
+    // Input of one tick
+    enum INPUT { INPUT_LEFT = 1 << 0, INPUT_RIGHT = 1 << 1, INPUT_JUMP = 1 << 2, INPUT_CONFIRM = 1 << 3 };
+    typedef std::uint8_t Input;
+    
+    // Events
+    enum GAME_EVENT {
+        GAME_OVER,
+        DROPPED_TO_BOTTOM, REACHED_TO_TOP,
+        STARTED_JUMPING, STOPPED_JUMPING,
+        STARTED_FALLING, STOPPED_FALLING,
+        HIT_BY_HAZARD, STOPPED_HAZARD_HIT,
+        HIT_HEAD, STOPPED_HIT_HEAD,
+        STARTED_WALKING, STOPPED_WALKING,
+        STOPPED_STUN, PLAYER_TURNED,
+        GAME_EVENT_COUNT
+    };
+    static const char* getEventName(GAME_EVENT event);
+    
+    // Global
+    void update(Input input);
+    int fastForward(int max_ticks);
+    void trigger(GAME_EVENT event);
+    const std::vector<GAME_EVENT>& getTickEvents() const;
+    
+    // Game
+    void changeLevel(int level);
+    void changeLevel(int level, const LevelLayout& layout);
+    void nextLevel();
+    void prevLevel();
+    void restart();
+    void reset();
+    bool inInfoScreen() const;
+    bool isEndless() const;
+    
+    // Getters
+    Input getInput() const;
+    Real getDt() const;
+    unsigned getTick() const; // Updates since the world was made, copied with the state
+    Real getGlobalTimer() const;
+    Real getTimescale() const;
+    Real getEntityTime() const;
+    Real getHoleArrivalTime(int floor, Real x) const;
+    sf::Vector2f getViewSize() const;
+    float getSpritesheetBlockSize() const;
+    float getTileHeight() const;
+    float getHoleHeight() const;
+    float getFloorHeight() const;
+    int getBottomFloor() const;
+    int getVisibleFloorCount() const;
+    int getViewTopFloor() const;
+    bool isFloorInRange(int floor, int first, int count) const;
+    std::size_t getMaxHoleCount() const;
+    std::size_t getPoolSize() const;
+    std::mt19937& getRandom();
+    bool hasAnimations() const;
+    const Animation* getAnimation(const char* name) const;
+    FlightRecorder* getFlightRecorder() const;
+    Arena& getLevelArena();
+    const Arena& getLevelArena() const;
+    
+    int getLevel() const;
+    int getLastLevel() const;
+    bool isGameOver() const;
+    bool isChangingLevel() const;
+    unsigned getHealth() const;
+    void setHealth(unsigned health);
+    unsigned getScore() const;
+    unsigned getHighscore() const;
+    bool isNewHigh() const;
+    const sf::Color& getEffectColor() const;
+    std::size_t getHazardTypeCount() const;
+    
+    // Objects
+    const std::vector<Entity*>& getHazards() const;
+    const std::vector<Hole*>& getHoles() const;
+    const Player& getPlayer() const;
+    Player& getPlayer();
+    
+    // Spectating, the world only shows what a game sends. The clocks run and holes and hazards
+    // follow their paths, everything else is set from outside.
+    struct Shown {
+        int level;
+        bool game_over;
+        bool changing_level;
+        bool new_high;
+        unsigned health;
+        unsigned score;
+        unsigned highscore;
+        std::uint32_t effect_color;
+        float timescale;
+    };
+    Shown getShown() const;
+    void show(const Shown& shown);
+    void showClocks(float global_timer, float entity_time);
+    void showObjectCounts(std::size_t hazard_count, std::size_t hole_count);
+    void showHazard(std::size_t index, const LevelLayout::Spawn& spawn);
+    void showHole(std::size_t index, const LevelLayout::Spawn& spawn);
+    void tickShown();
+    
+private:
+// Functions
+    void checkGameEvents();
+    void hashTick(std::uint64_t moved_hash);
+    void addScore();
+    void levelFinished();
+    void climbedToTop();
+    void rebaseClocks();
+    void gameOver();
+    void resetEffects();
+    void startLevel(int level);
+    void reservePools();
+    
+    // Objects
+    void spawnHole();
+    void spawnHazard();
+    void respawnHazard(Entity& hazard);
+    void streamEntities();
+    
+// Variables
+    // Setup
+    const Manifest* m_manifest;
+    const AnimationTable* m_animations;
+    std::function<const LevelLayout*(int level)> m_layout_provider;
+    FlightRecorder* m_flight_recorder; // Gets the events and player state changes, not copied
+    std::vector<std::string> m_hazard_names;
+    std::mt19937 m_random;
+    
+    // Global
+    // The view shows 8 floors, worlds with more scroll. Holes and hazards away from the view are
+    // only moved every few ticks, none can reach the view in between.
+    const Real m_dt;
+    const sf::Vector2f m_view_size;
+    const unsigned m_sheet_block_size;
+    const float m_tile_height;
+    const int m_visible_floor_count;
+    const float m_line_height;
+    int m_floor_count;
+    unsigned m_spawn_multiplier; // More hazards and holes for bigger worlds
+    const int m_near_floor_margin;
+    const unsigned m_far_update_interval;
+    unsigned m_tick;
+    std::uint64_t m_tick_hash; // Chained over every update since seeding
+    
+    Input m_input;
+    Real m_global_timer;
+    Real m_timescale;
+    Real m_entity_time; // Timescaled, holes and hazards move by this
+    const Real m_slow_mo_timescale;
+    
+    // Game
+    std::vector<GAME_EVENT> m_events;
+    std::vector<GAME_EVENT> m_tick_events;
+    int m_level;
+    int m_last_level;
+    bool m_game_over;
+    bool m_changing_level;
+    unsigned m_health;
+    sf::Color m_effect_color;
+    Arena m_level_arena; // Reset on every level change
+    
+    const Real m_changing_level_time;
+    const unsigned m_start_health;
+    
+    // Objects, taken from pools that are kept between levels
+    std::vector<std::unique_ptr<Entity>> m_hazard_pool;
+    std::vector<std::unique_ptr<Hole>> m_hole_pool;
+    std::vector<Entity*> m_hazards;
+    std::vector<Hole*> m_holes;
+    Player m_player;
+    std::size_t m_curr_hazard;
+    std::size_t m_max_hole_count;
+    
+    // Score
+    const unsigned m_score_base;
+    unsigned m_score_increase;
+    unsigned m_score;
+    unsigned m_highscore;
+    bool m_new_high;
+    
+    // Endless, climbing to the top only raises the level and holes and hazards stream in over
+    // time. Once the pools are full the oldest ones are respawned in place.
+    bool m_endless;
+    const Real m_stream_interval;
+    const Real m_stream_interval_step; // Shorter by this every level
+    const Real m_min_stream_interval;
+    Real m_stream_timer;
+    std::size_t m_max_hazard_count;
+    std::size_t m_next_recycled_hazard;
+    std::size_t m_next_recycled_hole;
+    const Real m_clock_period; // Clocks are moved back by this, floats lose ticks after hours
+};
+
+#endif /* World_hpp */
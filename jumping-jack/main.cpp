@@ -1,6 +1,161 @@
 #include "Game.hpp"
 
-int main() {
-    Game::i().run();
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace {
+    // A whole number from min to max, false for anything else
+    bool parseNumber(const std::string& text, unsigned long min, unsigned long max, unsigned long& value) {
+        if(text.empty() || text.find_first_not_of("0123456789") != std::string::npos) return false;
+        
+        errno = 0;
+        value = std::strtoul(text.c_str(), nullptr, 10);
+        return errno == 0 && value >= min && value <= max;
+    }
+}
+
+// jumping-jack [--seed <seed>] [--floors <count>] [--endless] [--generate-levels]
+//              [--flight-file <dump>] [--time-attack <ghosts>] [--versus <local port> <host> <remote port>]
+//              [--input-delay <ticks>] [--net-sim <latency ms> <loss percent>] [--broadcast <socket>]
+//              [--record <replay>]
+// jumping-jack --render <replay> <output> [width height fps png|raw]
+// jumping-jack --verify <replay> [tick hash]
+// jumping-jack --verify-golden
+// jumping-jack [--floors <count>] --soak <ticks>
+// jumping-jack [--input-delay <ticks>] [--net-sim <latency ms> <loss percent>] --versus-test <ticks>
+// jumping-jack [--floors <count>] --alloc-test <frames>
+// jumping-jack --spectate <socket>
+// jumping-jack --flight <dump>
+int main(int argc, char* argv[]) {
+    std::vector<std::string> args(argv + 1, argv + argc);
+    
+    // World options, replays keep their own
+    while(!args.empty()) {
+        if(args.size() >= 2 && args[0] == "--seed") {
+            unsigned long seed;
+            if(!parseNumber(args[1], 0, std::numeric_limits<std::uint32_t>::max(), seed)) {
+                std::cerr << "Not a seed: " << args[1] << std::endl;
+                return 1;
+            }
+            Game::i().setSeed(static_cast<unsigned>(seed));
+            args.erase(args.begin(), args.begin() + 2);
+        }
+        else if(args.size() >= 2 && args[0] == "--floors") {
+            unsigned long floor_count;
+            if(!parseNumber(args[1], World::MIN_FLOOR_COUNT, World::MAX_FLOOR_COUNT, floor_count)) {
+                std::cerr << "Floors go from " << World::MIN_FLOOR_COUNT << " to " << World::MAX_FLOOR_COUNT << std::endl;
+                return 1;
+            }
+            Game::i().setFloorCount(static_cast<int>(floor_count));
+            args.erase(args.begin(), args.begin() + 2);
+        }
+        else if(args[0] == "--endless") {
+            Game::i().setEndless(true);
+            args.erase(args.begin());
+        }
+        else if(args[0] == "--generate-levels") {
+            Game::i().setGenerateLevels(true);
+            args.erase(args.begin());
+        }
+        else if(args.size() >= 2 && args[0] == "--flight-file") {
+            Game::i().setFlightFile(args[1]);
+            args.erase(args.begin(), args.begin() + 2);
+        }
+        else if(args.size() >= 2 && args[0] == "--time-attack") {
+            Game::i().setTimeAttack(args[1]);
+            args.erase(args.begin(), args.begin() + 2);
+        }
+        else if(args.size() >= 4 && args[0] == "--versus") {
+            unsigned long local_port, remote_port;
+            if(!parseNumber(args[1], 0, std::numeric_limits<std::uint16_t>::max(), local_port) ||
+               !parseNumber(args[3], 1, std::numeric_limits<std::uint16_t>::max(), remote_port)) {
+                std::cerr << "Ports go up to " << std::numeric_limits<std::uint16_t>::max() << ", the local one is 0 for any" << std::endl;
+                return 1;
+            }
+            Game::i().setVersus(static_cast<std::uint16_t>(local_port), args[2], static_cast<std::uint16_t>(remote_port));
+            args.erase(args.begin(), args.begin() + 4);
+        }
+        else if(args.size() >= 2 && args[0] == "--input-delay") {
+            unsigned long tick_count;
+            if(!parseNumber(args[1], 0, Versus::MAX_ROLLBACK, tick_count)) {
+                std::cerr << "Input delay goes up to " << Versus::MAX_ROLLBACK << " ticks" << std::endl;
+                return 1;
+            }
+            Game::i().setInputDelay(tick_count);
+            args.erase(args.begin(), args.begin() + 2);
+        }
+        else if(args.size() >= 3 && args[0] == "--net-sim") {
+            unsigned long latency, loss;
+            if(!parseNumber(args[1], 0, 1000, latency) || !parseNumber(args[2], 0, 100, loss)) {
+                std::cerr << "Latency goes up to 1000 ms, loss up to 100 percent" << std::endl;
+                return 1;
+            }
+            Game::i().setSimulatedLink(latency / 1000.0f, loss / 100.0f);
+            args.erase(args.begin(), args.begin() + 3);
+        }
+        else if(args.size() >= 2 && args[0] == "--broadcast") {
+            Game::i().setBroadcast(args[1]);
+            args.erase(args.begin(), args.begin() + 2);
+        }
+        else break;
+    }
+    
+    if(args.size() >= 2 && args[0] == "--verify") return Game::i().verifyReplay(args[1], args.size() >= 3 ? args[2] : "") ? 0 : 1;
+    if(!args.empty() && args[0] == "--verify-golden") return Game::i().verifyGolden() ? 0 : 1;
+    if(args.size() >= 2 && args[0] == "--soak") {
+        unsigned long tick_count;
+        if(!parseNumber(args[1], 1, std::numeric_limits<std::uint32_t>::max(), tick_count)) {
+            std::cerr << "Not a tick count: " << args[1] << std::endl;
+            return 1;
+        }
+        return Game::i().soak(tick_count) ? 0 : 1;
+    }
+    if(args.size() >= 2 && args[0] == "--alloc-test") {
+        unsigned long frame_count;
+        if(!parseNumber(args[1], 1, std::numeric_limits<std::uint32_t>::max(), frame_count)) {
+            std::cerr << "Not a frame count: " << args[1] << std::endl;
+            return 1;
+        }
+        return Game::i().allocTest(frame_count) ? 0 : 1;
+    }
+    if(args.size() >= 2 && args[0] == "--spectate") return Game::i().spectate(args[1]) ? 0 : 1;
+    if(args.size() >= 2 && args[0] == "--versus-test") {
+        unsigned long tick_count;
+        if(!parseNumber(args[1], 1, std::numeric_limits<std::uint32_t>::max(), tick_count)) {
+            std::cerr << "Not a tick count: " << args[1] << std::endl;
+            return 1;
+        }
+        return Game::i().versusTest(tick_count) ? 0 : 1;
+    }
+    
+    if(args.size() >= 2 && args[0] == "--flight") {
+        if(FlightRecorder::print(args[1], std::cout)) return 0;
+        std::cerr << "Could not read flight recorder dump: " << args[1] << std::endl;
+        return 1;
+    }
+    
+    if(!args.empty() && args[0] == "--render") {
+        if(args.size() < 3) {
+            std::cerr << "Usage: --render <replay> <output> [width height fps png|raw]" << std::endl;
+            return 1;
+        }
+        
+        unsigned long width = 800, height = 600, fps = 60;
+        if((args.size() >= 5 && (!parseNumber(args[3], 1, 16384, width) || !parseNumber(args[4], 1, 16384, height))) ||
+           (args.size() >= 6 && !parseNumber(args[5], 1, 1000, fps))) {
+            std::cerr << "Width and height go up to 16384, fps up to 1000" << std::endl;
+            return 1;
+        }
+        FrameWriter::FORMAT format = args.size() >= 7 && args[6] == "raw" ? FrameWriter::RAW : FrameWriter::PNG;
+        
+        return Game::i().renderReplay(args[1], args[2], sf::Vector2u(width, height), fps, format) ? 0 : 1;
+    }
+    
+    Game::i().run(args.size() >= 2 && args[0] == "--record" ? args[1] : "");
     return 0;
 }
@@ -0,0 +1,206 @@
+#include "MatchServer.hpp"
+#include "Replay.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Headless match server, built on the game's world without a window or sound.
+// jjserver [--manifest <manifest.bin>] [--threads <count>] --serve <socket> [sessions]
+// jjserver [--manifest <manifest.bin>] [--threads <count>] --bench <sessions> <ticks>
+// jjserver --submit <socket> <replay> [copies]
+namespace {
+    const std::size_t SUBMIT_CHUNK = 1024;               // Inputs a message
+    const int SUBMIT_TIMEOUT = 10000;                    // Milliseconds
+    const unsigned long MAX_THREADS = 256;
+    const unsigned long MAX_COPIES = 1024;               // Connections a submit opens at once
+    const unsigned long MAX_BENCH_SESSIONS = 10000;      // Each keeps a world and its inputs
+    const unsigned long MAX_BENCH_TICKS = 125 * 60 * 60; // An hour
+    
+    MatchServer* running_server = nullptr;
+    
+    // A whole number from min to max, false for anything else
+    bool parseNumber(const std::string& text, unsigned long min, unsigned long max, unsigned long& value) {
+        if(text.empty() || text.find_first_not_of("0123456789") != std::string::npos) return false;
+        
+        errno = 0;
+        value = std::strtoul(text.c_str(), nullptr, 10);
+        return errno == 0 && value >= min && value <= max;
+    }
+    
+    void stopServer(int) {
+        if(running_server) running_server->stop();
+    }
+    
+    void appendMessage(std::vector<std::uint8_t>& bytes, match::TYPE type, const void* data, std::size_t size) {
+        const match::Header header = { static_cast<std::uint32_t>(type), static_cast<std::uint32_t>(size) };
+        const std::uint8_t* header_bytes = reinterpret_cast<const std::uint8_t*>(&header);
+        const std::uint8_t* data_bytes = static_cast<const std::uint8_t*>(data);
+        bytes.insert(bytes.end(), header_bytes, header_bytes + sizeof(header));
+        bytes.insert(bytes.end(), data_bytes, data_bytes + size);
+    }
+    
+    // The replay's inputs with its tick hashes as checks, when it was recorded with the same number type
+    std::vector<std::uint8_t> makeSubmission(const Replay& replay) {
+        std::vector<std::uint8_t> bytes;
+        const match::Start start = {
+            replay.getSeed(), replay.getFloorCount(), static_cast<std::uint32_t>(replay.getMaxHoleCount()), replay.isEndless()
+        };
+        appendMessage(bytes, match::START, &start, sizeof(start));
+        
+        const bool comparable = replay.isFixedPoint() == Replay().isFixedPoint();
+        std::vector<World::Input> inputs;
+        for(std::size_t tick = 0; tick < replay.getTickCount(); ++tick) {
+            inputs.push_back(replay.getInput(tick));
+            
+            const bool checked = comparable && replay.hasTickHash(tick + 1);
+            if(inputs.size() < SUBMIT_CHUNK && !checked && tick + 1 < replay.getTickCount()) continue;
+            
+            appendMessage(bytes, match::INPUTS, inputs.data(), inputs.size());
+            inputs.clear();
+            if(!checked) continue;
+            
+            const match::Check check = { static_cast<std::uint32_t>(tick + 1), 0, replay.getTickHash(tick + 1) };
+            appendMessage(bytes, match::CHECK, &check, sizeof(check));
+        }
+        appendMessage(bytes, match::FINISH, nullptr, 0);
+        return bytes;
+    }
+    
+    // Sends a replay on copy count connections at once and prints what the server made of each
+    bool submit(const std::string& path, const std::string& replay_file, std::size_t copy_count) {
+        Replay replay;
+        if(!replay.loadFromFile(replay_file)) {
+            std::cerr << "Could not load replay: " << replay_file << std::endl;
+            return false;
+        }
+        const std::vector<std::uint8_t> submission = makeSubmission(replay);
+        
+        std::vector<std::unique_ptr<LocalSocket>> sockets;
+        for(std::size_t i = 0; i < copy_count; ++i) {
+            sockets.emplace_back(new LocalSocket());
+            if(!sockets.back()->connect(path)) {
+                std::cerr << "Could not connect to: " << path << std::endl;
+                return false;
+            }
+        }
+        
+        // Written a slice at a time to every connection so the server plays them side by side
+        const std::size_t slice = 4096;
+        for(std::size_t offset = 0; offset < submission.size(); offset += slice) {
+            for(auto& socket : sockets)
+                if(!socket->sendAll(&submission[offset], std::min(slice, submission.size() - offset), SUBMIT_TIMEOUT)) {
+                    std::cerr << "Server stopped taking inputs" << std::endl;
+                    return false;
+                }
+        }
+        
+        bool verified = true;
+        for(std::size_t i = 0; i < sockets.size(); ++i) {
+            std::uint8_t bytes[sizeof(match::Header) + sizeof(match::Result)];
+            std::size_t size = 0;
+            while(size < sizeof(bytes) && sockets[i]->wait(POLLIN, SUBMIT_TIMEOUT))
+                size += sockets[i]->receive(bytes + size, sizeof(bytes) - size);
+            
+            if(size < sizeof(bytes)) {
+                std::cout << "Copy " << i << ": no result" << std::endl;
+                verified = false;
+                continue;
+            }
+            
+            match::Result result;
+            std::memcpy(&result, bytes + sizeof(match::Header), sizeof(result));
+            
+            std::cout << "Copy " << i << ": ";
+            if(result.mismatch_tick != 0) std::cout << "differed after tick " << result.mismatch_tick;
+            else std::cout << "matched " << result.check_count << " checks";
+            std::cout << ", " << result.tick_count << " ticks, level " << result.level << ", score " << result.score
+                      << ", final hash " << std::hex << result.state_hash << ", tick hash " << result.tick_hash << std::dec
+                      << ", " << result.tick_cost / 1000.0 << " us a tick" << std::endl;
+            verified = verified && result.mismatch_tick == 0 && result.tick_count == replay.getTickCount();
+        }
+        return verified;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    std::vector<std::string> args(argv + 1, argv + argc);
+    std::string manifest_file = "data/manifest.bin";
+    std::size_t thread_count = 0;
+    
+    while(!args.empty()) {
+        if(args.size() >= 2 && args[0] == "--manifest") {
+            manifest_file = args[1];
+            args.erase(args.begin(), args.begin() + 2);
+        }
+        else if(args.size() >= 2 && args[0] == "--threads") {
+            unsigned long count;
+            if(!parseNumber(args[1], 0, MAX_THREADS, count)) {
+                std::cerr << "Threads go up to " << MAX_THREADS << ", 0 is one per core" << std::endl;
+                return 1;
+            }
+            thread_count = count;
+            args.erase(args.begin(), args.begin() + 2);
+        }
+        else break;
+    }
+    
+    if(args.size() >= 3 && args[0] == "--submit") {
+        unsigned long copy_count = 1;
+        if(args.size() >= 4 && !parseNumber(args[3], 1, MAX_COPIES, copy_count)) {
+            std::cerr << "Copies go from 1 to " << MAX_COPIES << std::endl;
+            return 1;
+        }
+        return submit(args[1], args[2], copy_count) ? 0 : 1;
+    }
+    
+    Manifest manifest;
+    if(!manifest.loadFromFile(manifest_file)) {
+        std::cerr << "Could not load: " << manifest_file << std::endl;
+        return 1;
+    }
+    MatchServer server(manifest, thread_count);
+    
+    if(args.size() >= 3 && args[0] == "--bench") {
+        unsigned long session_count, tick_count;
+        if(!parseNumber(args[1], 1, MAX_BENCH_SESSIONS, session_count) || !parseNumber(args[2], 1, MAX_BENCH_TICKS, tick_count)) {
+            std::cerr << "Sessions go up to " << MAX_BENCH_SESSIONS << ", ticks up to " << MAX_BENCH_TICKS << std::endl;
+            return 1;
+        }
+        server.bench(session_count, tick_count, 1337);
+        std::cout << server.getReport();
+        return server.getStats().failed_count == 0 ? 0 : 1;
+    }
+    
+    if(args.size() >= 2 && args[0] == "--serve") {
+        unsigned long session_limit = 0;
+        if(args.size() >= 3 && !parseNumber(args[2], 0, std::numeric_limits<std::uint32_t>::max(), session_limit)) {
+            std::cerr << "Not a session count: " << args[2] << std::endl;
+            return 1;
+        }
+        if(!server.listen(args[1])) {
+            std::cerr << "Could not listen on: " << args[1] << std::endl;
+            return 1;
+        }
+        running_server = &server;
+        std::signal(SIGINT, &stopServer);
+        std::signal(SIGTERM, &stopServer);
+        
+        std::cout << "Serving on " << args[1] << " with " << server.getWorkerCount() << " workers" << std::endl;
+        server.serve(session_limit);
+        std::cout << server.getReport();
+        return 0;
+    }
+    
+    std::cerr << "Usage: jjserver [--manifest <manifest.bin>] [--threads <count>] --serve <socket> [sessions] | --bench <sessions> <ticks>\n"
+              << "       jjserver --submit <socket> <replay> [copies]" << std::endl;
+    return 1;
+}
@@ -0,0 +1,172 @@
+// Compiles data/manifest.txt into the binary blob the game loads at startup.
+// Usage: manifestc <manifest.txt> <manifest.bin>
+
+#include "../jumping-jack/Manifest.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <unordered_map>
+#include <cstring>
+
+namespace {
+    struct Compiler {
+        std::string strings;
+        std::vector<manifest::Frame> frames;
+        std::vector<manifest::Animation> animations;
+        std::vector<manifest::Hazard> hazards;
+        std::vector<manifest::Theme> themes;
+        std::vector<manifest::StoryLine> story_lines;
+        std::vector<manifest::Stanza> stanzas;
+        std::vector<manifest::Level> levels;
+        
+        std::unordered_map<std::string, std::uint32_t> theme_ids;
+        int block_x = 0, block_y = 0;
+        
+        std::uint32_t addString(const std::string& s) {
+            std::uint32_t offset = static_cast<std::uint32_t>(strings.size());
+            strings += s;
+            strings += '\0';
+            return offset;
+        }
+    };
+    
+    bool fail(int line, const std::string& message) {
+        std::cerr << "manifest.txt:" << line << ": " << message << std::endl;
+        return false;
+    }
+    
+    bool readCoord(std::istream& in, int& x, int& y) {
+        char comma;
+        return static_cast<bool>(in >> x >> comma >> y) && comma == ',';
+    }
+    
+    bool parseLine(Compiler& c, const std::string& line, int line_number) {
+        std::istringstream in(line);
+        std::string keyword;
+        if(!(in >> keyword) || keyword[0] == '#') return true;
+        
+        if(keyword == "block") {
+            if(!(in >> c.block_x >> c.block_y)) return fail(line_number, "expected: block <width> <height>");
+        }
+        else if(keyword == "animation") {
+            if(c.block_x == 0) return fail(line_number, "block size must come before animations");
+            
+            std::string name;
+            if(!(in >> name)) return fail(line_number, "expected: animation <name> <column,row>...");
+            
+            manifest::Animation a;
+            a.name = c.addString(name);
+            a.first_frame = static_cast<std::uint32_t>(c.frames.size());
+            
+            int x, y;
+            while(readCoord(in, x, y))
+                c.frames.push_back(manifest::Frame{ (x-1)*c.block_x, (y-1)*c.block_y, c.block_x, c.block_y });
+            
+            a.frame_count = static_cast<std::uint32_t>(c.frames.size()) - a.first_frame;
+            if(a.frame_count == 0) return fail(line_number, "animation without frames");
+            c.animations.push_back(a);
+        }
+        else if(keyword == "hazard") {
+            std::string name;
+            if(!(in >> name)) return fail(line_number, "expected: hazard <name>");
+            c.hazards.push_back(manifest::Hazard{ c.addString(name) });
+        }
+        else if(keyword == "theme") {
+            std::string name, background;
+            int x, y;
+            if(!(in >> name >> background) || !readCoord(in, x, y))
+                return fail(line_number, "expected: theme <name> <background> <column,row>");
+            
+            c.theme_ids[name] = static_cast<std::uint32_t>(c.themes.size());
+            c.themes.push_back(manifest::Theme{ c.addString(name), c.addString(background), x, y });
+        }
+        else if(keyword == "stanza") {
+            c.stanzas.push_back(manifest::Stanza{ static_cast<std::uint32_t>(c.story_lines.size()), 0 });
+        }
+        else if(keyword == "line") {
+            if(c.stanzas.empty()) return fail(line_number, "line outside of a stanza");
+            
+            std::string text;
+            std::getline(in >> std::ws, text);
+            c.story_lines.push_back(manifest::StoryLine{ c.addString(text) });
+            ++c.stanzas.back().line_count;
+        }
+        else if(keyword == "level") {
+            unsigned hazard_count, hole_count, bonus_health;
+            std::string theme;
+            if(!(in >> hazard_count >> hole_count >> bonus_health >> theme))
+                return fail(line_number, "expected: level <hazards> <holes> <bonus_health> <theme>");
+            if(!c.theme_ids.count(theme)) return fail(line_number, "unknown theme " + theme);
+            
+            c.levels.push_back(manifest::Level{ hazard_count, hole_count, bonus_health, c.theme_ids[theme] });
+        }
+        else return fail(line_number, "unknown keyword " + keyword);
+        
+        return true;
+    }
+    
+    // Appends a section to the blob, 8 byte aligned
+    template<class T>
+    void writeSection(std::string& blob, manifest::Header& header, manifest::SECTION section, const T* data, std::size_t count) {
+        while(blob.size() % 8 != 0) blob += '\0';
+        
+        header.sections[section].offset = static_cast<std::uint32_t>(blob.size());
+        header.sections[section].count = static_cast<std::uint32_t>(count);
+        blob.append(reinterpret_cast<const char*>(data), count * sizeof(T));
+    }
+}
+
+int main(int argc, char** argv) {
+    if(argc != 3) {
+        std::cerr << "Usage: manifestc <manifest.txt> <manifest.bin>" << std::endl;
+        return 1;
+    }
+    
+    std::ifstream in(argv[1]);
+    if(!in) {
+        std::cerr << "Could not open: " << argv[1] << std::endl;
+        return 1;
+    }
+    
+    Compiler c;
+    std::string line;
+    for(int line_number = 1; std::getline(in, line); ++line_number)
+        if(!parseLine(c, line, line_number)) return 1;
+    
+    if(c.levels.empty() || c.hazards.empty()) {
+        std::cerr << "manifest.txt: needs at least one level and one hazard" << std::endl;
+        return 1;
+    }
+    if(c.stanzas.size() < c.levels.size()) {
+        std::cerr << "manifest.txt: every level needs a story stanza" << std::endl;
+        return 1;
+    }
+    
+    // Header goes first, it is patched once the sections are in place
+    manifest::Header header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, manifest::MAGIC, sizeof(header.magic));
+    header.version = manifest::VERSION;
+    
+    std::string blob(sizeof(header), '\0');
+    writeSection(blob, header, manifest::STRINGS, c.strings.data(), c.strings.size());
+    writeSection(blob, header, manifest::FRAMES, c.frames.data(), c.frames.size());
+    writeSection(blob, header, manifest::ANIMATIONS, c.animations.data(), c.animations.size());
+    writeSection(blob, header, manifest::HAZARDS, c.hazards.data(), c.hazards.size());
+    writeSection(blob, header, manifest::THEMES, c.themes.data(), c.themes.size());
+    writeSection(blob, header, manifest::STORY_LINES, c.story_lines.data(), c.story_lines.size());
+    writeSection(blob, header, manifest::STANZAS, c.stanzas.data(), c.stanzas.size());
+    writeSection(blob, header, manifest::LEVELS, c.levels.data(), c.levels.size());
+    
+    header.size = static_cast<std::uint32_t>(blob.size());
+    std::memcpy(&blob[0], &header, sizeof(header));
+    
+    std::ofstream out(argv[2], std::ios::binary);
+    if(!out.write(blob.data(), blob.size())) {
+        std::cerr << "Could not write: " << argv[2] << std::endl;
+        return 1;
+    }
+    
+    return 0;
+}